@@ -0,0 +1,363 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include <sys/mman.h>
+
+#include "easy_buffer.h"
+
+#define BUFFER_CLASSES 6
+#define BUFFER_OVERSIZE (-1)
+#define BUFFER_BATCH 32                     /* 线程缓存与全局链表之间每批交换的个数 */
+#define BUFFER_SLAB_SIZE (2 * 1024 * 1024)
+#define BUFFER_TAG_SHIFT 48                 /* 用户态指针不超过48位，高16位用作ABA计数 */
+#define BUFFER_PTR_MASK ((1ULL << BUFFER_TAG_SHIFT) - 1)
+
+static const size_t g_class_size[BUFFER_CLASSES] = {256, 1024, 2048, 4096, 16384, 65536};
+
+/* 缓存头部，按cache line对齐，数据区紧随其后 */
+struct BufferHdr
+{
+	int ref;
+	int cls;
+	size_t size;
+	struct BufferHdr *next;        /* 线程缓存或批内链表 */
+	struct BufferHdr *next_batch;  /* 全局链表中下一批，仅批内第一个有效 */
+} __attribute__((aligned(64)));
+
+struct ThreadCache
+{
+	struct BufferHdr *head[BUFFER_CLASSES];
+	int count[BUFFER_CLASSES];
+	unsigned long long allocs;
+	unsigned long long frees;
+	struct ThreadCache *prev;
+	struct ThreadCache *next;
+};
+
+/* 每个尺寸一个全局无锁栈，元素为一批缓存，值为 ABA计数<<48 | 指针 */
+static uint64_t g_stack[BUFFER_CLASSES];
+
+static int g_hugepage;
+static struct BufferStats g_stats;      /* 已退出线程的计数及全局事件计数 */
+static pthread_mutex_t g_registry_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct ThreadCache *g_registry;  /* 所有线程缓存，仅用于统计 */
+static pthread_key_t g_key;
+static pthread_once_t g_once = PTHREAD_ONCE_INIT;
+static __thread struct ThreadCache *t_cache;
+
+#define HDR(buf) ((struct BufferHdr *)((char *)(buf) - sizeof(struct BufferHdr)))
+#define DATA(hdr) ((void *)((char *)(hdr) + sizeof(struct BufferHdr)))
+#define STAT_ADD(field, n) __atomic_fetch_add(&g_stats.field, (n), __ATOMIC_RELAXED)
+
+static int size_to_class(size_t size)
+{
+	int i;
+
+	for (i=0; i<BUFFER_CLASSES; i++)
+	{
+		if (size <= g_class_size[i])
+			return i;
+	}
+	return BUFFER_OVERSIZE;
+}
+
+static void push_batch(int cls, struct BufferHdr *first)
+{
+	uint64_t old, val;
+
+	old = __atomic_load_n(&g_stack[cls], __ATOMIC_ACQUIRE);
+	do
+	{
+		first->next_batch = (struct BufferHdr *)(uintptr_t)(old & BUFFER_PTR_MASK);
+		val = (((old >> BUFFER_TAG_SHIFT) + 1) << BUFFER_TAG_SHIFT) | (uint64_t)(uintptr_t)first;
+	} while (!__atomic_compare_exchange_n(&g_stack[cls], &old, val, 1, __ATOMIC_RELEASE, __ATOMIC_ACQUIRE));
+}
+
+static struct BufferHdr *pop_batch(int cls)
+{
+	uint64_t old, val;
+	struct BufferHdr *first;
+
+	old = __atomic_load_n(&g_stack[cls], __ATOMIC_ACQUIRE);
+	do
+	{
+		first = (struct BufferHdr *)(uintptr_t)(old & BUFFER_PTR_MASK);
+		if (!first)
+			return NULL;
+		/* slab从不释放，即使first已被其他线程取走，读取next_batch也是安全的，计数防止ABA */
+		val = (((old >> BUFFER_TAG_SHIFT) + 1) << BUFFER_TAG_SHIFT) | (uint64_t)(uintptr_t)first->next_batch;
+	} while (!__atomic_compare_exchange_n(&g_stack[cls], &old, val, 1, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE));
+
+	return first;
+}
+
+/*
+ * 线程缓存超过上限时，摘下一批归还全局链表
+ */
+static void spill(struct ThreadCache *c, int cls, int n)
+{
+	struct BufferHdr *first = c->head[cls], *last = first;
+	int i;
+
+	if (!first)
+		return;
+
+	for (i=1; i<n && last->next; i++)
+		last = last->next;
+
+	c->head[cls] = last->next;
+	c->count[cls] -= i;
+	last->next = NULL;
+	push_batch(cls, first);
+	STAT_ADD(spills, 1);
+}
+
+/*
+ * 线程退出时归还所有缓存并合并计数
+ */
+static void thread_cache_destroy(void *param)
+{
+	struct ThreadCache *c = (struct ThreadCache *)param;
+	int i;
+
+	for (i=0; i<BUFFER_CLASSES; i++)
+	{
+		while (c->head[i])
+			spill(c, i, BUFFER_BATCH);
+	}
+
+	pthread_mutex_lock(&g_registry_lock);
+	if (c->prev)
+		c->prev->next = c->next;
+	else
+		g_registry = c->next;
+	if (c->next)
+		c->next->prev = c->prev;
+	g_stats.allocs += c->allocs;
+	g_stats.frees += c->frees;
+	pthread_mutex_unlock(&g_registry_lock);
+
+	free(c);
+	t_cache = NULL;
+}
+
+static void make_key(void)
+{
+	pthread_key_create(&g_key, thread_cache_destroy);
+}
+
+static struct ThreadCache *get_cache(void)
+{
+	struct ThreadCache *c = t_cache;
+	if (c)
+		return c;
+
+	pthread_once(&g_once, make_key);
+	c = (struct ThreadCache *)calloc(1, sizeof(*c));
+	if (!c)
+		return NULL;
+
+	pthread_mutex_lock(&g_registry_lock);
+	c->next = g_registry;
+	if (g_registry)
+		g_registry->prev = c;
+	g_registry = c;
+	pthread_mutex_unlock(&g_registry_lock);
+
+	pthread_setspecific(g_key, c);
+	t_cache = c;
+	return c;
+}
+
+/*
+ * 映射一个新的slab并切分到线程缓存中
+ * return：0 on success，-1 on fail
+ */
+static int new_slab(struct ThreadCache *c, int cls)
+{
+	size_t stride = sizeof(struct BufferHdr) + g_class_size[cls];
+	size_t i, n = BUFFER_SLAB_SIZE / stride;
+	char *mem = MAP_FAILED;
+	int huge = 0;
+
+#ifdef MAP_HUGETLB
+	if (g_hugepage)
+	{
+		mem = (char *)mmap(NULL, BUFFER_SLAB_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		huge = (mem != MAP_FAILED);
+	}
+#endif
+
+	if (mem == MAP_FAILED)
+	{
+		mem = (char *)mmap(NULL, BUFFER_SLAB_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (mem == MAP_FAILED)
+			return -1;
+#ifdef MADV_HUGEPAGE
+		if (g_hugepage)
+			madvise(mem, BUFFER_SLAB_SIZE, MADV_HUGEPAGE);
+#endif
+	}
+
+	for (i=0; i<n; i++)
+	{
+		struct BufferHdr *h = (struct BufferHdr *)(mem + i * stride);
+		h->cls = cls;
+		h->size = g_class_size[cls];
+		h->next = c->head[cls];
+		c->head[cls] = h;
+	}
+	c->count[cls] += n;
+
+	STAT_ADD(slabs, 1);
+	STAT_ADD(mapped_bytes, BUFFER_SLAB_SIZE);
+	if (huge)
+		STAT_ADD(hugepage_slabs, 1);
+	return 0;
+}
+
+/*
+ * 设置新建slab是否使用大页
+ */
+void BufferPoolSetHugepage(int on)
+{
+	g_hugepage = !!on;
+}
+
+/*
+ * 分配缓存，引用计数为1
+ * return：buffer on success，NULL on fail
+ */
+void *BufferAlloc(size_t size)
+{
+	struct ThreadCache *c;
+	struct BufferHdr *h;
+	int cls = size_to_class(size);
+
+	if (cls == BUFFER_OVERSIZE)
+	{
+		h = (struct BufferHdr *)malloc(sizeof(struct BufferHdr) + size);
+		if (!h)
+			return NULL;
+		h->cls = BUFFER_OVERSIZE;
+		h->size = size;
+		h->ref = 1;
+		STAT_ADD(oversize, 1);
+		return DATA(h);
+	}
+
+	c = get_cache();
+	if (!c)
+		return NULL;
+
+	if (!c->head[cls])
+	{
+		h = pop_batch(cls);
+		if (h)
+		{
+			c->head[cls] = h;
+			for (; h; h = h->next)
+				c->count[cls]++;
+			STAT_ADD(refills, 1);
+		}
+		else if (new_slab(c, cls) < 0)
+		{
+			return NULL;
+		}
+	}
+
+	h = c->head[cls];
+	c->head[cls] = h->next;
+	c->count[cls]--;
+	h->next = NULL;
+	h->ref = 1;
+	c->allocs++;
+	return DATA(h);
+}
+
+/*
+ * 增加引用计数
+ */
+void BufferRef(void *buf)
+{
+	__atomic_fetch_add(&HDR(buf)->ref, 1, __ATOMIC_RELAXED);
+}
+
+/*
+ * 减少引用计数，减为0时归还到当前线程缓存
+ */
+void BufferFree(void *buf)
+{
+	struct ThreadCache *c;
+	struct BufferHdr *h;
+
+	if (!buf)
+		return;
+
+	h = HDR(buf);
+	if (__atomic_sub_fetch(&h->ref, 1, __ATOMIC_ACQ_REL) != 0)
+		return;
+
+	if (h->cls == BUFFER_OVERSIZE)
+	{
+		free(h);
+		return;
+	}
+
+	c = get_cache();
+	if (!c) // 无法创建线程缓存，直接归还全局链表
+	{
+		h->next = NULL;
+		push_batch(h->cls, h);
+		return;
+	}
+
+	h->next = c->head[h->cls];
+	c->head[h->cls] = h;
+	c->count[h->cls]++;
+	c->frees++;
+
+	if (c->count[h->cls] >= 2 * BUFFER_BATCH)
+		spill(c, h->cls, BUFFER_BATCH);
+}
+
+/*
+ * 获取缓存的实际容量
+ */
+size_t BufferSize(const void *buf)
+{
+	return HDR(buf)->size;
+}
+
+/*
+ * 获取缓存池统计信息
+ */
+void BufferPoolStats(struct BufferStats *stats)
+{
+	struct ThreadCache *c;
+
+	if (!stats)
+		return;
+
+	pthread_mutex_lock(&g_registry_lock);
+	stats->allocs = g_stats.allocs;
+	stats->frees = g_stats.frees;
+	for (c = g_registry; c; c = c->next)
+	{
+		stats->allocs += c->allocs;
+		stats->frees += c->frees;
+	}
+	pthread_mutex_unlock(&g_registry_lock);
+
+	stats->refills = __atomic_load_n(&g_stats.refills, __ATOMIC_RELAXED);
+	stats->spills = __atomic_load_n(&g_stats.spills, __ATOMIC_RELAXED);
+	stats->slabs = __atomic_load_n(&g_stats.slabs, __ATOMIC_RELAXED);
+	stats->hugepage_slabs = __atomic_load_n(&g_stats.hugepage_slabs, __ATOMIC_RELAXED);
+	stats->mapped_bytes = __atomic_load_n(&g_stats.mapped_bytes, __ATOMIC_RELAXED);
+	stats->oversize = __atomic_load_n(&g_stats.oversize, __ATOMIC_RELAXED);
+}
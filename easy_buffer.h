@@ -0,0 +1,73 @@
+/*
+ * 收发缓存池: C接口方式
+ * Copyright FreeCode. All Rights Reserved.
+ * MIT License (https://opensource.org/licenses/MIT)
+ * 2024 by liuqingshuige
+ */
+#ifndef __FREE_EASY_BUFFER_H__
+#define __FREE_EASY_BUFFER_H__
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * 缓存池统计信息
+ */
+struct BufferStats
+{
+	unsigned long long allocs;          /* 分配次数 */
+	unsigned long long frees;           /* 归还次数（引用计数减为0） */
+	unsigned long long refills;         /* 线程缓存从全局链表取回一批缓存的次数 */
+	unsigned long long spills;          /* 线程缓存向全局链表归还一批缓存的次数 */
+	unsigned long long slabs;           /* 已映射的slab数 */
+	unsigned long long hugepage_slabs;  /* 其中使用大页的slab数 */
+	unsigned long long mapped_bytes;    /* 已映射的内存大小，单位字节 */
+	unsigned long long oversize;        /* 超过最大尺寸而直接malloc的次数 */
+};
+
+/*
+ * 设置新建slab是否使用大页(MAP_HUGETLB)，大页不可用时退化为普通页并建议透明大页
+ * on：0：不使用，1：使用
+ */
+void BufferPoolSetHugepage(int on);
+
+/*
+ * 分配缓存，引用计数为1
+ * 尺寸按256/1K/2K/4K/16K/64K分级，从当前线程缓存中取，线程缓存为空时从全局无锁链表整批补充，
+ * 稳定运行时不调用malloc；超过64KB时直接malloc
+ * size：需要的大小，单位字节
+ * return：buffer on success，NULL on fail
+ */
+void *BufferAlloc(size_t size);
+
+/*
+ * 增加引用计数，可在多个线程间共享同一缓存
+ * buf：BufferAlloc返回的缓存
+ */
+void BufferRef(void *buf);
+
+/*
+ * 减少引用计数，减为0时归还到当前线程缓存，可在任意线程中调用
+ * buf：BufferAlloc返回的缓存，可为NULL
+ */
+void BufferFree(void *buf);
+
+/*
+ * 获取缓存的实际容量，不小于分配时的size
+ * return：容量，单位字节
+ */
+size_t BufferSize(const void *buf);
+
+/*
+ * 获取缓存池统计信息
+ */
+void BufferPoolStats(struct BufferStats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
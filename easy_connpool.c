@@ -0,0 +1,351 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* POLLRDHUP */
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "easy_socket.h"
+#include "easy_connpool.h"
+#include "easy_timer.h"
+
+#define CONNPOOL_INIT_FDS 1024
+
+struct IdleConn
+{
+	int sockfd;
+	long long since; /* 归还时间，单调时钟ms */
+};
+
+struct ConnKey
+{
+	char *host;
+	char *service;
+	int nactive;             /* 已借出的连接数 */
+	int nidle;
+	struct IdleConn *idle;   /* 空闲连接栈，栈顶为最近归还的连接 */
+	struct ConnKey *next;
+};
+
+struct ConnPool
+{
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	int max_idle;
+	int max_active;
+	unsigned int idle_timeout;
+	unsigned int connect_timeout;
+	struct ConnKey *keys;
+	struct ConnKey **owner;  /* 以fd为下标，记录已借出连接所属的分组 */
+	int nowner;
+};
+
+static int same_str(const char *a, const char *b)
+{
+	return !strcmp(a ? a : "", b ? b : "");
+}
+
+/*
+ * 检查空闲连接是否可用：对端关闭、出错或者收到了未预期的数据均视为不可用
+ * return：1 可用，0 不可用
+ */
+static int conn_alive(int sockfd)
+{
+	struct pollfd pfd;
+
+	pfd.fd = sockfd;
+	pfd.events = POLLIN | POLLRDHUP;
+	pfd.revents = 0;
+	if (poll(&pfd, 1, 0) < 0)
+		return 0;
+	return pfd.revents == 0;
+}
+
+/*
+ * 查找或创建分组，调用者持有锁
+ */
+static struct ConnKey *find_key(ConnPool *pool, const char *host, const char *service)
+{
+	struct ConnKey *k;
+
+	for (k = pool->keys; k; k = k->next)
+	{
+		if (same_str(k->host, host) && same_str(k->service, service))
+			return k;
+	}
+
+	k = (struct ConnKey *)calloc(1, sizeof(*k));
+	if (!k)
+		return NULL;
+
+	k->host = strdup(host ? host : "");
+	k->service = strdup(service ? service : "");
+	k->idle = (struct IdleConn *)calloc(pool->max_idle > 0 ? pool->max_idle : 1, sizeof(struct IdleConn));
+	if (!k->host || !k->service || !k->idle)
+	{
+		free(k->host);
+		free(k->service);
+		free(k->idle);
+		free(k);
+		return NULL;
+	}
+
+	k->next = pool->keys;
+	pool->keys = k;
+	return k;
+}
+
+/*
+ * 关闭分组中超时的空闲连接（位于栈底），调用者持有锁
+ * return：关闭的连接数
+ */
+static int evict_key(ConnPool *pool, struct ConnKey *k, long long now)
+{
+	int i, n = 0;
+
+	if (pool->idle_timeout == 0)
+		return 0;
+
+	while (n < k->nidle && now - k->idle[n].since >= pool->idle_timeout)
+	{
+		CloseSocket(k->idle[n].sockfd);
+		n++;
+	}
+
+	if (n > 0)
+	{
+		for (i=n; i<k->nidle; i++)
+			k->idle[i - n] = k->idle[i];
+		k->nidle -= n;
+	}
+	return n;
+}
+
+/*
+ * 记录已借出连接所属的分组，调用者持有锁
+ */
+static int set_owner(ConnPool *pool, int sockfd, struct ConnKey *k)
+{
+	if (sockfd >= pool->nowner)
+	{
+		int n = pool->nowner;
+		struct ConnKey **ptr;
+
+		while (n <= sockfd)
+			n *= 2;
+
+		ptr = (struct ConnKey **)realloc(pool->owner, n * sizeof(*ptr));
+		if (!ptr)
+			return -1;
+
+		memset(ptr + pool->nowner, 0, (n - pool->nowner) * sizeof(*ptr));
+		pool->owner = ptr;
+		pool->nowner = n;
+	}
+	pool->owner[sockfd] = k;
+	return 0;
+}
+
+/*
+ * 创建连接池
+ * return：pool on success，NULL on fail
+ */
+ConnPool *ConnPoolCreate(int max_idle, int max_active, unsigned int idle_timeout, unsigned int connect_timeout)
+{
+	pthread_condattr_t attr;
+	ConnPool *pool = (ConnPool *)calloc(1, sizeof(*pool));
+	if (!pool)
+		return NULL;
+
+	pool->max_idle = (max_idle > 0) ? max_idle : 0;
+	pool->max_active = (max_active > 0) ? max_active : 0;
+	pool->idle_timeout = idle_timeout;
+	pool->connect_timeout = connect_timeout;
+	pool->nowner = CONNPOOL_INIT_FDS;
+	pool->owner = (struct ConnKey **)calloc(pool->nowner, sizeof(struct ConnKey *));
+	if (!pool->owner)
+	{
+		free(pool);
+		return NULL;
+	}
+
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&pool->cond, &attr);
+	pthread_condattr_destroy(&attr);
+	return pool;
+}
+
+/*
+ * 销毁连接池，关闭所有空闲连接
+ */
+void ConnPoolDestroy(ConnPool *pool)
+{
+	int i;
+	struct ConnKey *k, *next;
+
+	if (!pool)
+		return;
+
+	for (k = pool->keys; k; k = next)
+	{
+		next = k->next;
+		for (i=0; i<k->nidle; i++)
+			CloseSocket(k->idle[i].sockfd);
+		free(k->host);
+		free(k->service);
+		free(k->idle);
+		free(k);
+	}
+
+	pthread_cond_destroy(&pool->cond);
+	pthread_mutex_destroy(&pool->lock);
+	free(pool->owner);
+	free(pool);
+}
+
+/*
+ * 借出一个到host:service的连接
+ * return：sockfd on success，-1 on fail
+ */
+int ConnPoolGet(ConnPool *pool, const char *host, const char *service, int timeout)
+{
+	struct ConnKey *k;
+	struct timespec ts;
+	int sockfd = -1;
+
+	if (!pool)
+		return -1;
+
+	if (timeout > 0)
+	{
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		ts.tv_sec += timeout / 1000;
+		ts.tv_nsec += (timeout % 1000) * 1000000L;
+		if (ts.tv_nsec >= 1000000000L)
+		{
+			ts.tv_sec++;
+			ts.tv_nsec -= 1000000000L;
+		}
+	}
+
+	pthread_mutex_lock(&pool->lock);
+	k = find_key(pool, host, service);
+	if (!k)
+		goto fail_;
+
+	while (pool->max_active > 0 && k->nactive >= pool->max_active)
+	{
+		if (timeout == 0)
+		{
+			errno = EAGAIN;
+			goto fail_;
+		}
+
+		if (timeout < 0)
+			pthread_cond_wait(&pool->cond, &pool->lock);
+		else if (pthread_cond_timedwait(&pool->cond, &pool->lock, &ts) == ETIMEDOUT)
+		{
+			errno = ETIMEDOUT;
+			goto fail_;
+		}
+	}
+
+	evict_key(pool, k, TimerNow());
+	while (k->nidle > 0)
+	{
+		sockfd = k->idle[--k->nidle].sockfd;
+		if (conn_alive(sockfd))
+			break;
+		CloseSocket(sockfd);
+		sockfd = -1;
+	}
+
+	k->nactive++; // 先占位，新建连接时不持有锁
+	pthread_mutex_unlock(&pool->lock);
+
+	if (sockfd < 0)
+		sockfd = TcpConnectSocket(host, service, pool->connect_timeout);
+
+	pthread_mutex_lock(&pool->lock);
+	if (sockfd < 0 || set_owner(pool, sockfd, k) < 0)
+	{
+		k->nactive--;
+		pthread_cond_broadcast(&pool->cond); // 各分组共用条件变量
+		CloseSocket(sockfd);
+		sockfd = -1;
+	}
+	pthread_mutex_unlock(&pool->lock);
+	return sockfd;
+
+fail_:
+	pthread_mutex_unlock(&pool->lock);
+	return -1;
+}
+
+/*
+ * 归还连接
+ * return：0 on success，-1 on fail
+ */
+int ConnPoolPut(ConnPool *pool, int sockfd, int reuse)
+{
+	struct ConnKey *k;
+	long long now = TimerNow();
+
+	if (!pool || sockfd < 0)
+		return -1;
+
+	pthread_mutex_lock(&pool->lock);
+	if (sockfd >= pool->nowner || (k = pool->owner[sockfd]) == NULL)
+	{
+		pthread_mutex_unlock(&pool->lock);
+		errno = EBADF;
+		return -1;
+	}
+
+	pool->owner[sockfd] = NULL;
+	k->nactive--;
+	evict_key(pool, k, now);
+
+	if (reuse && k->nidle < pool->max_idle)
+	{
+		k->idle[k->nidle].sockfd = sockfd;
+		k->idle[k->nidle].since = now;
+		k->nidle++;
+	}
+	else
+	{
+		CloseSocket(sockfd);
+	}
+
+	pthread_cond_broadcast(&pool->cond); // 各分组共用条件变量
+	pthread_mutex_unlock(&pool->lock);
+	return 0;
+}
+
+/*
+ * 关闭所有超过idle_timeout的空闲连接
+ * return：关闭的连接数
+ */
+int ConnPoolEvict(ConnPool *pool)
+{
+	struct ConnKey *k;
+	long long now = TimerNow();
+	int n = 0;
+
+	if (!pool)
+		return 0;
+
+	pthread_mutex_lock(&pool->lock);
+	for (k = pool->keys; k; k = k->next)
+		n += evict_key(pool, k, now);
+	pthread_mutex_unlock(&pool->lock);
+	return n;
+}
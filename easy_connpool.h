@@ -0,0 +1,59 @@
+/*
+ * TCP连接池封装: C接口方式
+ * Copyright FreeCode. All Rights Reserved.
+ * MIT License (https://opensource.org/licenses/MIT)
+ * 2024 by liuqingshuige
+ */
+#ifndef __FREE_EASY_CONNPOOL_H__
+#define __FREE_EASY_CONNPOOL_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct ConnPool ConnPool;
+
+/*
+ * 创建连接池，连接按host:service分组
+ * max_idle：每组最多保留的空闲连接数
+ * max_active：每组最多同时借出的连接数，<=0表示不限制
+ * idle_timeout：空闲连接的最长保留时间(ms)，为0表示不限制
+ * connect_timeout：新建连接的超时时间(ms)
+ * return：pool on success，NULL on fail
+ */
+ConnPool *ConnPoolCreate(int max_idle, int max_active, unsigned int idle_timeout, unsigned int connect_timeout);
+
+/*
+ * 销毁连接池，关闭所有空闲连接，已借出的连接由使用者关闭
+ */
+void ConnPoolDestroy(ConnPool *pool);
+
+/*
+ * 借出一个到host:service的连接，优先复用最近归还的空闲连接，
+ * 复用前检查连接是否已被对端关闭(POLLRDHUP)，无可用连接时新建
+ * host：主机名、域名或者点分十进制IP地址、或者IPv6的16进制串
+ * service：端口或者服务名如ftp、ntp等
+ * timeout：借出的连接数达到max_active时的等待时间(ms)，0表示不等待，-1表示一直等待
+ * return：sockfd（非阻塞） on success，-1 on fail
+ */
+int ConnPoolGet(ConnPool *pool, const char *host, const char *service, int timeout);
+
+/*
+ * 归还连接
+ * sockfd：ConnPoolGet返回的套接字
+ * reuse：0：连接已不可用，直接关闭，1：放回空闲队列
+ * return：0 on success，-1 on fail（sockfd不属于该连接池）
+ */
+int ConnPoolPut(ConnPool *pool, int sockfd, int reuse);
+
+/*
+ * 关闭所有超过idle_timeout的空闲连接
+ * return：关闭的连接数
+ */
+int ConnPoolEvict(ConnPool *pool);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,380 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <string.h>
+#include <errno.h>
+#include <stdint.h>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+#include "easy_event.h"
+
+#define EVENT_DEFAULT_MAXEVENTS 256
+#define EVENT_INIT_HANDLERS 1024
+
+struct EventHandler
+{
+	int used;
+	int events;
+	EventCallback on_read;
+	EventCallback on_write;
+	void *arg;
+};
+
+/* 跨线程投递的任务 */
+struct EventPost
+{
+	struct EventPost *next;
+	EventTask fn;
+	void *arg;
+};
+
+struct EventLoop
+{
+	int epfd;
+	int wakefd; /* 用于跨线程唤醒epoll_wait */
+	volatile int stop;
+	int maxevents;
+	struct epoll_event *events;
+	struct EventHandler *handlers; /* 以fd为下标 */
+	int nhandlers;
+	struct EventPost *posts;       /* 投递任务栈，生产者CAS压入，事件循环整体取走 */
+};
+
+static unsigned int events_to_epoll(int events)
+{
+	unsigned int ev = EPOLLET | EPOLLRDHUP;
+	if (events & EV_READ)
+		ev |= EPOLLIN;
+	if (events & EV_WRITE)
+		ev |= EPOLLOUT;
+	return ev;
+}
+
+/*
+ * 确保handlers数组能容纳fd
+ */
+static int reserve_handlers(EventLoop *loop, int fd)
+{
+	int n = loop->nhandlers;
+	struct EventHandler *ptr;
+
+	if (fd < n)
+		return 0;
+
+	while (n <= fd)
+		n *= 2;
+
+	ptr = (struct EventHandler *)realloc(loop->handlers, n * sizeof(*ptr));
+	if (!ptr)
+		return -1;
+
+	memset(ptr + loop->nhandlers, 0, (n - loop->nhandlers) * sizeof(*ptr));
+	loop->handlers = ptr;
+	loop->nhandlers = n;
+	return 0;
+}
+
+/*
+ * 创建事件循环
+ * maxevents：每次epoll_wait最多返回的事件数，<=0则取默认值
+ * return：loop on success，NULL on fail
+ */
+EventLoop *EventLoopCreate(int maxevents)
+{
+	struct epoll_event ev;
+	EventLoop *loop = (EventLoop *)calloc(1, sizeof(*loop));
+	if (!loop)
+		return NULL;
+
+	loop->epfd = -1;
+	loop->wakefd = -1;
+	loop->maxevents = (maxevents > 0) ? maxevents : EVENT_DEFAULT_MAXEVENTS;
+	loop->nhandlers = EVENT_INIT_HANDLERS;
+	loop->events = (struct epoll_event *)calloc(loop->maxevents, sizeof(struct epoll_event));
+	loop->handlers = (struct EventHandler *)calloc(loop->nhandlers, sizeof(struct EventHandler));
+	if (!loop->events || !loop->handlers)
+		goto fail_;
+
+	loop->epfd = epoll_create1(EPOLL_CLOEXEC);
+	if (loop->epfd < 0)
+		goto fail_;
+
+	loop->wakefd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (loop->wakefd < 0)
+		goto fail_;
+
+	memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN;
+	ev.data.fd = loop->wakefd;
+	if (epoll_ctl(loop->epfd, EPOLL_CTL_ADD, loop->wakefd, &ev) < 0)
+		goto fail_;
+
+	return loop;
+
+fail_:
+	EventLoopDestroy(loop);
+	return NULL;
+}
+
+static void run_posts(EventLoop *loop);
+
+/*
+ * 销毁事件循环，不会关闭已注册的描述符
+ */
+void EventLoopDestroy(EventLoop *loop)
+{
+	if (!loop)
+		return;
+
+	/* 未执行的投递任务在此执行，任务可能持有资源（如发送队列的引用），丢弃会泄漏 */
+	while (__atomic_load_n(&loop->posts, __ATOMIC_ACQUIRE))
+		run_posts(loop);
+
+	if (loop->wakefd >= 0)
+		close(loop->wakefd);
+	if (loop->epfd >= 0)
+		close(loop->epfd);
+	free(loop->events);
+	free(loop->handlers);
+	free(loop);
+}
+
+/*
+ * 注册描述符，描述符会被设置为非阻塞
+ * return：0 on success，-1 on fail
+ */
+int EventLoopAdd(EventLoop *loop, int fd, int events, EventCallback on_read, EventCallback on_write, void *arg)
+{
+	int flag;
+	struct epoll_event ev;
+	struct EventHandler *h;
+
+	if (!loop || fd < 0)
+	{
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (reserve_handlers(loop, fd) < 0)
+		return -1;
+
+	h = &loop->handlers[fd];
+	if (h->used)
+	{
+		errno = EEXIST;
+		return -1;
+	}
+
+	flag = fcntl(fd, F_GETFL, 0);
+	if (flag == -1 || fcntl(fd, F_SETFL, flag | O_NONBLOCK) == -1)
+		return -1;
+
+	memset(&ev, 0, sizeof(ev));
+	ev.events = events_to_epoll(events);
+	ev.data.fd = fd;
+	if (epoll_ctl(loop->epfd, EPOLL_CTL_ADD, fd, &ev) < 0)
+		return -1;
+
+	h->used = 1;
+	h->events = events;
+	h->on_read = on_read;
+	h->on_write = on_write;
+	h->arg = arg;
+	return 0;
+}
+
+/*
+ * 修改已注册描述符关注的事件
+ * return：0 on success，-1 on fail
+ */
+int EventLoopModify(EventLoop *loop, int fd, int events)
+{
+	struct epoll_event ev;
+
+	if (!loop || fd < 0 || fd >= loop->nhandlers || !loop->handlers[fd].used)
+	{
+		errno = ENOENT;
+		return -1;
+	}
+
+	memset(&ev, 0, sizeof(ev));
+	ev.events = events_to_epoll(events);
+	ev.data.fd = fd;
+	if (epoll_ctl(loop->epfd, EPOLL_CTL_MOD, fd, &ev) < 0)
+		return -1;
+
+	loop->handlers[fd].events = events;
+	return 0;
+}
+
+/*
+ * 注销描述符，可在回调中调用
+ * return：0 on success，-1 on fail
+ */
+int EventLoopDel(EventLoop *loop, int fd)
+{
+	if (!loop || fd < 0 || fd >= loop->nhandlers || !loop->handlers[fd].used)
+	{
+		errno = ENOENT;
+		return -1;
+	}
+
+	memset(&loop->handlers[fd], 0, sizeof(struct EventHandler));
+	/* 描述符可能已被关闭，忽略错误 */
+	epoll_ctl(loop->epfd, EPOLL_CTL_DEL, fd, NULL);
+	return 0;
+}
+
+/*
+ * 执行投递的任务，按投递顺序
+ */
+static void run_posts(EventLoop *loop)
+{
+	struct EventPost *p, *prev = NULL, *next;
+
+	p = __atomic_exchange_n(&loop->posts, NULL, __ATOMIC_ACQUIRE);
+	if (!p)
+		return;
+
+	/* 栈是后进先出，反转为投递顺序 */
+	while (p)
+	{
+		next = p->next;
+		p->next = prev;
+		prev = p;
+		p = next;
+	}
+
+	for (p = prev; p; p = next)
+	{
+		next = p->next;
+		p->fn(loop, p->arg);
+		free(p);
+	}
+}
+
+/*
+ * 投递任务到事件循环线程
+ * return：0 on success，-1 on fail
+ */
+int EventLoopPost(EventLoop *loop, EventTask fn, void *arg)
+{
+	struct EventPost *p, *head;
+	uint64_t one = 1;
+
+	if (!loop || !fn)
+	{
+		errno = EINVAL;
+		return -1;
+	}
+
+	p = (struct EventPost *)malloc(sizeof(*p));
+	if (!p)
+		return -1;
+	p->fn = fn;
+	p->arg = arg;
+
+	head = __atomic_load_n(&loop->posts, __ATOMIC_RELAXED);
+	do
+	{
+		p->next = head;
+	} while (!__atomic_compare_exchange_n(&loop->posts, &head, p, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+
+	/* 栈原来非空时事件循环已被唤醒，还未取走任务 */
+	if (!head && write(loop->wakefd, &one, sizeof(one)) < 0)
+	{
+		/* 计数溢出时eventfd已处于可读状态，无需处理 */
+	}
+	return 0;
+}
+
+/*
+ * 执行一次事件分发
+ * timeout：等待时间(ms)，-1表示一直等待
+ * return：本次处理的事件数，-1 on fail
+ */
+int EventLoopRunOnce(EventLoop *loop, int timeout)
+{
+	int i, n, fd, events;
+	uint64_t val;
+	struct EventHandler *h;
+
+	n = epoll_wait(loop->epfd, loop->events, loop->maxevents, timeout);
+	if (n < 0)
+	{
+		return (errno == EINTR) ? 0 : -1;
+	}
+
+	for (i=0; i<n; i++)
+	{
+		fd = loop->events[i].data.fd;
+		if (fd == loop->wakefd)
+		{
+			while (read(fd, &val, sizeof(val)) > 0)
+				;
+			continue;
+		}
+
+		events = 0;
+		if (loop->events[i].events & (EPOLLIN | EPOLLRDHUP))
+			events |= EV_READ;
+		if (loop->events[i].events & EPOLLOUT)
+			events |= EV_WRITE;
+		if (loop->events[i].events & (EPOLLERR | EPOLLHUP | EPOLLRDHUP))
+			events |= EV_ERROR;
+
+		/* 每次都重新查表：前面的回调可能已经注销了该fd */
+		if (fd >= loop->nhandlers || !loop->handlers[fd].used)
+			continue;
+
+		h = &loop->handlers[fd];
+		if ((events & (EV_READ | EV_ERROR)) && h->on_read)
+		{
+			h->on_read(loop, fd, events, h->arg);
+		}
+
+		if (fd >= loop->nhandlers || !loop->handlers[fd].used)
+			continue;
+
+		h = &loop->handlers[fd];
+		if ((events & EV_WRITE) || ((events & EV_ERROR) && !h->on_read))
+		{
+			if (h->on_write)
+				h->on_write(loop, fd, events, h->arg);
+		}
+	}
+
+	run_posts(loop);
+	return n;
+}
+
+/*
+ * 循环分发事件，直到EventLoopStop被调用
+ * return：0 on normal exit，-1 on fail
+ */
+int EventLoopRun(EventLoop *loop)
+{
+	while (!loop->stop)
+	{
+		if (EventLoopRunOnce(loop, -1) < 0)
+			return -1;
+	}
+	loop->stop = 0;
+	return 0;
+}
+
+/*
+ * 停止事件循环，可在任意线程中调用
+ */
+void EventLoopStop(EventLoop *loop)
+{
+	uint64_t one = 1;
+	loop->stop = 1;
+	if (write(loop->wakefd, &one, sizeof(one)) < 0)
+	{
+		/* 计数溢出时eventfd已处于可读状态，无需处理 */
+	}
+}
@@ -0,0 +1,105 @@
+/*
+ * epoll事件循环封装: C接口方式
+ * Copyright FreeCode. All Rights Reserved.
+ * MIT License (https://opensource.org/licenses/MIT)
+ * 2024 by liuqingshuige
+ */
+#ifndef __FREE_EASY_EVENT_H__
+#define __FREE_EASY_EVENT_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 关注的事件 */
+#define EV_READ    0x01
+#define EV_WRITE   0x02
+#define EV_ERROR   0x04 /* 仅作为回调参数：对端关闭或套接字出错 */
+
+typedef struct EventLoop EventLoop;
+
+/*
+ * 事件回调
+ * loop：所属事件循环
+ * fd：就绪的描述符
+ * events：就绪的事件，EV_READ/EV_WRITE/EV_ERROR组合
+ * arg：注册时传入的用户参数
+ * 注意：采用边沿触发(EPOLLET)，回调中须一直读写到EAGAIN为止，
+ * 例如以timeout为0调用TcpRecvSocket/UdpRecvSocket直到返回不足或-1
+ */
+typedef void (*EventCallback)(EventLoop *loop, int fd, int events, void *arg);
+
+/*
+ * 投递到事件循环线程执行的任务
+ * loop：所属事件循环
+ * arg：投递时传入的用户参数
+ */
+typedef void (*EventTask)(EventLoop *loop, void *arg);
+
+/*
+ * 创建事件循环
+ * maxevents：每次epoll_wait最多返回的事件数，<=0则取默认值
+ * return：loop on success，NULL on fail
+ */
+EventLoop *EventLoopCreate(int maxevents);
+
+/*
+ * 销毁事件循环，不会关闭已注册的描述符；先在调用线程中执行尚未执行的投递任务
+ */
+void EventLoopDestroy(EventLoop *loop);
+
+/*
+ * 注册描述符，描述符会被设置为非阻塞
+ * fd：待注册的描述符，如TcpListenSocket/UdpListenSocket/TcpConnectSocket返回的套接字
+ * events：EV_READ/EV_WRITE组合
+ * on_read：可读回调，可为NULL
+ * on_write：可写回调，可为NULL
+ * arg：用户参数
+ * return：0 on success，-1 on fail
+ */
+int EventLoopAdd(EventLoop *loop, int fd, int events, EventCallback on_read, EventCallback on_write, void *arg);
+
+/*
+ * 修改已注册描述符关注的事件
+ * return：0 on success，-1 on fail
+ */
+int EventLoopModify(EventLoop *loop, int fd, int events);
+
+/*
+ * 注销描述符，可在回调中调用
+ * return：0 on success，-1 on fail
+ */
+int EventLoopDel(EventLoop *loop, int fd);
+
+/*
+ * 执行一次事件分发
+ * timeout：等待时间(ms)，-1表示一直等待
+ * return：本次处理的事件数，-1 on fail
+ */
+int EventLoopRunOnce(EventLoop *loop, int timeout);
+
+/*
+ * 循环分发事件，直到EventLoopStop被调用
+ * return：0 on normal exit，-1 on fail
+ */
+int EventLoopRun(EventLoop *loop);
+
+/*
+ * 停止事件循环，可在任意线程中调用
+ */
+void EventLoopStop(EventLoop *loop);
+
+/*
+ * 投递任务到事件循环线程，在本轮事件分发之后按投递顺序执行，可在任意线程中调用
+ * 投递不加锁，只在任务栈为空时唤醒一次epoll_wait；事件循环销毁时未执行的任务由EventLoopDestroy执行
+ * fn：任务函数
+ * arg：用户参数
+ * return：0 on success，-1 on fail
+ */
+int EventLoopPost(EventLoop *loop, EventTask fn, void *arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,266 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include "easy_socket.h"
+#include "easy_frame.h"
+
+#define FRAME_DEFAULT_MAX (64 * 1024)
+
+struct FrameConn
+{
+	int sockfd;
+	int width;
+	int endian;
+	size_t max_frame;
+	size_t bufsize;
+	char *rbuf;
+	size_t rpos;   /* 下一帧的起始位置 */
+	size_t rend;   /* 已读入数据的结束位置 */
+	char *wbuf;
+	size_t wlen;   /* 待发送数据长度 */
+};
+
+static size_t decode_len(const FrameConn *conn, const unsigned char *p)
+{
+	size_t len = 0;
+	int i;
+
+	if (conn->endian == FRAME_LITTLE_ENDIAN)
+	{
+		for (i=conn->width-1; i>=0; i--)
+			len = (len << 8) | p[i];
+	}
+	else
+	{
+		for (i=0; i<conn->width; i++)
+			len = (len << 8) | p[i];
+	}
+	return len;
+}
+
+static void encode_len(const FrameConn *conn, unsigned char *p, size_t len)
+{
+	int i;
+
+	if (conn->endian == FRAME_LITTLE_ENDIAN)
+	{
+		for (i=0; i<conn->width; i++, len >>= 8)
+			p[i] = len & 0xff;
+	}
+	else
+	{
+		for (i=conn->width-1; i>=0; i--, len >>= 8)
+			p[i] = len & 0xff;
+	}
+}
+
+/*
+ * 创建分帧连接
+ * return：conn on success，NULL on fail
+ */
+FrameConn *FrameConnCreate(int sockfd, int width, int endian, size_t max_frame, size_t bufsize)
+{
+	FrameConn *conn;
+
+	if (width != 1 && width != 2 && width != 4)
+	{
+		errno = EINVAL;
+		return NULL;
+	}
+
+	if (max_frame == 0)
+		max_frame = FRAME_DEFAULT_MAX;
+	if (width < 4 && max_frame > ((size_t)1 << (8 * width)) - 1)
+		max_frame = ((size_t)1 << (8 * width)) - 1;
+	if (bufsize == 0)
+		bufsize = 2 * (max_frame + width);
+	if (bufsize < max_frame + width)
+	{
+		errno = EINVAL;
+		return NULL;
+	}
+
+	conn = (FrameConn *)calloc(1, sizeof(*conn));
+	if (!conn)
+		return NULL;
+
+	conn->sockfd = sockfd;
+	conn->width = width;
+	conn->endian = endian;
+	conn->max_frame = max_frame;
+	conn->bufsize = bufsize;
+	conn->rbuf = (char *)malloc(bufsize);
+	conn->wbuf = (char *)malloc(bufsize);
+	if (!conn->rbuf || !conn->wbuf)
+	{
+		FrameConnDestroy(conn);
+		return NULL;
+	}
+	return conn;
+}
+
+/*
+ * 销毁分帧连接
+ */
+void FrameConnDestroy(FrameConn *conn)
+{
+	if (!conn)
+		return;
+
+	free(conn->rbuf);
+	free(conn->wbuf);
+	free(conn);
+}
+
+/*
+ * 从缓存中解析一帧
+ * return：1 读到一帧，0 数据不足，-1 帧长度非法
+ */
+static int parse_frame(FrameConn *conn, const void **data, size_t *len)
+{
+	size_t avail = conn->rend - conn->rpos;
+	size_t flen;
+
+	if (avail < (size_t)conn->width)
+		return 0;
+
+	flen = decode_len(conn, (const unsigned char *)conn->rbuf + conn->rpos);
+	if (flen > conn->max_frame)
+	{
+		errno = EMSGSIZE;
+		return -1;
+	}
+
+	if (avail < conn->width + flen)
+		return 0;
+
+	*data = conn->rbuf + conn->rpos + conn->width;
+	*len = flen;
+	conn->rpos += conn->width + flen;
+	return 1;
+}
+
+/*
+ * 读取一个完整的帧
+ * return：1 读到一帧，0 超时或暂无完整帧，-1 出错
+ */
+int FrameRead(FrameConn *conn, const void **data, size_t *len, int timeout)
+{
+	struct pollfd pfd;
+	ssize_t n;
+	int ret;
+
+	while (1)
+	{
+		ret = parse_frame(conn, data, len);
+		if (ret != 0)
+			return ret;
+
+		/* 剩余空间放不下最大帧时，将不完整的帧移到缓存头部 */
+		if (conn->rpos == conn->rend)
+		{
+			conn->rpos = conn->rend = 0;
+		}
+		else if (conn->bufsize - conn->rpos < conn->max_frame + conn->width)
+		{
+			memmove(conn->rbuf, conn->rbuf + conn->rpos, conn->rend - conn->rpos);
+			conn->rend -= conn->rpos;
+			conn->rpos = 0;
+		}
+
+		n = recv(conn->sockfd, conn->rbuf + conn->rend, conn->bufsize - conn->rend, MSG_DONTWAIT);
+		if (n > 0)
+		{
+			conn->rend += n;
+			continue;
+		}
+
+		if (n == 0) // 对端关闭
+			return -1;
+
+		if (errno == EINTR)
+			continue;
+		if (errno != EAGAIN && errno != EWOULDBLOCK)
+			return -1;
+
+		if (timeout == 0)
+			return 0;
+
+		pfd.fd = conn->sockfd;
+		pfd.events = POLLIN;
+		pfd.revents = 0;
+		ret = poll(&pfd, 1, timeout);
+		if (ret <= 0)
+			return (ret == 0 || errno == EINTR) ? 0 : -1;
+	}
+}
+
+/*
+ * 发送缓存中所有的帧
+ * return：0 on success，-1 on failed
+ */
+int FrameFlush(FrameConn *conn, int timeout)
+{
+	int ret;
+
+	if (conn->wlen == 0)
+		return 0;
+
+	ret = TcpSendSocket(conn->sockfd, conn->wbuf, conn->wlen, timeout);
+	if (ret != (int)conn->wlen)
+	{
+		/* 部分发送的数据已无法撤回，连接应视为不可用 */
+		conn->wlen = 0;
+		return -1;
+	}
+
+	conn->wlen = 0;
+	return 0;
+}
+
+/*
+ * 写入一个帧到发送缓存
+ * return：0 on success，-1 on failed
+ */
+int FrameWrite(FrameConn *conn, const void *data, size_t len, int timeout)
+{
+	unsigned char hdr[4];
+	struct iovec iov[2];
+
+	if (len > conn->max_frame)
+	{
+		errno = EMSGSIZE;
+		return -1;
+	}
+
+	if (conn->wlen + conn->width + len > conn->bufsize)
+	{
+		if (FrameFlush(conn, timeout) < 0)
+			return -1;
+	}
+
+	/* 大帧不经过缓存，头部和数据一次writev发送 */
+	if (len >= conn->bufsize / 2)
+	{
+		encode_len(conn, hdr, len);
+		iov[0].iov_base = hdr;
+		iov[0].iov_len = conn->width;
+		iov[1].iov_base = (void *)data;
+		iov[1].iov_len = len;
+		if (FrameFlush(conn, timeout) < 0)
+			return -1;
+		return (TcpSendSocketv(conn->sockfd, iov, 2, timeout) == (int)(conn->width + len)) ? 0 : -1;
+	}
+
+	encode_len(conn, (unsigned char *)conn->wbuf + conn->wlen, len);
+	memcpy(conn->wbuf + conn->wlen + conn->width, data, len);
+	conn->wlen += conn->width + len;
+	return 0;
+}
@@ -0,0 +1,68 @@
+/*
+ * TCP长度前缀消息分帧: C接口方式
+ * Copyright FreeCode. All Rights Reserved.
+ * MIT License (https://opensource.org/licenses/MIT)
+ * 2024 by liuqingshuige
+ */
+#ifndef __FREE_EASY_FRAME_H__
+#define __FREE_EASY_FRAME_H__
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 长度字段字节序 */
+#define FRAME_BIG_ENDIAN     0
+#define FRAME_LITTLE_ENDIAN  1
+
+typedef struct FrameConn FrameConn;
+
+/*
+ * 创建分帧连接，每帧格式为：长度字段（不含自身）+ 数据
+ * sockfd：TCP套接字描述符，由调用者负责关闭
+ * width：长度字段宽度，1/2/4字节
+ * endian：FRAME_BIG_ENDIAN/FRAME_LITTLE_ENDIAN
+ * max_frame：允许的最大帧数据长度，超过视为协议错误，为0则取64KB
+ * bufsize：读写缓存大小，单位字节，应不小于max_frame+width，为0则取max_frame+width的2倍
+ * return：conn on success，NULL on fail
+ */
+FrameConn *FrameConnCreate(int sockfd, int width, int endian, size_t max_frame, size_t bufsize);
+
+/*
+ * 销毁分帧连接，未发送的数据被丢弃，可先调用FrameFlush
+ */
+void FrameConnDestroy(FrameConn *conn);
+
+/*
+ * 读取一个完整的帧，缓存中已有完整帧时不产生系统调用；
+ * 否则一次recv尽量多地预读，多个小帧只需一次系统调用
+ * data：保存帧数据的指针，指向内部缓存，不拷贝，下次调用FrameRead前有效
+ * len：保存帧数据长度
+ * timeout：缓存中没有完整帧时的等待时间(ms)，0表示不等待
+ * return：1 读到一帧，0 超时或暂无完整帧，-1 对端关闭、出错或帧长度超过max_frame
+ */
+int FrameRead(FrameConn *conn, const void **data, size_t *len, int timeout);
+
+/*
+ * 写入一个帧到发送缓存，缓存满时自动发送，多个小帧合并为一次send
+ * data：帧数据
+ * len：帧数据长度，不超过max_frame
+ * timeout：需要发送时的超时时间(ms)
+ * return：0 on success，-1 on failed
+ */
+int FrameWrite(FrameConn *conn, const void *data, size_t len, int timeout);
+
+/*
+ * 发送缓存中所有的帧
+ * timeout：超时时间(ms)
+ * return：0 on success，-1 on failed
+ */
+int FrameFlush(FrameConn *conn, int timeout);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,904 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include <sys/socket.h>
+#include <sys/eventfd.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+
+#include "easy_netif.h"
+
+#define NETIF_MAX_SUBSCRIBERS 16
+#define NETIF_BUFSIZE (32 * 1024)
+#define NETIF_RESYNC_MS 1000 /* 全量同步失败后的重试间隔 */
+
+struct NetifSubscriber
+{
+	NetifCallback cb;
+	void *arg;
+};
+
+/* 网卡表，按序号有序 */
+struct NetifTable
+{
+	int cap;
+	int n;
+	struct NetifTable *retired; /* 已被替换的旧缓存表 */
+	struct NetifInfo ifs[];
+};
+
+/*
+ * 缓存表，由监听线程写，读者按序号锁(seqlock)无锁读取；
+ * 扩容时读者可能仍在读旧表，旧表挂在retired链上不释放，按倍数扩容，旧表总大小不超过当前表
+ */
+static struct NetifTable *g_table;
+static unsigned int g_seq;
+static int g_running;
+
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER; /* 启动/停止 */
+static pthread_mutex_t g_sub_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct NetifSubscriber g_subs[NETIF_MAX_SUBSCRIBERS];
+static pthread_t g_tid;
+static __thread int t_in_notify; /* 当前线程正在执行订阅回调，已持有g_sub_lock */
+static int g_nlfd = -1;   /* 订阅变化的netlink套接字 */
+static int g_stopfd = -1;
+
+static void write_begin(void)
+{
+	__atomic_store_n(&g_seq, g_seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static void write_end(void)
+{
+	__atomic_store_n(&g_seq, g_seq + 1, __ATOMIC_RELEASE);
+}
+
+static unsigned int read_begin(void)
+{
+	unsigned int seq;
+
+	while ((seq = __atomic_load_n(&g_seq, __ATOMIC_ACQUIRE)) & 1)
+		sched_yield();
+	return seq;
+}
+
+static int read_retry(unsigned int seq)
+{
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	return __atomic_load_n(&g_seq, __ATOMIC_RELAXED) != seq;
+}
+
+static void notify(int event, const struct NetifInfo *info, const struct NetifAddr *addr)
+{
+	int i;
+
+	pthread_mutex_lock(&g_sub_lock);
+	t_in_notify = 1;
+	for (i=0; i<NETIF_MAX_SUBSCRIBERS; i++)
+	{
+		if (g_subs[i].cb)
+			g_subs[i].cb(event, info, addr, g_subs[i].arg);
+	}
+	t_in_notify = 0;
+	pthread_mutex_unlock(&g_sub_lock);
+}
+
+/*
+ * 修改表：只有缓存表需要按序号锁通知读者，全量同步时构建的私有表不需要
+ */
+static void table_begin(struct NetifTable **tp)
+{
+	if (tp == &g_table)
+		write_begin();
+}
+
+static void table_end(struct NetifTable **tp)
+{
+	if (tp == &g_table)
+		write_end();
+}
+
+static struct NetifTable *table_alloc(int cap)
+{
+	struct NetifTable *t = (struct NetifTable *)malloc(sizeof(*t) + cap * sizeof(struct NetifInfo));
+	if (!t)
+		return NULL;
+
+	t->cap = cap;
+	t->n = 0;
+	t->retired = NULL;
+	return t;
+}
+
+/*
+ * 替换缓存表，调用者处于写区间内
+ */
+static void table_publish(struct NetifTable *t)
+{
+	t->retired = g_table;
+	__atomic_store_n(&g_table, t, __ATOMIC_RELEASE);
+}
+
+/*
+ * 容量翻倍
+ * return：0 on success，-1 on fail
+ */
+static int table_grow(struct NetifTable **tp)
+{
+	struct NetifTable *old = *tp;
+	struct NetifTable *t = table_alloc(old->cap * 2);
+	if (!t)
+		return -1;
+
+	memcpy(t->ifs, old->ifs, old->n * sizeof(struct NetifInfo));
+	t->n = old->n;
+	if (tp == &g_table)
+	{
+		table_publish(t);
+	}
+	else
+	{
+		free(old);
+		*tp = t;
+	}
+	return 0;
+}
+
+/*
+ * 读者获取缓存表中有效的网卡数，不超过表容量
+ */
+static int table_count(const struct NetifTable *t)
+{
+	int n = __atomic_load_n(&t->n, __ATOMIC_RELAXED);
+	return (n < t->cap) ? n : t->cap;
+}
+
+/*
+ * 按序号查找
+ * return：下标，不存在时返回-1
+ */
+static int find_index(const struct NetifTable *t, int index)
+{
+	int i;
+
+	for (i=0; i<t->n; i++)
+	{
+		if (t->ifs[i].index == index)
+			return i;
+	}
+	return -1;
+}
+
+/*
+ * 查找或按序号插入网卡，表满时扩容
+ * return：下标，扩容失败时返回-1
+ */
+static int get_slot(struct NetifTable **tp, int index)
+{
+	struct NetifTable *t = *tp;
+	int i = find_index(t, index);
+	if (i >= 0)
+		return i;
+
+	if (t->n >= t->cap)
+	{
+		if (table_grow(tp) < 0)
+			return -1;
+		t = *tp;
+	}
+
+	for (i=t->n; i>0 && t->ifs[i-1].index > index; i--)
+		t->ifs[i] = t->ifs[i-1];
+	memset(&t->ifs[i], 0, sizeof(t->ifs[i]));
+	t->ifs[i].index = index;
+	t->n++;
+	return i;
+}
+
+/*
+ * 查找网卡上的地址
+ * return：下标，不存在时返回-1
+ */
+static int find_addr(const struct NetifInfo *ifp, const struct NetifAddr *a)
+{
+	int k;
+
+	for (k=0; k<ifp->naddr; k++)
+	{
+		/* 地址不足16字节的部分为0，可整体比较 */
+		if (ifp->addr[k].family == a->family && !memcmp(ifp->addr[k].addr, a->addr, sizeof(a->addr)))
+			return k;
+	}
+	return -1;
+}
+
+static void handle_link(struct NetifTable **tp, struct nlmsghdr *nh, int notify_on)
+{
+	struct ifinfomsg *ifi = (struct ifinfomsg *)NLMSG_DATA(nh);
+	struct rtattr *rta = IFLA_RTA(ifi);
+	int len = IFLA_PAYLOAD(nh);
+	struct NetifTable *t = *tp;
+	struct NetifInfo copy;
+	int i;
+
+	if (nh->nlmsg_type == RTM_DELLINK)
+	{
+		i = find_index(t, ifi->ifi_index);
+		if (i < 0)
+			return;
+
+		copy = t->ifs[i];
+		table_begin(tp);
+		memmove(&t->ifs[i], &t->ifs[i+1], (t->n - i - 1) * sizeof(t->ifs[0]));
+		t->n--;
+		table_end(tp);
+
+		if (notify_on)
+			notify(NETIF_LINK_DEL, &copy, NULL);
+		return;
+	}
+
+	table_begin(tp);
+	i = get_slot(tp, ifi->ifi_index);
+	t = *tp;
+	if (i >= 0)
+	{
+		t->ifs[i].flags = ifi->ifi_flags;
+		for (; RTA_OK(rta, len); rta = RTA_NEXT(rta, len))
+		{
+			switch (rta->rta_type)
+			{
+				case IFLA_IFNAME:
+					strncpy(t->ifs[i].name, (const char *)RTA_DATA(rta), IFNAMSIZ - 1);
+					t->ifs[i].name[IFNAMSIZ - 1] = '\0';
+					break;
+				case IFLA_ADDRESS:
+					if (RTA_PAYLOAD(rta) == 6)
+						memcpy(t->ifs[i].mac, RTA_DATA(rta), 6);
+					break;
+				case IFLA_MTU:
+					t->ifs[i].mtu = *(const int *)RTA_DATA(rta);
+					break;
+			}
+		}
+		copy = t->ifs[i];
+	}
+	table_end(tp);
+
+	if (i >= 0 && notify_on)
+		notify(NETIF_LINK_NEW, &copy, NULL);
+}
+
+static void handle_addr(struct NetifTable **tp, struct nlmsghdr *nh, int notify_on)
+{
+	struct ifaddrmsg *ifa = (struct ifaddrmsg *)NLMSG_DATA(nh);
+	struct rtattr *rta = IFA_RTA(ifa);
+	int len = IFA_PAYLOAD(nh);
+	const void *local = NULL, *address = NULL;
+	struct NetifAddr a;
+	struct NetifInfo copy, *ifp;
+	int i, k, alen, changed = 0;
+
+	if (ifa->ifa_family == AF_INET)
+		alen = 4;
+	else if (ifa->ifa_family == AF_INET6)
+		alen = 16;
+	else
+		return;
+
+	for (; RTA_OK(rta, len); rta = RTA_NEXT(rta, len))
+	{
+		if (RTA_PAYLOAD(rta) < (unsigned int)alen)
+			continue;
+		if (rta->rta_type == IFA_LOCAL)
+			local = RTA_DATA(rta);
+		else if (rta->rta_type == IFA_ADDRESS)
+			address = RTA_DATA(rta);
+	}
+
+	/* 点对点链路的IFA_ADDRESS是对端地址，优先取IFA_LOCAL */
+	if (!local)
+		local = address;
+	if (!local)
+		return;
+
+	memset(&a, 0, sizeof(a));
+	a.family = ifa->ifa_family;
+	a.prefixlen = ifa->ifa_prefixlen;
+	memcpy(a.addr, local, alen);
+
+	i = find_index(*tp, ifa->ifa_index);
+	if (i < 0)
+		return;
+
+	ifp = &(*tp)->ifs[i];
+	k = find_addr(ifp, &a);
+
+	table_begin(tp);
+	if (nh->nlmsg_type == RTM_NEWADDR)
+	{
+		if (k >= 0)
+		{
+			ifp->addr[k].prefixlen = a.prefixlen;
+		}
+		else if (ifp->naddr < NETIF_MAX_ADDR)
+		{
+			ifp->addr[ifp->naddr++] = a;
+			changed = 1;
+		}
+	}
+	else if (k >= 0)
+	{
+		memmove(&ifp->addr[k], &ifp->addr[k+1], (ifp->naddr - k - 1) * sizeof(a));
+		ifp->naddr--;
+		changed = 1;
+	}
+	copy = *ifp;
+	table_end(tp);
+
+	if (changed && notify_on)
+		notify(nh->nlmsg_type == RTM_NEWADDR ? NETIF_ADDR_NEW : NETIF_ADDR_DEL, &copy, &a);
+}
+
+/*
+ * 处理一批netlink消息
+ * return：1 收到NLMSG_DONE，0 继续，-1 出错
+ */
+static int handle_msgs(struct NetifTable **tp, char *buf, int len, int notify_on)
+{
+	struct nlmsghdr *nh;
+
+	for (nh = (struct nlmsghdr *)buf; NLMSG_OK(nh, (unsigned int)len); nh = NLMSG_NEXT(nh, len))
+	{
+		switch (nh->nlmsg_type)
+		{
+			case NLMSG_DONE:
+				return 1;
+			case NLMSG_ERROR:
+				return -1;
+			case RTM_NEWLINK:
+			case RTM_DELLINK:
+				handle_link(tp, nh, notify_on);
+				break;
+			case RTM_NEWADDR:
+			case RTM_DELADDR:
+				handle_addr(tp, nh, notify_on);
+				break;
+		}
+	}
+	return 0;
+}
+
+/*
+ * 请求一次RTM_GETLINK/RTM_GETADDR全量导出，结果写入私有表*tp
+ * return：0 on success，-1 on fail
+ */
+static int nl_dump(struct NetifTable **tp, int type)
+{
+	struct
+	{
+		struct nlmsghdr nh;
+		struct rtgenmsg g;
+	} req;
+	struct sockaddr_nl sa;
+	char *buf;
+	int fd, n, ret = -1;
+
+	fd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+	if (fd < 0)
+		return -1;
+
+	buf = (char *)malloc(NETIF_BUFSIZE);
+	if (!buf)
+		goto out_;
+
+	memset(&req, 0, sizeof(req));
+	req.nh.nlmsg_len = NLMSG_LENGTH(sizeof(struct rtgenmsg));
+	req.nh.nlmsg_type = type;
+	req.nh.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+	req.nh.nlmsg_seq = 1;
+	req.g.rtgen_family = AF_UNSPEC;
+
+	memset(&sa, 0, sizeof(sa));
+	sa.nl_family = AF_NETLINK;
+	if (sendto(fd, &req, req.nh.nlmsg_len, 0, (struct sockaddr *)&sa, sizeof(sa)) < 0)
+		goto out_;
+
+	while (1)
+	{
+		n = recv(fd, buf, NETIF_BUFSIZE, 0);
+		if (n < 0 && errno == EINTR)
+			continue;
+		if (n <= 0)
+			break;
+
+		n = handle_msgs(tp, buf, n, 0);
+		if (n != 0)
+		{
+			ret = (n > 0) ? 0 : -1;
+			break;
+		}
+	}
+
+out_:
+	free(buf);
+	close(fd);
+	return ret;
+}
+
+static int link_changed(const struct NetifInfo *a, const struct NetifInfo *b)
+{
+	return strncmp(a->name, b->name, IFNAMSIZ) || a->flags != b->flags || a->mtu != b->mtu || memcmp(a->mac, b->mac, 6);
+}
+
+/*
+ * 比较同步前后的两张表，补发期间丢失的通知：先发删除，再发新增
+ */
+static void notify_diff(const struct NetifTable *old, const struct NetifTable *cur)
+{
+	const struct NetifInfo *o, *c;
+	int i, j, k;
+
+	for (i=0; i<old->n; i++)
+	{
+		o = &old->ifs[i];
+		j = find_index(cur, o->index);
+		if (j < 0)
+		{
+			notify(NETIF_LINK_DEL, o, NULL);
+			continue;
+		}
+
+		c = &cur->ifs[j];
+		for (k=0; k<o->naddr; k++)
+		{
+			if (find_addr(c, &o->addr[k]) < 0)
+				notify(NETIF_ADDR_DEL, c, &o->addr[k]);
+		}
+	}
+
+	for (i=0; i<cur->n; i++)
+	{
+		c = &cur->ifs[i];
+		j = find_index(old, c->index);
+		o = (j >= 0) ? &old->ifs[j] : NULL;
+		if (!o || link_changed(o, c))
+			notify(NETIF_LINK_NEW, c, NULL);
+
+		for (k=0; k<c->naddr; k++)
+		{
+			if (!o || find_addr(o, &c->addr[k]) < 0)
+				notify(NETIF_ADDR_NEW, c, &c->addr[k]);
+		}
+	}
+}
+
+/*
+ * 全量同步：在私有表中重新导出网卡和地址，一次性替换缓存表，
+ * 读者不会看到空表或未完成的表；失败时保留原表
+ * return：0 on success，-1 on fail
+ */
+static int resync(int notify_on)
+{
+	struct NetifTable *fresh, *old = NULL;
+	int ret = -1;
+
+	fresh = table_alloc(g_table->cap);
+	if (!fresh)
+		return -1;
+
+	if (nl_dump(&fresh, RTM_GETLINK) < 0 || nl_dump(&fresh, RTM_GETADDR) < 0)
+		goto out_;
+
+	/* 缓存表只由本线程修改，读取无需加锁 */
+	if (notify_on)
+	{
+		old = table_alloc(g_table->n > 0 ? g_table->n : 1);
+		if (!old)
+			goto out_;
+		memcpy(old->ifs, g_table->ifs, g_table->n * sizeof(struct NetifInfo));
+		old->n = g_table->n;
+	}
+
+	write_begin();
+	if (fresh->n <= g_table->cap)
+	{
+		memcpy(g_table->ifs, fresh->ifs, fresh->n * sizeof(struct NetifInfo));
+		g_table->n = fresh->n;
+	}
+	else
+	{
+		table_publish(fresh);
+		fresh = NULL;
+	}
+	write_end();
+
+	if (old)
+		notify_diff(old, g_table);
+	ret = 0;
+
+out_:
+	free(fresh);
+	free(old);
+	return ret;
+}
+
+/*
+ * 丢弃队列中剩余的通知：它们早于被丢失的通知，在全量导出之后再应用会恢复已删除的网卡
+ */
+static void drain_notify(char *buf)
+{
+	int n;
+
+	while (1)
+	{
+		n = recv(g_nlfd, buf, NETIF_BUFSIZE, MSG_DONTWAIT);
+		if (n > 0 || (n < 0 && (errno == EINTR || errno == ENOBUFS)))
+			continue;
+		break;
+	}
+}
+
+static void *monitor_thread(void *param)
+{
+	struct pollfd pfd[2];
+	char *buf = (char *)param;
+	int n, need_resync = 0;
+
+	pfd[0].fd = g_nlfd;
+	pfd[0].events = POLLIN;
+	pfd[1].fd = g_stopfd;
+	pfd[1].events = POLLIN;
+
+	while (1)
+	{
+		n = poll(pfd, 2, need_resync ? NETIF_RESYNC_MS : -1);
+		if (n < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+
+		if (pfd[1].revents)
+			break;
+
+		if (n == 0) // 上次同步失败，重试
+		{
+			need_resync = (resync(1) < 0);
+			continue;
+		}
+
+		n = recv(g_nlfd, buf, NETIF_BUFSIZE, MSG_DONTWAIT);
+		if (n > 0)
+		{
+			handle_msgs(&g_table, buf, n, 1);
+		}
+		else if (n < 0 && errno == ENOBUFS) // 内核丢弃了通知，重新全量同步
+		{
+			drain_notify(buf);
+			need_resync = (resync(1) < 0);
+		}
+	}
+
+	free(buf);
+	return NULL;
+}
+
+/*
+ * 启动网卡缓存
+ * return：0 on success，-1 on fail
+ */
+int NetifCacheStart(void)
+{
+	struct sockaddr_nl sa;
+	char *buf = NULL;
+	int ret = -1;
+
+	pthread_mutex_lock(&g_lock);
+	if (g_running)
+	{
+		pthread_mutex_unlock(&g_lock);
+		return 0;
+	}
+
+	g_nlfd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE);
+	if (g_nlfd < 0)
+		goto out_;
+
+	/* 先订阅再导出，导出期间的变化不会丢失，重复的NEW消息是幂等的 */
+	memset(&sa, 0, sizeof(sa));
+	sa.nl_family = AF_NETLINK;
+	sa.nl_groups = RTMGRP_LINK | RTMGRP_IPV4_IFADDR | RTMGRP_IPV6_IFADDR;
+	if (bind(g_nlfd, (struct sockaddr *)&sa, sizeof(sa)) < 0)
+		goto out_;
+
+	g_stopfd = eventfd(0, EFD_CLOEXEC);
+	buf = (char *)malloc(NETIF_BUFSIZE);
+	if (g_stopfd < 0 || !buf)
+		goto out_;
+
+	/* 停止后保留缓存表，读者可能仍在读取 */
+	if (!g_table)
+	{
+		g_table = table_alloc(NETIF_MAX);
+		if (!g_table)
+			goto out_;
+	}
+
+	if (resync(0) < 0)
+		goto out_;
+
+	if (pthread_create(&g_tid, NULL, monitor_thread, buf) != 0)
+		goto out_;
+
+	__atomic_store_n(&g_running, 1, __ATOMIC_RELEASE);
+	ret = 0;
+
+out_:
+	if (ret < 0)
+	{
+		free(buf);
+		if (g_nlfd >= 0)
+			close(g_nlfd);
+		if (g_stopfd >= 0)
+			close(g_stopfd);
+		g_nlfd = g_stopfd = -1;
+	}
+	pthread_mutex_unlock(&g_lock);
+	return ret;
+}
+
+/*
+ * 停止监听线程并清空缓存
+ */
+void NetifCacheStop(void)
+{
+	unsigned long long one = 1;
+
+	pthread_mutex_lock(&g_lock);
+	if (!g_running)
+	{
+		pthread_mutex_unlock(&g_lock);
+		return;
+	}
+
+	__atomic_store_n(&g_running, 0, __ATOMIC_RELEASE);
+	if (write(g_stopfd, &one, sizeof(one)) < 0)
+	{
+		/* eventfd计数溢出时已可读 */
+	}
+	pthread_join(g_tid, NULL);
+
+	close(g_nlfd);
+	close(g_stopfd);
+	g_nlfd = g_stopfd = -1;
+
+	write_begin();
+	g_table->n = 0;
+	write_end();
+	pthread_mutex_unlock(&g_lock);
+}
+
+/*
+ * 缓存是否已启动
+ */
+int NetifCacheRunning(void)
+{
+	return __atomic_load_n(&g_running, __ATOMIC_ACQUIRE);
+}
+
+/*
+ * 按名称或序号查找并拷贝网卡信息
+ * return：0 on success，-1 on fail
+ */
+static int lookup(const char *name, int index, struct NetifInfo *info)
+{
+	const struct NetifTable *t;
+	unsigned int seq;
+	int i, n, found;
+
+	if (!NetifCacheRunning())
+	{
+		errno = ENOTCONN;
+		return -1;
+	}
+
+	do
+	{
+		seq = read_begin();
+		t = __atomic_load_n(&g_table, __ATOMIC_ACQUIRE);
+		n = table_count(t);
+		found = 0;
+		for (i=0; i<n; i++)
+		{
+			if (name ? !strncmp(t->ifs[i].name, name, IFNAMSIZ) : t->ifs[i].index == index)
+			{
+				if (info)
+					memcpy(info, &t->ifs[i], sizeof(*info));
+				found = 1;
+				break;
+			}
+		}
+	} while (read_retry(seq));
+
+	if (!found)
+	{
+		errno = ENODEV;
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * 按名称查询网卡
+ * return：0 on success，-1 on fail
+ */
+int NetifGetByName(const char *name, struct NetifInfo *info)
+{
+	if (!name)
+	{
+		errno = EINVAL;
+		return -1;
+	}
+	return lookup(name, 0, info);
+}
+
+/*
+ * 按序号查询网卡
+ * return：0 on success，-1 on fail
+ */
+int NetifGetByIndex(int index, struct NetifInfo *info)
+{
+	return lookup(NULL, index, info);
+}
+
+/*
+ * 获取所有网卡
+ * return：网卡总数，-1 未启动
+ */
+int NetifList(struct NetifInfo *info, int count)
+{
+	const struct NetifTable *t;
+	unsigned int seq;
+	int n;
+
+	if (!NetifCacheRunning())
+	{
+		errno = ENOTCONN;
+		return -1;
+	}
+
+	do
+	{
+		seq = read_begin();
+		t = __atomic_load_n(&g_table, __ATOMIC_ACQUIRE);
+		n = table_count(t);
+		if (info && count > 0)
+			memcpy(info, t->ifs, ((n < count) ? n : count) * sizeof(*info));
+	} while (read_retry(seq));
+
+	return n;
+}
+
+/*
+ * 获取网卡的第一个family地址
+ * return：0 on success，-1 on fail
+ */
+int NetifGetAddr(const char *name, int family, void *addr)
+{
+	const struct NetifTable *t;
+	unsigned int seq;
+	int i, k, n, found;
+
+	if (!NetifCacheRunning())
+	{
+		errno = ENOTCONN;
+		return -1;
+	}
+
+	do
+	{
+		seq = read_begin();
+		t = __atomic_load_n(&g_table, __ATOMIC_ACQUIRE);
+		n = table_count(t);
+		found = 0;
+		for (i=0; i<n && !found; i++)
+		{
+			const struct NetifInfo *ifp = &t->ifs[i];
+			if (name ? strncmp(ifp->name, name, IFNAMSIZ) != 0 : (ifp->flags & IFF_LOOPBACK) != 0)
+				continue;
+
+			for (k=0; k<ifp->naddr && k<NETIF_MAX_ADDR; k++)
+			{
+				if (ifp->addr[k].family == family)
+				{
+					memcpy(addr, ifp->addr[k].addr, family == AF_INET ? 4 : 16);
+					found = 1;
+					break;
+				}
+			}
+		}
+	} while (read_retry(seq));
+
+	if (!found)
+	{
+		errno = EADDRNOTAVAIL;
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * 网卡名称转序号
+ * return：序号，0 表示不存在
+ */
+unsigned int NetifNameToIndex(const char *name)
+{
+	struct NetifInfo info;
+
+	if (!name)
+		return 0;
+	if (!NetifCacheRunning())
+		return if_nametoindex(name);
+	return (NetifGetByName(name, &info) == 0) ? (unsigned int)info.index : 0;
+}
+
+/*
+ * 订阅网卡和地址变化
+ * return：订阅号 on success，-1 on fail
+ */
+int NetifSubscribe(NetifCallback cb, void *arg)
+{
+	int i;
+
+	if (!cb)
+	{
+		errno = EINVAL;
+		return -1;
+	}
+
+	/* 在回调中调用时本线程已持有锁 */
+	if (!t_in_notify)
+		pthread_mutex_lock(&g_sub_lock);
+	for (i=0; i<NETIF_MAX_SUBSCRIBERS; i++)
+	{
+		if (!g_subs[i].cb)
+		{
+			g_subs[i].cb = cb;
+			g_subs[i].arg = arg;
+			if (!t_in_notify)
+				pthread_mutex_unlock(&g_sub_lock);
+			return i;
+		}
+	}
+	if (!t_in_notify)
+		pthread_mutex_unlock(&g_sub_lock);
+
+	errno = ENOSPC;
+	return -1;
+}
+
+/*
+ * 取消订阅
+ */
+void NetifUnsubscribe(int id)
+{
+	if (id < 0 || id >= NETIF_MAX_SUBSCRIBERS)
+		return;
+
+	/* 在回调中调用时本线程已持有锁，不能依赖g_running判断：NetifCacheStop先清除g_running再等待监听线程 */
+	if (!t_in_notify)
+		pthread_mutex_lock(&g_sub_lock);
+	g_subs[id].cb = NULL;
+	g_subs[id].arg = NULL;
+	if (!t_in_notify)
+		pthread_mutex_unlock(&g_sub_lock);
+}
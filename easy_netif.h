@@ -0,0 +1,121 @@
+/*
+ * 网卡信息缓存: C接口方式
+ * Copyright FreeCode. All Rights Reserved.
+ * MIT License (https://opensource.org/licenses/MIT)
+ * 2024 by liuqingshuige
+ */
+#ifndef __FREE_EASY_NETIF_H__
+#define __FREE_EASY_NETIF_H__
+
+#include <net/if.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define NETIF_MAX       64 /* 缓存表初始容量，网卡更多时自动扩容 */
+#define NETIF_MAX_ADDR  16 /* 每个网卡最多缓存的地址数 */
+
+/* 变化事件 */
+#define NETIF_LINK_NEW  1  /* 网卡新增或状态、名称、MAC改变 */
+#define NETIF_LINK_DEL  2  /* 网卡删除 */
+#define NETIF_ADDR_NEW  3  /* 新增地址 */
+#define NETIF_ADDR_DEL  4  /* 删除地址 */
+
+struct NetifAddr
+{
+	int family;               /* AF_INET/AF_INET6 */
+	int prefixlen;            /* 前缀长度 */
+	unsigned char addr[16];   /* 网络字节序，AF_INET只用前4字节 */
+};
+
+struct NetifInfo
+{
+	int index;                /* 网卡序号 */
+	char name[IFNAMSIZ];      /* 网卡名称 */
+	unsigned int flags;       /* IFF_UP/IFF_RUNNING/IFF_LOOPBACK等 */
+	int mtu;
+	unsigned char mac[6];     /* MAC地址，无MAC的网卡为0 */
+	int naddr;                /* addr数组有效元素个数 */
+	struct NetifAddr addr[NETIF_MAX_ADDR];
+};
+
+/*
+ * 变化通知回调，在缓存的监听线程中调用，回调中不应阻塞
+ * event：NETIF_LINK_NEW/NETIF_LINK_DEL/NETIF_ADDR_NEW/NETIF_ADDR_DEL
+ * info：变化后的网卡信息，NETIF_LINK_DEL时为删除前的信息
+ * addr：新增或删除的地址，LINK事件时为NULL
+ * arg：用户参数
+ */
+typedef void (*NetifCallback)(int event, const struct NetifInfo *info, const struct NetifAddr *addr, void *arg);
+
+/*
+ * 启动网卡缓存：通过rtnetlink读取所有网卡和地址，并启动监听线程按RTM_NEWLINK/RTM_DELLINK/
+ * RTM_NEWADDR/RTM_DELADDR增量更新；启动后GetLocalIpv4/GetLocalIpv6/GetLocalNetcard/GetMacAddr
+ * 以及组播接口查询都直接读缓存，不再访问内核
+ * return：0 on success，-1 on fail
+ */
+int NetifCacheStart(void);
+
+/*
+ * 停止监听线程并清空缓存，之后的查询回退为直接访问内核
+ */
+void NetifCacheStop(void);
+
+/*
+ * 缓存是否已启动
+ * return：1 已启动，0 未启动
+ */
+int NetifCacheRunning(void);
+
+/*
+ * 按名称查询网卡，读取不加锁，与更新冲突时重试
+ * return：0 on success，-1 on fail（未启动或不存在）
+ */
+int NetifGetByName(const char *name, struct NetifInfo *info);
+
+/*
+ * 按序号查询网卡
+ * return：0 on success，-1 on fail（未启动或不存在）
+ */
+int NetifGetByIndex(int index, struct NetifInfo *info);
+
+/*
+ * 获取所有网卡，按序号排序
+ * info：保存网卡信息的数组
+ * count：info数组元素个数，网卡更多时只复制前count个
+ * return：网卡总数（可能大于count），-1 未启动
+ */
+int NetifList(struct NetifInfo *info, int count);
+
+/*
+ * 获取网卡的第一个family地址
+ * name：网卡名称，为NULL时取第一个非回环网卡
+ * family：AF_INET/AF_INET6
+ * addr：保存地址，AF_INET为4字节，AF_INET6为16字节
+ * return：0 on success，-1 on fail（未启动或不存在）
+ */
+int NetifGetAddr(const char *name, int family, void *addr);
+
+/*
+ * 网卡名称转序号，缓存已启动时读缓存，否则调用if_nametoindex
+ * return：序号，0 表示不存在
+ */
+unsigned int NetifNameToIndex(const char *name);
+
+/*
+ * 订阅网卡和地址变化
+ * return：订阅号 on success，-1 on fail
+ */
+int NetifSubscribe(NetifCallback cb, void *arg);
+
+/*
+ * 取消订阅，返回后回调不会再被调用（在回调中调用时除外）
+ */
+void NetifUnsubscribe(int id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
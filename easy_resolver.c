@@ -0,0 +1,620 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <netdb.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "easy_resolver.h"
+#include "easy_timer.h"
+
+#define RESOLVER_BUCKETS 256
+#define RESOLVER_MAX_ENTRIES 1024
+#define RESOLVER_THREADS 2
+
+struct ResolverEntry
+{
+	char *host;
+	char *service;
+	unsigned int hash;
+	long long expire;  /* 过期时间，单调时钟ms */
+	int count;         /* 地址个数，-1表示解析失败 */
+	struct sockaddr_storage addr[RESOLVER_MAX_ADDR];
+	struct ResolverEntry *next;
+};
+
+/*
+ * 正在解析的请求，同一主机/服务的并发未命中只调用一次getaddrinfo，其余请求等待结果
+ */
+struct ResolverFlight
+{
+	char *host;
+	char *service;
+	unsigned int hash;
+	int done;
+	int waiters;       /* 引用计数，含发起解析的线程 */
+	int count;
+	struct sockaddr_storage addr[RESOLVER_MAX_ADDR];
+	struct ResolverFlight *next;
+};
+
+struct ResolverJob
+{
+	char *host;
+	char *service;
+	ResolveCallback cb;
+	void *arg;
+	int efd;
+	struct ResolverJob *next;
+};
+
+static struct
+{
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	unsigned int ttl;
+	unsigned int negative_ttl;
+	int entries;
+	struct ResolverEntry *buckets[RESOLVER_BUCKETS];
+	struct ResolverFlight *flights;
+	pthread_cond_t flight_cond;
+	int threads;
+	struct ResolverJob *head;
+	struct ResolverJob *tail;
+} g_resolver = {
+	PTHREAD_MUTEX_INITIALIZER,
+	PTHREAD_COND_INITIALIZER,
+	30000,
+	5000,
+	0,
+	{ NULL },
+	NULL,
+	PTHREAD_COND_INITIALIZER,
+};
+
+/*
+ * 键中的NULL与""是不同的：getaddrinfo(NULL, ...)返回通配地址，getaddrinfo("", ...)失败
+ */
+static int key_equal(const char *a, const char *b)
+{
+	if (!a || !b)
+		return a == b;
+	return !strcmp(a, b);
+}
+
+static unsigned int str_hash(unsigned int h, const char *s)
+{
+	if (!s)
+		return (h ^ 0x100) * 16777619u; // 不会与任何字节相同
+	for (; *s; s++)
+		h = (h ^ (unsigned char)*s) * 16777619u;
+	return (h ^ '/') * 16777619u;
+}
+
+static unsigned int key_hash(const char *host, const char *service)
+{
+	return str_hash(str_hash(2166136261u, host), service); /* FNV-1a */
+}
+
+/*
+ * 复制可为NULL的字符串
+ * return：0 on success，-1 on fail
+ */
+static int key_dup(char **dst, const char *src)
+{
+	*dst = src ? strdup(src) : NULL;
+	return (src && !*dst) ? -1 : 0;
+}
+
+/*
+ * 调用getaddrinfo解析并去重，取自DomainName2Addr
+ * return：num of actual addr on success，-1 on error
+ */
+static int resolve_addr(const char *host, const char *serv, struct sockaddr_storage *addr, int count)
+{
+	struct addrinfo hints, *result, *tmp;
+	int ret = 0, n = 0, idx = 0, exist = 0;
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+
+	ret = getaddrinfo(host, serv, &hints, &result);
+	if (ret != 0)
+		return -1;
+
+	tmp = result;
+	while (tmp)
+	{
+		exist = 0;
+		for (idx=0; idx<n; idx++) // 去重
+		{
+			if (addr[idx].ss_family == tmp->ai_family)
+			{
+				if (0 == memcmp(&addr[idx], tmp->ai_addr, tmp->ai_addrlen))
+				{
+					exist = 1;
+					break;
+				}
+			}
+		}
+
+		if (exist)
+		{
+			tmp = tmp->ai_next;
+			continue;
+		}
+
+		memcpy(&addr[n++], tmp->ai_addr, tmp->ai_addrlen);
+		if (n >= count)
+			break;
+		tmp = tmp->ai_next;
+	}
+	freeaddrinfo(result);
+	return n;
+}
+
+static void free_entry(struct ResolverEntry *e)
+{
+	free(e->host);
+	free(e->service);
+	free(e);
+}
+
+/*
+ * 查找缓存项，过期的项顺便删除，调用者持有锁
+ */
+static struct ResolverEntry *cache_find(const char *host, const char *service, unsigned int hash, long long now)
+{
+	struct ResolverEntry **pp = &g_resolver.buckets[hash % RESOLVER_BUCKETS];
+	struct ResolverEntry *e;
+
+	while ((e = *pp) != NULL)
+	{
+		if (e->expire <= now)
+		{
+			*pp = e->next;
+			free_entry(e);
+			g_resolver.entries--;
+			continue;
+		}
+
+		if (e->hash == hash && key_equal(e->host, host) && key_equal(e->service, service))
+			return e;
+		pp = &e->next;
+	}
+	return NULL;
+}
+
+/*
+ * 缓存已满时淘汰：先删除所有过期项，仍然满则删除各桶的第一项
+ */
+static void cache_evict(long long now)
+{
+	int i;
+	struct ResolverEntry **pp, *e;
+
+	for (i=0; i<RESOLVER_BUCKETS; i++)
+	{
+		pp = &g_resolver.buckets[i];
+		while ((e = *pp) != NULL)
+		{
+			if (e->expire <= now)
+			{
+				*pp = e->next;
+				free_entry(e);
+				g_resolver.entries--;
+			}
+			else
+				pp = &e->next;
+		}
+	}
+
+	for (i=0; i<RESOLVER_BUCKETS && g_resolver.entries >= RESOLVER_MAX_ENTRIES; i++)
+	{
+		e = g_resolver.buckets[i];
+		if (e)
+		{
+			g_resolver.buckets[i] = e->next;
+			free_entry(e);
+			g_resolver.entries--;
+		}
+	}
+}
+
+static void cache_store(const char *host, const char *service, const struct sockaddr_storage *addr, int count)
+{
+	unsigned int hash = key_hash(host, service);
+	unsigned int ttl;
+	long long now = TimerNow();
+	struct ResolverEntry *e;
+
+	pthread_mutex_lock(&g_resolver.lock);
+	ttl = (count > 0) ? g_resolver.ttl : g_resolver.negative_ttl;
+	if (ttl == 0)
+		goto out_;
+
+	e = cache_find(host, service, hash, now);
+	if (!e)
+	{
+		if (g_resolver.entries >= RESOLVER_MAX_ENTRIES)
+			cache_evict(now);
+
+		e = (struct ResolverEntry *)calloc(1, sizeof(*e));
+		if (!e)
+			goto out_;
+		if (key_dup(&e->host, host) < 0 || key_dup(&e->service, service) < 0)
+		{
+			free_entry(e);
+			goto out_;
+		}
+		e->hash = hash;
+		e->next = g_resolver.buckets[hash % RESOLVER_BUCKETS];
+		g_resolver.buckets[hash % RESOLVER_BUCKETS] = e;
+		g_resolver.entries++;
+	}
+
+	e->expire = now + ttl;
+	e->count = count;
+	if (count > 0)
+		memcpy(e->addr, addr, count * sizeof(addr[0]));
+
+out_:
+	pthread_mutex_unlock(&g_resolver.lock);
+}
+
+/*
+ * 复制解析结果
+ * return：num of actual addr，-1 解析失败
+ */
+static int copy_result(struct sockaddr_storage *dst, int count, const struct sockaddr_storage *src, int n)
+{
+	if (n <= 0)
+		return -1;
+	if (n > count)
+		n = count;
+	if (dst)
+		memcpy(dst, src, n * sizeof(dst[0]));
+	return n;
+}
+
+/*
+ * 查缓存，调用者持有锁
+ * return：1 命中，0 未命中
+ */
+static int cache_lookup_locked(const char *host, const char *service, unsigned int hash, struct sockaddr_storage *addr, int count, int *result)
+{
+	struct ResolverEntry *e = cache_find(host, service, hash, TimerNow());
+
+	if (!e)
+		return 0;
+	*result = copy_result(addr, count, e->addr, e->count);
+	return 1;
+}
+
+/*
+ * 查缓存
+ * return：1 命中，0 未命中
+ */
+static int cache_lookup(const char *host, const char *service, struct sockaddr_storage *addr, int count, int *result)
+{
+	int hit;
+
+	pthread_mutex_lock(&g_resolver.lock);
+	hit = cache_lookup_locked(host, service, key_hash(host, service), addr, count, result);
+	pthread_mutex_unlock(&g_resolver.lock);
+	return hit;
+}
+
+static void free_flight(struct ResolverFlight *f)
+{
+	free(f->host);
+	free(f->service);
+	free(f);
+}
+
+/*
+ * 查找正在解析的请求，调用者持有锁
+ */
+static struct ResolverFlight *flight_find(const char *host, const char *service, unsigned int hash)
+{
+	struct ResolverFlight *f;
+
+	for (f = g_resolver.flights; f; f = f->next)
+	{
+		if (f->hash == hash && key_equal(f->host, host) && key_equal(f->service, service))
+			return f;
+	}
+	return NULL;
+}
+
+/*
+ * 登记正在解析的请求，调用者持有锁
+ * return：flight on success，NULL on fail（不合并，直接解析）
+ */
+static struct ResolverFlight *flight_start(const char *host, const char *service, unsigned int hash)
+{
+	struct ResolverFlight *f = (struct ResolverFlight *)calloc(1, sizeof(*f));
+
+	if (!f)
+		return NULL;
+	if (key_dup(&f->host, host) < 0 || key_dup(&f->service, service) < 0)
+	{
+		free_flight(f);
+		return NULL;
+	}
+
+	f->hash = hash;
+	f->waiters = 1;
+	f->next = g_resolver.flights;
+	g_resolver.flights = f;
+	return f;
+}
+
+/*
+ * 发布解析结果并唤醒等待者
+ */
+static void flight_finish(struct ResolverFlight *f, const struct sockaddr_storage *addr, int n)
+{
+	struct ResolverFlight **pp;
+
+	pthread_mutex_lock(&g_resolver.lock);
+	for (pp = &g_resolver.flights; *pp; pp = &(*pp)->next)
+	{
+		if (*pp == f)
+		{
+			*pp = f->next;
+			break;
+		}
+	}
+
+	f->count = n;
+	if (n > 0)
+		memcpy(f->addr, addr, n * sizeof(addr[0]));
+	f->done = 1;
+	pthread_cond_broadcast(&g_resolver.flight_cond);
+	if (--f->waiters == 0)
+		free_flight(f);
+	pthread_mutex_unlock(&g_resolver.lock);
+}
+
+/*
+ * 设置缓存有效期
+ */
+void ResolverSetTTL(unsigned int ttl, unsigned int negative_ttl)
+{
+	pthread_mutex_lock(&g_resolver.lock);
+	g_resolver.ttl = ttl;
+	g_resolver.negative_ttl = negative_ttl;
+	pthread_mutex_unlock(&g_resolver.lock);
+}
+
+/*
+ * 清空缓存
+ */
+void ResolverFlush(void)
+{
+	int i;
+	struct ResolverEntry *e, *next;
+
+	pthread_mutex_lock(&g_resolver.lock);
+	for (i=0; i<RESOLVER_BUCKETS; i++)
+	{
+		for (e = g_resolver.buckets[i]; e; e = next)
+		{
+			next = e->next;
+			free_entry(e);
+		}
+		g_resolver.buckets[i] = NULL;
+	}
+	g_resolver.entries = 0;
+	pthread_mutex_unlock(&g_resolver.lock);
+}
+
+/*
+ * 同步解析：先查缓存，未命中则调用getaddrinfo并缓存结果
+ * return：num of actual addr on success，-1 on error
+ */
+int ResolverLookup(const char *host, const char *service, struct sockaddr_storage *addr, int count)
+{
+	struct sockaddr_storage tmp[RESOLVER_MAX_ADDR];
+	unsigned int hash = key_hash(host, service);
+	struct ResolverFlight *f;
+	int n;
+
+	if (!addr || count <= 0)
+		return -1;
+
+	pthread_mutex_lock(&g_resolver.lock);
+	if (cache_lookup_locked(host, service, hash, addr, count, &n))
+	{
+		pthread_mutex_unlock(&g_resolver.lock);
+		return n;
+	}
+
+	/* 已有线程在解析同一主机/服务时等待其结果 */
+	f = flight_find(host, service, hash);
+	if (f)
+	{
+		f->waiters++;
+		while (!f->done)
+			pthread_cond_wait(&g_resolver.flight_cond, &g_resolver.lock);
+		n = copy_result(addr, count, f->addr, f->count);
+		if (--f->waiters == 0)
+			free_flight(f);
+		pthread_mutex_unlock(&g_resolver.lock);
+		return n;
+	}
+
+	f = flight_start(host, service, hash);
+	pthread_mutex_unlock(&g_resolver.lock);
+
+	n = resolve_addr(host, service, tmp, RESOLVER_MAX_ADDR);
+	cache_store(host, service, tmp, n);
+	if (f)
+		flight_finish(f, tmp, n);
+
+	return copy_result(addr, count, tmp, n);
+}
+
+/*
+ * 仅查缓存，不会阻塞
+ * return：num of actual addr on success，-1 on error
+ */
+int ResolverLookupCached(const char *host, const char *service, struct sockaddr_storage *addr, int count)
+{
+	int n;
+
+	if (!addr || count <= 0)
+		return -1;
+
+	if (cache_lookup(host, service, addr, count, &n))
+		return n;
+
+	errno = EAGAIN;
+	return -1;
+}
+
+static void finish_job(struct ResolverJob *job, const struct sockaddr_storage *addr, int n)
+{
+	if (job->cb)
+		job->cb(job->host, job->service, (n > 0) ? addr : NULL, n, job->arg);
+
+	if (job->efd >= 0)
+	{
+		uint64_t one = 1;
+		if (write(job->efd, &one, sizeof(one)) < 0)
+		{
+			/* eventfd计数溢出时已处于可读状态 */
+		}
+	}
+}
+
+static void free_job(struct ResolverJob *job)
+{
+	free(job->host);
+	free(job->service);
+	free(job);
+}
+
+static void *resolver_worker(void *param)
+{
+	struct ResolverJob *job;
+	struct sockaddr_storage addr[RESOLVER_MAX_ADDR];
+	int n;
+
+	while (1)
+	{
+		pthread_mutex_lock(&g_resolver.lock);
+		while (g_resolver.head == NULL)
+			pthread_cond_wait(&g_resolver.cond, &g_resolver.lock);
+
+		job = g_resolver.head;
+		g_resolver.head = job->next;
+		if (g_resolver.head == NULL)
+			g_resolver.tail = NULL;
+		pthread_mutex_unlock(&g_resolver.lock);
+
+		/* 排队期间可能已被其他请求解析过 */
+		n = ResolverLookup(job->host, job->service, addr, RESOLVER_MAX_ADDR);
+		finish_job(job, addr, n);
+		free_job(job);
+	}
+	return NULL;
+}
+
+/*
+ * 提交异步解析任务，按需启动解析线程
+ * return：0 on success，-1 on fail
+ */
+static int submit_job(const char *host, const char *service, ResolveCallback cb, void *arg, int efd)
+{
+	struct ResolverJob *job = (struct ResolverJob *)calloc(1, sizeof(*job));
+	pthread_t tid;
+
+	if (!job)
+		return -1;
+
+	job->host = host ? strdup(host) : NULL;
+	job->service = service ? strdup(service) : NULL;
+	job->cb = cb;
+	job->arg = arg;
+	job->efd = efd;
+	if ((host && !job->host) || (service && !job->service))
+	{
+		free_job(job);
+		return -1;
+	}
+
+	pthread_mutex_lock(&g_resolver.lock);
+	while (g_resolver.threads < RESOLVER_THREADS)
+	{
+		if (pthread_create(&tid, NULL, resolver_worker, NULL) != 0)
+			break;
+		pthread_detach(tid);
+		g_resolver.threads++;
+	}
+
+	if (g_resolver.threads == 0)
+	{
+		pthread_mutex_unlock(&g_resolver.lock);
+		free_job(job);
+		return -1;
+	}
+
+	if (g_resolver.tail)
+		g_resolver.tail->next = job;
+	else
+		g_resolver.head = job;
+	g_resolver.tail = job;
+	pthread_cond_signal(&g_resolver.cond);
+	pthread_mutex_unlock(&g_resolver.lock);
+	return 0;
+}
+
+/*
+ * 异步解析，通过回调返回结果
+ * return：1 命中缓存（回调已执行），0 已提交到解析线程，-1 on fail
+ */
+int ResolverLookupAsync(const char *host, const char *service, ResolveCallback cb, void *arg)
+{
+	struct sockaddr_storage addr[RESOLVER_MAX_ADDR];
+	int n;
+
+	if (!cb)
+		return -1;
+
+	if (cache_lookup(host, service, addr, RESOLVER_MAX_ADDR, &n))
+	{
+		cb(host, service, (n > 0) ? addr : NULL, n, arg);
+		return 1;
+	}
+
+	return submit_job(host, service, cb, arg, -1);
+}
+
+/*
+ * 异步解析，完成后向eventfd写入1
+ * return：1 命中缓存（已写入efd），0 已提交到解析线程，-1 on fail
+ */
+int ResolverLookupNotify(const char *host, const char *service, int efd)
+{
+	struct sockaddr_storage addr[1];
+	uint64_t one = 1;
+	int n;
+
+	if (efd < 0)
+		return -1;
+
+	if (cache_lookup(host, service, addr, 1, &n))
+	{
+		if (write(efd, &one, sizeof(one)) < 0)
+		{
+			/* eventfd计数溢出时已处于可读状态 */
+		}
+		return 1;
+	}
+
+	return submit_job(host, service, NULL, NULL, efd);
+}
@@ -0,0 +1,79 @@
+/*
+ * 带缓存的域名解析封装: C接口方式
+ * Copyright FreeCode. All Rights Reserved.
+ * MIT License (https://opensource.org/licenses/MIT)
+ * 2024 by liuqingshuige
+ */
+#ifndef __FREE_EASY_RESOLVER_H__
+#define __FREE_EASY_RESOLVER_H__
+
+#include <sys/types.h>
+#include <sys/socket.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RESOLVER_MAX_ADDR 32 /* 每个主机缓存的最大地址数 */
+
+/*
+ * 异步解析完成回调，命中缓存时在调用线程中执行，否则在解析线程中执行
+ * host：主机名
+ * service：端口号/服务名
+ * addr：解析结果，count<=0时为NULL
+ * count：地址个数，-1表示解析失败
+ * arg：用户参数
+ */
+typedef void (*ResolveCallback)(const char *host, const char *service, const struct sockaddr_storage *addr, int count, void *arg);
+
+/*
+ * 设置缓存有效期，默认成功结果30000ms，失败结果5000ms
+ * ttl：解析成功结果的缓存时间(ms)，为0表示不缓存
+ * negative_ttl：解析失败结果的缓存时间(ms)，为0表示不缓存
+ */
+void ResolverSetTTL(unsigned int ttl, unsigned int negative_ttl);
+
+/*
+ * 清空缓存
+ */
+void ResolverFlush(void);
+
+/*
+ * 同步解析：先查缓存，未命中则调用getaddrinfo并缓存结果，DomainName2Addr即调用此接口
+ * 多个线程同时未命中同一主机/服务时只解析一次，其余线程等待该结果
+ * host：主机名/域名/IP地址，NULL与""是不同的缓存项
+ * service：端口号/服务名（如NTP、FTP、SIP等）
+ * addr：保存返回的地址信息数组
+ * count：addr数组大小
+ * return：num of actual addr on success，-1 on error
+ */
+int ResolverLookup(const char *host, const char *service, struct sockaddr_storage *addr, int count);
+
+/*
+ * 仅查缓存，不会阻塞
+ * return：num of actual addr on success，-1 on error（含缓存的失败结果），
+ *         未命中返回-1且errno为EAGAIN
+ */
+int ResolverLookupCached(const char *host, const char *service, struct sockaddr_storage *addr, int count);
+
+/*
+ * 异步解析，通过回调返回结果
+ * cb：完成回调
+ * arg：用户参数
+ * return：1 命中缓存（回调已执行），0 已提交到解析线程，-1 on fail
+ */
+int ResolverLookupAsync(const char *host, const char *service, ResolveCallback cb, void *arg);
+
+/*
+ * 异步解析，完成后向eventfd写入1，之后用ResolverLookupCached取结果
+ * efd：eventfd描述符，可注册到EventLoop中
+ * 注意：缓存有效期为0时取不到结果，此时请使用ResolverLookupAsync
+ * return：1 命中缓存（已写入efd），0 已提交到解析线程，-1 on fail
+ */
+int ResolverLookupNotify(const char *host, const char *service, int efd);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,242 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+
+#include <sys/mman.h>
+#include <sys/socket.h>
+
+#include "easy_ring.h"
+
+struct RingBuffer
+{
+	char *base;    /* 2*size的映射，[size, 2*size)与[0, size)是同一段内存 */
+	size_t size;
+	size_t head;   /* 读位置，单调递增 */
+	size_t tail;   /* 写位置，单调递增 */
+};
+
+/*
+ * 创建环形缓存
+ * return：ring on success，NULL on fail
+ */
+RingBuffer *RingBufferCreate(size_t size)
+{
+	RingBuffer *ring;
+	size_t page = (size_t)sysconf(_SC_PAGESIZE);
+	char *base, *p;
+	int fd;
+
+	if (size == 0)
+	{
+		errno = EINVAL;
+		return NULL;
+	}
+	size = (size + page - 1) / page * page;
+
+	ring = (RingBuffer *)calloc(1, sizeof(*ring));
+	if (!ring)
+		return NULL;
+
+	fd = memfd_create("easy_ring", MFD_CLOEXEC);
+	if (fd < 0)
+		goto fail_;
+
+	if (ftruncate(fd, size) < 0)
+		goto fail_;
+
+	/* 先保留2*size的地址空间，再把同一段内存固定映射到前后两半 */
+	base = (char *)mmap(NULL, 2 * size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (base == MAP_FAILED)
+		goto fail_;
+
+	p = (char *)mmap(base, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+	if (p == MAP_FAILED)
+		goto unmap_;
+
+	p = (char *)mmap(base + size, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+	if (p == MAP_FAILED)
+		goto unmap_;
+
+	close(fd);
+	ring->base = base;
+	ring->size = size;
+	return ring;
+
+unmap_:
+	munmap(base, 2 * size);
+fail_:
+	if (fd >= 0)
+		close(fd);
+	free(ring);
+	return NULL;
+}
+
+/*
+ * 销毁环形缓存
+ */
+void RingBufferDestroy(RingBuffer *ring)
+{
+	if (!ring)
+		return;
+
+	munmap(ring->base, 2 * ring->size);
+	free(ring);
+}
+
+/*
+ * 获取容量
+ */
+size_t RingBufferCapacity(const RingBuffer *ring)
+{
+	return ring->size;
+}
+
+/*
+ * 获取可读数据的起始地址
+ */
+void *RingBufferReadPtr(const RingBuffer *ring, size_t *len)
+{
+	if (len)
+		*len = ring->tail - ring->head;
+	return ring->base + ring->head % ring->size;
+}
+
+/*
+ * 丢弃已处理的n字节数据
+ */
+void RingBufferConsume(RingBuffer *ring, size_t n)
+{
+	if (n > ring->tail - ring->head)
+		n = ring->tail - ring->head;
+	ring->head += n;
+
+	/* 缓存为空时复位，使后续数据从头部开始 */
+	if (ring->head == ring->tail)
+		ring->head = ring->tail = 0;
+}
+
+/*
+ * 获取可写空间的起始地址
+ */
+void *RingBufferWritePtr(const RingBuffer *ring, size_t *len)
+{
+	if (len)
+		*len = ring->size - (ring->tail - ring->head);
+	return ring->base + ring->tail % ring->size;
+}
+
+/*
+ * 提交已写入的n字节数据
+ */
+void RingBufferCommit(RingBuffer *ring, size_t n)
+{
+	size_t space = ring->size - (ring->tail - ring->head);
+	if (n > space)
+		n = space;
+	ring->tail += n;
+}
+
+/*
+ * 等待套接字就绪
+ * return：>0 就绪，0 超时，-1 出错
+ */
+static int ring_wait(int sockfd, short events, int timeout)
+{
+	struct pollfd pfd;
+	int ret;
+
+	pfd.fd = sockfd;
+	pfd.events = events;
+	pfd.revents = 0;
+	ret = poll(&pfd, 1, timeout);
+	if (ret < 0 && errno == EINTR)
+		return 0;
+	return ret;
+}
+
+/*
+ * 从套接字读取数据到环形缓存
+ * return：num of read bytes，0 超时或缓存已满，-1 对端关闭或出错
+ */
+int RingBufferRecv(RingBuffer *ring, int sockfd, int timeout)
+{
+	size_t space;
+	void *ptr;
+	ssize_t n;
+	int ret;
+
+	ptr = RingBufferWritePtr(ring, &space);
+	if (space == 0)
+		return 0;
+
+	while (1)
+	{
+		n = recv(sockfd, ptr, space, MSG_DONTWAIT);
+		if (n > 0)
+		{
+			ring->tail += n;
+			return (int)n;
+		}
+
+		if (n == 0) // 对端关闭
+			return -1;
+
+		if (errno == EINTR)
+			continue;
+		if (errno != EAGAIN && errno != EWOULDBLOCK)
+			return -1;
+
+		if (timeout == 0)
+			return 0;
+
+		ret = ring_wait(sockfd, POLLIN, timeout);
+		if (ret <= 0)
+			return ret;
+		timeout = 0; // 只等待一次
+	}
+}
+
+/*
+ * 将环形缓存中的数据发送到套接字
+ * return：num of send bytes，0 超时或缓存为空，-1 出错
+ */
+int RingBufferSend(RingBuffer *ring, int sockfd, int timeout)
+{
+	size_t avail;
+	void *ptr;
+	ssize_t n;
+	int ret;
+
+	ptr = RingBufferReadPtr(ring, &avail);
+	if (avail == 0)
+		return 0;
+
+	while (1)
+	{
+		n = send(sockfd, ptr, avail, MSG_DONTWAIT | MSG_NOSIGNAL);
+		if (n >= 0)
+		{
+			RingBufferConsume(ring, n);
+			return (int)n;
+		}
+
+		if (errno == EINTR)
+			continue;
+		if (errno != EAGAIN && errno != EWOULDBLOCK)
+			return -1;
+
+		if (timeout == 0)
+			return 0;
+
+		ret = ring_wait(sockfd, POLLOUT, timeout);
+		if (ret <= 0)
+			return ret;
+		timeout = 0;
+	}
+}
@@ -0,0 +1,83 @@
+/*
+ * 镜像环形缓存: C接口方式
+ * Copyright FreeCode. All Rights Reserved.
+ * MIT License (https://opensource.org/licenses/MIT)
+ * 2024 by liuqingshuige
+ */
+#ifndef __FREE_EASY_RING_H__
+#define __FREE_EASY_RING_H__
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * 环形缓存：同一段memfd内存连续映射两次，任何可读或可写区域在地址上都是连续的，
+ * 解析器可以直接处理跨越尾部的数据，无需拷贝或memmove整理
+ */
+typedef struct RingBuffer RingBuffer;
+
+/*
+ * 创建环形缓存
+ * size：容量，单位字节，向上取整到页大小
+ * return：ring on success，NULL on fail
+ */
+RingBuffer *RingBufferCreate(size_t size);
+
+/*
+ * 销毁环形缓存
+ */
+void RingBufferDestroy(RingBuffer *ring);
+
+/*
+ * 获取容量，单位字节
+ */
+size_t RingBufferCapacity(const RingBuffer *ring);
+
+/*
+ * 获取可读数据的起始地址
+ * len：保存可读数据长度，数据总是连续的
+ * return：可读数据起始地址
+ */
+void *RingBufferReadPtr(const RingBuffer *ring, size_t *len);
+
+/*
+ * 丢弃已处理的n字节数据
+ */
+void RingBufferConsume(RingBuffer *ring, size_t n);
+
+/*
+ * 获取可写空间的起始地址
+ * len：保存可写空间长度，空间总是连续的
+ * return：可写空间起始地址
+ */
+void *RingBufferWritePtr(const RingBuffer *ring, size_t *len);
+
+/*
+ * 提交已写入的n字节数据
+ */
+void RingBufferCommit(RingBuffer *ring, size_t n);
+
+/*
+ * 从套接字读取数据到环形缓存的空闲空间，一次recv读满所有空闲空间
+ * sockfd：套接字描述符
+ * timeout：暂无数据时的等待时间(ms)，0表示不等待
+ * return：num of read bytes，0 超时或缓存已满，-1 对端关闭或出错
+ */
+int RingBufferRecv(RingBuffer *ring, int sockfd, int timeout);
+
+/*
+ * 将环形缓存中的数据发送到套接字，已发送的数据自动丢弃
+ * sockfd：套接字描述符
+ * timeout：套接字不可写时的等待时间(ms)，0表示不等待
+ * return：num of send bytes，0 超时或缓存为空，-1 出错
+ */
+int RingBufferSend(RingBuffer *ring, int sockfd, int timeout);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
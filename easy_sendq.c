@@ -0,0 +1,348 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#include "easy_sendq.h"
+#include "easy_buffer.h"
+
+#define SENDQ_IOV 64 /* 每次writev的最大消息数 */
+
+struct SendNode
+{
+	struct SendNode *next;
+	void *buf;      /* SendQueuePushBuffer时为缓存池的缓存，否则为NULL，数据紧随节点之后 */
+	size_t len;
+};
+
+struct SendQueue
+{
+	EventLoop *loop;
+	int sockfd;
+	size_t max_bytes;
+	size_t queued;              /* 未发送的字节数，原子访问 */
+	int scheduled;              /* 已投递过尚未执行的发送任务 */
+	int refs;                   /* 使用者和投递中的任务各持有一个引用 */
+	int closed;
+	int writing;                /* 已关注EV_WRITE */
+	int error;
+	/* 多生产者单消费者无锁链表 */
+	struct SendNode *head __attribute__((aligned(64)));
+	struct SendNode *tail __attribute__((aligned(64)));
+	struct SendNode stub;
+	/* 以下只由事件循环线程访问：已取出待发送的消息 */
+	struct SendNode *first;
+	struct SendNode *last;
+	size_t offset;              /* first中已发送的字节数 */
+};
+
+static void node_free(struct SendNode *n)
+{
+	BufferFree(n->buf);
+	BufferFree(n);
+}
+
+static const char *node_data(struct SendNode *n)
+{
+	return n->buf ? (const char *)n->buf : (const char *)(n + 1);
+}
+
+static void mpsc_push(SendQueue *q, struct SendNode *n)
+{
+	struct SendNode *prev;
+
+	n->next = NULL;
+	prev = __atomic_exchange_n(&q->head, n, __ATOMIC_ACQ_REL);
+	__atomic_store_n(&prev->next, n, __ATOMIC_RELEASE);
+}
+
+static struct SendNode *mpsc_pop(SendQueue *q)
+{
+	struct SendNode *tail = q->tail;
+	struct SendNode *next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+
+	if (tail == &q->stub)
+	{
+		if (!next)
+			return NULL;
+		q->tail = next;
+		tail = next;
+		next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+	}
+
+	if (next)
+	{
+		q->tail = next;
+		return tail;
+	}
+
+	/* 生产者正在链接下一个节点，稍后由其投递的任务继续发送 */
+	if (tail != __atomic_load_n(&q->head, __ATOMIC_ACQUIRE))
+		return NULL;
+
+	mpsc_push(q, &q->stub);
+	next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+	if (next)
+	{
+		q->tail = next;
+		return tail;
+	}
+	return NULL;
+}
+
+static void queue_release(SendQueue *q)
+{
+	struct SendNode *n;
+
+	if (__atomic_sub_fetch(&q->refs, 1, __ATOMIC_ACQ_REL) != 0)
+		return;
+
+	while (q->first)
+	{
+		n = q->first;
+		q->first = n->next;
+		node_free(n);
+	}
+	while ((n = mpsc_pop(q)) != NULL)
+		node_free(n);
+	free(q);
+}
+
+static void flush_task(EventLoop *loop, void *arg)
+{
+	SendQueue *q = (SendQueue *)arg;
+
+	/* 先清除标志再发送，之后入队的消息会重新投递，不会遗漏 */
+	__atomic_store_n(&q->scheduled, 0, __ATOMIC_SEQ_CST);
+	if (!q->closed)
+		SendQueueFlush(q);
+	queue_release(q);
+}
+
+/*
+ * 入队后按需投递发送任务，已有未执行的任务时不再投递
+ */
+static int schedule_flush(SendQueue *q)
+{
+	if (__atomic_exchange_n(&q->scheduled, 1, __ATOMIC_SEQ_CST))
+		return 0;
+
+	__atomic_add_fetch(&q->refs, 1, __ATOMIC_ACQ_REL);
+	if (EventLoopPost(q->loop, flush_task, q) < 0)
+	{
+		__atomic_store_n(&q->scheduled, 0, __ATOMIC_SEQ_CST);
+		__atomic_sub_fetch(&q->refs, 1, __ATOMIC_ACQ_REL);
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * 创建发送队列
+ * return：queue on success，NULL on fail
+ */
+SendQueue *SendQueueCreate(EventLoop *loop, int sockfd, size_t max_bytes)
+{
+	SendQueue *q;
+
+	if (!loop || sockfd < 0)
+	{
+		errno = EINVAL;
+		return NULL;
+	}
+
+	q = (SendQueue *)aligned_alloc(64, (sizeof(SendQueue) + 63) / 64 * 64);
+	if (!q)
+		return NULL;
+
+	memset(q, 0, sizeof(*q));
+	q->loop = loop;
+	q->sockfd = sockfd;
+	q->max_bytes = max_bytes;
+	q->refs = 1;
+	q->head = q->tail = &q->stub;
+	return q;
+}
+
+/*
+ * 销毁发送队列
+ */
+void SendQueueDestroy(SendQueue *queue)
+{
+	if (!queue)
+		return;
+
+	queue->closed = 1;
+	queue_release(queue);
+}
+
+static int push_node(SendQueue *q, struct SendNode *n)
+{
+	size_t queued = __atomic_add_fetch(&q->queued, n->len, __ATOMIC_RELAXED);
+
+	if (q->max_bytes && queued > q->max_bytes && queued != n->len)
+	{
+		__atomic_sub_fetch(&q->queued, n->len, __ATOMIC_RELAXED);
+		node_free(n);
+		errno = EAGAIN;
+		return -1;
+	}
+
+	mpsc_push(q, n);
+	return schedule_flush(q);
+}
+
+/*
+ * 拷贝一条消息放入队列
+ * return：0 on success，-1 on fail
+ */
+int SendQueuePush(SendQueue *queue, const void *data, size_t len)
+{
+	struct SendNode *n;
+
+	if (!queue || (!data && len))
+	{
+		errno = EINVAL;
+		return -1;
+	}
+
+	n = (struct SendNode *)BufferAlloc(sizeof(*n) + len);
+	if (!n)
+		return -1;
+
+	n->buf = NULL;
+	n->len = len;
+	memcpy(n + 1, data, len);
+	return push_node(queue, n);
+}
+
+/*
+ * 将缓存池中的一条消息放入队列
+ * return：0 on success，-1 on fail
+ */
+int SendQueuePushBuffer(SendQueue *queue, void *buf, size_t len)
+{
+	struct SendNode *n;
+
+	if (!queue || !buf)
+	{
+		BufferFree(buf);
+		errno = EINVAL;
+		return -1;
+	}
+
+	n = (struct SendNode *)BufferAlloc(sizeof(*n));
+	if (!n)
+	{
+		BufferFree(buf);
+		return -1;
+	}
+
+	n->buf = buf;
+	n->len = len;
+	return push_node(queue, n);
+}
+
+/*
+ * 切换是否关注EV_WRITE
+ */
+static void set_writing(SendQueue *q, int on)
+{
+	if (q->writing == on)
+		return;
+
+	if (EventLoopModify(q->loop, q->sockfd, on ? (EV_READ | EV_WRITE) : EV_READ) == 0)
+		q->writing = on;
+}
+
+/*
+ * 发送队列中的数据直到发完或EAGAIN
+ * return：0 on success，-1 on fail
+ */
+int SendQueueFlush(SendQueue *queue)
+{
+	struct iovec iov[SENDQ_IOV];
+	struct msghdr mh;
+	struct SendNode *n;
+	ssize_t ret;
+	size_t sent;
+	int cnt;
+
+	if (!queue)
+		return -1;
+	if (queue->error)
+		return -1;
+
+	while (1)
+	{
+		/* 把新入队的消息移到待发送链表 */
+		while ((n = mpsc_pop(queue)) != NULL)
+		{
+			n->next = NULL;
+			if (queue->last)
+				queue->last->next = n;
+			else
+				queue->first = n;
+			queue->last = n;
+		}
+
+		if (!queue->first)
+		{
+			set_writing(queue, 0);
+			return 0;
+		}
+
+		cnt = 0;
+		for (n = queue->first; n && cnt < SENDQ_IOV; n = n->next)
+		{
+			size_t skip = (n == queue->first) ? queue->offset : 0;
+			iov[cnt].iov_base = (void *)(node_data(n) + skip);
+			iov[cnt].iov_len = n->len - skip;
+			cnt++;
+		}
+
+		memset(&mh, 0, sizeof(mh));
+		mh.msg_iov = iov;
+		mh.msg_iovlen = cnt;
+		ret = sendmsg(queue->sockfd, &mh, MSG_DONTWAIT | MSG_NOSIGNAL);
+		if (ret < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+			{
+				set_writing(queue, 1);
+				return 0;
+			}
+			queue->error = errno;
+			return -1;
+		}
+
+		/* 释放已发完的消息 */
+		__atomic_sub_fetch(&queue->queued, (size_t)ret, __ATOMIC_RELAXED);
+		sent = (size_t)ret;
+		while (queue->first && sent >= queue->first->len - queue->offset)
+		{
+			n = queue->first;
+			sent -= n->len - queue->offset;
+			queue->offset = 0;
+			queue->first = n->next;
+			if (!queue->first)
+				queue->last = NULL;
+			node_free(n);
+		}
+		queue->offset += sent;
+	}
+}
+
+/*
+ * 获取队列中尚未发送的字节数
+ */
+size_t SendQueuePending(SendQueue *queue)
+{
+	return queue ? __atomic_load_n(&queue->queued, __ATOMIC_RELAXED) : 0;
+}
@@ -0,0 +1,70 @@
+/*
+ * 连接发送队列: C接口方式
+ * Copyright FreeCode. All Rights Reserved.
+ * MIT License (https://opensource.org/licenses/MIT)
+ * 2024 by liuqingshuige
+ */
+#ifndef __FREE_EASY_SENDQ_H__
+#define __FREE_EASY_SENDQ_H__
+
+#include <stddef.h>
+
+#include "easy_event.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * 发送队列：任意线程无锁地把消息放入队列，由连接所属的事件循环线程用writev批量发送，
+ * 消息按入队顺序整条发送，不会与其他线程的消息交错
+ */
+typedef struct SendQueue SendQueue;
+
+/*
+ * 创建发送队列
+ * loop：连接所属的事件循环
+ * sockfd：已用EV_READ注册到loop的套接字，发送阻塞时队列会改为EV_READ|EV_WRITE，发送完后恢复为EV_READ
+ * max_bytes：队列中最多积压的字节数，超过时SendQueuePush失败(EAGAIN)，为0表示不限制
+ * return：queue on success，NULL on fail
+ */
+SendQueue *SendQueueCreate(EventLoop *loop, int sockfd, size_t max_bytes);
+
+/*
+ * 销毁发送队列，只能在事件循环线程中调用，且不再有线程入队；未发送的数据被丢弃
+ */
+void SendQueueDestroy(SendQueue *queue);
+
+/*
+ * 拷贝一条消息放入队列，可在任意线程中调用
+ * data：消息数据
+ * len：消息长度，单位字节
+ * return：0 on success，-1 on fail
+ */
+int SendQueuePush(SendQueue *queue, const void *data, size_t len);
+
+/*
+ * 将缓存池中的一条消息放入队列，不拷贝，发送完后由队列调用BufferFree，可在任意线程中调用
+ * buf：BufferAlloc分配的缓存，无论成功与否所有权都转给队列
+ * len：消息长度，单位字节
+ * return：0 on success，-1 on fail
+ */
+int SendQueuePushBuffer(SendQueue *queue, void *buf, size_t len);
+
+/*
+ * 发送队列中的数据直到发完或EAGAIN，只能在事件循环线程中调用，
+ * 入队时会自动投递到事件循环执行，连接的on_write回调中也应调用
+ * return：0 on success（已发完或等待可写），-1 on fail（连接应关闭）
+ */
+int SendQueueFlush(SendQueue *queue);
+
+/*
+ * 获取队列中尚未发送的字节数
+ */
+size_t SendQueuePending(SendQueue *queue);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
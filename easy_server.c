@@ -0,0 +1,618 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* pthread_setaffinity_np */
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <linux/filter.h>
+
+#include "easy_server.h"
+#include "easy_buffer.h"
+#include "easy_timer.h"
+
+#define GROUP_WAIT_MS 100 /* 工作线程检查退出标志的间隔 */
+#define ACCEPTOR_STAT_MS 1000 /* 每秒接受连接数的统计周期 */
+#define ACCEPTOR_RETRY_MS 100 /* accept因资源不足失败后的重试间隔 */
+
+struct UdpGroupWorker
+{
+	int idx;
+	int sockfd;
+	int started;
+	pthread_t tid;
+	struct UdpMsg msgs[UDP_BATCH_MAX];
+	struct UdpListenGroup *group;
+};
+
+struct AcceptorShard
+{
+	int idx;
+	int sockfd;
+	int started;
+	pthread_t tid;
+	int spare_fd;  /* 预留描述符，描述符耗尽时腾出一个用于拒绝连接 */
+	int retry;     /* accept因资源不足中断，需定时重试 */
+	EventLoop *loop;
+	volatile unsigned long long accepted; /* 累计接受的连接数 */
+	volatile unsigned long long rate;     /* 最近一秒接受的连接数 */
+	struct TcpAcceptor *acceptor;
+};
+
+struct TcpAcceptor
+{
+	int nshards;
+	int flags;
+	volatile int stop;
+	TcpAcceptCallback cb;
+	void *arg;
+	struct AcceptorShard *shards;
+};
+
+struct UdpListenGroup
+{
+	int nworkers;
+	int bufsize;
+	int flags;
+	volatile int stop;
+	UdpGroupCallback cb;
+	void *arg;
+	struct UdpGroupWorker *workers;
+};
+
+/*
+ * 将当前线程绑定到指定CPU
+ */
+static void pin_thread_cpu(int cpu)
+{
+	cpu_set_t set;
+	long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+
+	if (ncpu <= 0)
+		return;
+
+	CPU_ZERO(&set);
+	CPU_SET(cpu % ncpu, &set);
+	pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+/*
+ * 创建SO_REUSEPORT套接字并绑定到addr
+ * type：SOCK_STREAM/SOCK_DGRAM
+ * return：sockfd on success，-1 on fail
+ */
+static int reuseport_bind(const struct sockaddr_storage *addr, int type)
+{
+	int sockfd = CreateSocket(addr->ss_family, type);
+	if (sockfd < 0)
+		return -1;
+
+	SetSocketBlock(sockfd, 0); // 非阻塞
+	SetSocketReuseAddr(sockfd, 1);
+	if (SetSocketReusePort(sockfd, 1) < 0)
+	{
+		CloseSocket(sockfd);
+		return -1;
+	}
+
+	socklen_t salen = (addr->ss_family == AF_INET) ? sizeof(struct sockaddr_in) : sizeof(struct sockaddr_in6);
+	if (BindSocket(sockfd, (const struct sockaddr *)addr, salen) < 0)
+	{
+		CloseSocket(sockfd);
+		return -1;
+	}
+	return sockfd;
+}
+
+/*
+ * 在同一地址上打开n个SO_REUSEPORT套接字，按绑定顺序保存在fds中
+ * return：0 on success，-1 on fail
+ */
+static int reuseport_group_bind(const char *host, const char *service, int type, int *fds, int n)
+{
+	int ret = -1, i = 0, k = 0;
+	struct sockaddr_storage addr[32]; /* guess should be enough */
+
+	ret = DomainName2Addr(host, service, addr, 32);
+	if (ret <= 0)
+		return -1;
+
+	for (k=0; k<ret; k++)
+	{
+		for (i=0; i<n; i++)
+		{
+			fds[i] = reuseport_bind(&addr[k], type);
+			if (fds[i] < 0)
+				break;
+		}
+
+		if (i == n)
+			return 0;
+
+		while (i-- > 0) // 该地址绑定失败，尝试下一个
+		{
+			CloseSocket(fds[i]);
+			fds[i] = -1;
+		}
+	}
+	return -1;
+}
+
+/*
+ * 挂载classic BPF程序：返回 当前CPU % n，即由接收数据报的CPU选择组内第几个套接字
+ * return：0 on success，-1 on fail
+ */
+static int attach_cpu_steer(int sockfd, int n)
+{
+	struct sock_filter code[] = {
+		{ BPF_LD | BPF_W | BPF_ABS, 0, 0, SKF_AD_OFF + SKF_AD_CPU },
+		{ BPF_ALU | BPF_MOD | BPF_K, 0, 0, (unsigned int)n },
+		{ BPF_RET | BPF_A, 0, 0, 0 },
+	};
+	struct sock_fprog prog;
+
+	prog.len = sizeof(code) / sizeof(code[0]);
+	prog.filter = code;
+	return setsockopt(sockfd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog, sizeof(prog));
+}
+
+static void *udp_group_worker(void *param)
+{
+	struct UdpGroupWorker *w = (struct UdpGroupWorker *)param;
+	struct UdpListenGroup *g = w->group;
+	int i, n;
+
+	if (g->flags & GROUP_PIN_CPU)
+		pin_thread_cpu(w->idx);
+
+	while (!g->stop)
+	{
+		/* 只补充上一批用掉的缓存，都从本线程的缓存池中取 */
+		for (i=0; i<UDP_BATCH_MAX; i++)
+		{
+			if (!w->msgs[i].buf)
+				w->msgs[i].buf = BufferAlloc(g->bufsize);
+			if (!w->msgs[i].buf)
+				break;
+			w->msgs[i].size = g->bufsize;
+		}
+
+		if (i == 0)
+		{
+			usleep(GROUP_WAIT_MS * 1000);
+			continue;
+		}
+
+		n = UdpRecvSocketBatch(w->sockfd, w->msgs, i, GROUP_WAIT_MS);
+		if (n <= 0)
+			continue;
+
+		g->cb(w->idx, w->sockfd, w->msgs, n, g->arg);
+
+		/* 回调中BufferRef保留的缓存由使用者稍后BufferFree */
+		for (i=0; i<n; i++)
+		{
+			BufferFree(w->msgs[i].buf);
+			w->msgs[i].buf = NULL;
+		}
+	}
+
+	for (i=0; i<UDP_BATCH_MAX; i++)
+	{
+		BufferFree(w->msgs[i].buf);
+		w->msgs[i].buf = NULL;
+	}
+	return NULL;
+}
+
+/*
+ * 创建UDP监听组
+ * return：group on success，NULL on fail
+ */
+UdpListenGroup *UdpListenGroupCreate(const char *host, const char *service, int nworkers, int bufsize, int flags, UdpGroupCallback cb, void *arg)
+{
+	int i;
+	int *fds = NULL;
+	UdpListenGroup *g = NULL;
+
+	if (!cb)
+	{
+		errno = EINVAL;
+		return NULL;
+	}
+
+	if (nworkers <= 0)
+		nworkers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	if (nworkers <= 0)
+		nworkers = 1;
+	if (bufsize <= 0)
+		bufsize = 2048;
+
+	g = (UdpListenGroup *)calloc(1, sizeof(*g));
+	fds = (int *)malloc(nworkers * sizeof(int));
+	if (!g || !fds)
+		goto fail_;
+
+	g->nworkers = nworkers;
+	g->bufsize = bufsize;
+	g->flags = flags;
+	g->cb = cb;
+	g->arg = arg;
+	g->workers = (struct UdpGroupWorker *)calloc(nworkers, sizeof(struct UdpGroupWorker));
+	if (!g->workers)
+		goto fail_;
+
+	for (i=0; i<nworkers; i++)
+		g->workers[i].sockfd = -1;
+
+	if (reuseport_group_bind(host, service, SOCK_DGRAM, fds, nworkers) < 0)
+		goto fail_;
+
+	for (i=0; i<nworkers; i++)
+	{
+		g->workers[i].idx = i;
+		g->workers[i].sockfd = fds[i];
+		g->workers[i].group = g;
+	}
+
+	/* 程序作用于整个reuseport组，挂在任意一个套接字上即可 */
+	if ((flags & GROUP_CPU_STEER) && attach_cpu_steer(fds[0], nworkers) < 0)
+		goto fail_;
+
+	free(fds);
+	return g;
+
+fail_:
+	free(fds);
+	UdpListenGroupDestroy(g);
+	return NULL;
+}
+
+/*
+ * 获取组内第idx个套接字
+ * return：sockfd on success，-1 on fail
+ */
+int UdpListenGroupSocket(UdpListenGroup *group, int idx)
+{
+	if (!group || idx < 0 || idx >= group->nworkers)
+		return -1;
+	return group->workers[idx].sockfd;
+}
+
+/*
+ * 获取组内工作线程数
+ */
+int UdpListenGroupSize(UdpListenGroup *group)
+{
+	return group ? group->nworkers : 0;
+}
+
+/*
+ * 启动工作线程
+ * return：0 on success，-1 on fail
+ */
+int UdpListenGroupStart(UdpListenGroup *group)
+{
+	int i;
+
+	if (!group)
+		return -1;
+
+	for (i=0; i<group->nworkers; i++)
+	{
+		struct UdpGroupWorker *w = &group->workers[i];
+		if (w->started)
+			continue;
+
+		if (pthread_create(&w->tid, NULL, udp_group_worker, w) != 0)
+			return -1;
+		w->started = 1;
+	}
+	return 0;
+}
+
+/*
+ * 停止工作线程，关闭所有套接字并释放监听组
+ */
+void UdpListenGroupDestroy(UdpListenGroup *group)
+{
+	int i;
+
+	if (!group)
+		return;
+
+	group->stop = 1;
+	if (group->workers)
+	{
+		for (i=0; i<group->nworkers; i++)
+		{
+			struct UdpGroupWorker *w = &group->workers[i];
+			if (w->started)
+				pthread_join(w->tid, NULL);
+			CloseSocket(w->sockfd);
+		}
+	}
+	free(group->workers);
+	free(group);
+}
+
+/*
+ * 描述符耗尽时，关闭预留描述符腾出位置，接受一个连接并立即关闭
+ * return：1 已拒绝一个连接，0 队列已空，-1 on fail
+ */
+static int reject_one(struct AcceptorShard *sh)
+{
+	int clientfd;
+
+	if (sh->spare_fd < 0)
+		return -1;
+
+	close(sh->spare_fd);
+	clientfd = accept(sh->sockfd, NULL, NULL);
+	if (clientfd >= 0)
+		close(clientfd);
+	else if (errno == EAGAIN || errno == EWOULDBLOCK)
+		clientfd = 0;
+
+	/* 其他线程可能已占用腾出的描述符，此时只能定时重试 */
+	sh->spare_fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+	if (clientfd > 0)
+		return 1;
+	return (clientfd == 0) ? 0 : -1;
+}
+
+/*
+ * 监听套接字可读：一直accept直到EAGAIN
+ * 监听套接字为边沿触发，因资源不足中断时已排队的连接不会再有通知，需由工作线程定时重试
+ */
+static void acceptor_on_read(EventLoop *loop, int fd, int events, void *arg)
+{
+	struct AcceptorShard *sh = (struct AcceptorShard *)arg;
+	struct TcpAcceptor *acc = sh->acceptor;
+	struct sockaddr_storage addr;
+	socklen_t len;
+	int clientfd, ret;
+
+	sh->retry = 0;
+	while (1)
+	{
+		len = sizeof(addr);
+		clientfd = accept4(fd, (struct sockaddr *)&addr, &len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+		if (clientfd < 0)
+		{
+			if (errno == EINTR || errno == ECONNABORTED)
+				continue;
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				break;
+
+			if (errno == EMFILE || errno == ENFILE)
+			{
+				ret = reject_one(sh);
+				if (ret > 0)
+					continue;
+				if (ret == 0)
+					break;
+			}
+
+			sh->retry = 1; // ENOBUFS、ENOMEM或无法腾出描述符
+			break;
+		}
+
+		sh->accepted++;
+		acc->cb(sh->idx, loop, clientfd, &addr, acc->arg);
+	}
+}
+
+static void *acceptor_worker(void *param)
+{
+	struct AcceptorShard *sh = (struct AcceptorShard *)param;
+	struct TcpAcceptor *acc = sh->acceptor;
+	unsigned long long last_count = 0;
+	long long last_ms, now, wait;
+
+	if (acc->flags & GROUP_PIN_CPU)
+		pin_thread_cpu(sh->idx);
+
+	last_ms = TimerNow();
+	while (!acc->stop)
+	{
+		now = TimerNow();
+		wait = last_ms + ACCEPTOR_STAT_MS - now;
+		if (wait <= 0)
+		{
+			sh->rate = (sh->accepted - last_count) * 1000 / (now - last_ms);
+			last_count = sh->accepted;
+			last_ms = now;
+			wait = ACCEPTOR_STAT_MS;
+		}
+
+		if (sh->retry && wait > ACCEPTOR_RETRY_MS)
+			wait = ACCEPTOR_RETRY_MS;
+
+		if (EventLoopRunOnce(sh->loop, (int)wait) < 0)
+			break;
+
+		if (sh->retry)
+			acceptor_on_read(sh->loop, sh->sockfd, EV_READ, sh);
+	}
+	return NULL;
+}
+
+/*
+ * 创建分片TCP接收器
+ * return：acceptor on success，NULL on fail
+ */
+TcpAcceptor *TcpAcceptorCreate(const char *host, const char *service, int nshards, int backlog, int flags, TcpAcceptCallback cb, void *arg)
+{
+	int i;
+	int *fds = NULL;
+	TcpAcceptor *acc = NULL;
+
+	if (!cb)
+	{
+		errno = EINVAL;
+		return NULL;
+	}
+
+	if (nshards <= 0)
+		nshards = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	if (nshards <= 0)
+		nshards = 1;
+
+	acc = (TcpAcceptor *)calloc(1, sizeof(*acc));
+	fds = (int *)malloc(nshards * sizeof(int));
+	if (!acc || !fds)
+		goto fail_;
+
+	acc->nshards = nshards;
+	acc->flags = flags;
+	acc->cb = cb;
+	acc->arg = arg;
+	acc->shards = (struct AcceptorShard *)calloc(nshards, sizeof(struct AcceptorShard));
+	if (!acc->shards)
+		goto fail_;
+
+	for (i=0; i<nshards; i++)
+	{
+		acc->shards[i].sockfd = -1;
+		acc->shards[i].spare_fd = -1;
+	}
+
+	if (reuseport_group_bind(host, service, SOCK_STREAM, fds, nshards) < 0)
+		goto fail_;
+
+	for (i=0; i<nshards; i++)
+	{
+		struct AcceptorShard *sh = &acc->shards[i];
+		sh->idx = i;
+		sh->sockfd = fds[i];
+		sh->acceptor = acc;
+	}
+
+	for (i=0; i<nshards; i++)
+	{
+		struct AcceptorShard *sh = &acc->shards[i];
+		if (ListenSocket(sh->sockfd, backlog) < 0)
+			goto fail_;
+
+		sh->spare_fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+		if (sh->spare_fd < 0)
+			goto fail_;
+
+		sh->loop = EventLoopCreate(0);
+		if (!sh->loop)
+			goto fail_;
+
+		if (EventLoopAdd(sh->loop, sh->sockfd, EV_READ, acceptor_on_read, NULL, sh) < 0)
+			goto fail_;
+	}
+
+	if ((flags & GROUP_CPU_STEER) && attach_cpu_steer(fds[0], nshards) < 0)
+		goto fail_;
+
+	free(fds);
+	return acc;
+
+fail_:
+	free(fds);
+	TcpAcceptorDestroy(acc);
+	return NULL;
+}
+
+/*
+ * 获取分片数
+ */
+int TcpAcceptorSize(TcpAcceptor *acceptor)
+{
+	return acceptor ? acceptor->nshards : 0;
+}
+
+/*
+ * 获取第idx个分片的事件循环
+ * return：loop on success，NULL on fail
+ */
+EventLoop *TcpAcceptorLoop(TcpAcceptor *acceptor, int idx)
+{
+	if (!acceptor || idx < 0 || idx >= acceptor->nshards)
+		return NULL;
+	return acceptor->shards[idx].loop;
+}
+
+/*
+ * 启动工作线程
+ * return：0 on success，-1 on fail
+ */
+int TcpAcceptorStart(TcpAcceptor *acceptor)
+{
+	int i;
+
+	if (!acceptor)
+		return -1;
+
+	for (i=0; i<acceptor->nshards; i++)
+	{
+		struct AcceptorShard *sh = &acceptor->shards[i];
+		if (sh->started)
+			continue;
+
+		if (pthread_create(&sh->tid, NULL, acceptor_worker, sh) != 0)
+			return -1;
+		sh->started = 1;
+	}
+	return 0;
+}
+
+/*
+ * 获取第idx个分片的接受连接统计
+ * return：0 on success，-1 on fail
+ */
+int TcpAcceptorStats(TcpAcceptor *acceptor, int idx, unsigned long long *total, unsigned long long *per_sec)
+{
+	if (!acceptor || idx < 0 || idx >= acceptor->nshards)
+		return -1;
+
+	if (total)
+		*total = acceptor->shards[idx].accepted;
+	if (per_sec)
+		*per_sec = acceptor->shards[idx].rate;
+	return 0;
+}
+
+/*
+ * 停止工作线程，关闭监听套接字并释放接收器
+ */
+void TcpAcceptorDestroy(TcpAcceptor *acceptor)
+{
+	int i;
+
+	if (!acceptor)
+		return;
+
+	acceptor->stop = 1;
+	if (acceptor->shards)
+	{
+		for (i=0; i<acceptor->nshards; i++)
+		{
+			struct AcceptorShard *sh = &acceptor->shards[i];
+			if (sh->started)
+			{
+				EventLoopStop(sh->loop);
+				pthread_join(sh->tid, NULL);
+			}
+			EventLoopDestroy(sh->loop);
+			CloseSocket(sh->sockfd);
+			if (sh->spare_fd >= 0)
+				close(sh->spare_fd);
+		}
+	}
+	free(acceptor->shards);
+	free(acceptor);
+}
@@ -0,0 +1,130 @@
+/*
+ * 多线程服务端封装: C接口方式
+ * Copyright FreeCode. All Rights Reserved.
+ * MIT License (https://opensource.org/licenses/MIT)
+ * 2024 by liuqingshuige
+ */
+#ifndef __FREE_EASY_SERVER_H__
+#define __FREE_EASY_SERVER_H__
+
+#include "easy_socket.h"
+#include "easy_event.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 监听组标志 */
+#define GROUP_PIN_CPU    0x01 /* 第i个工作线程绑定到第i个CPU */
+#define GROUP_CPU_STEER  0x02 /* 挂载SO_ATTACH_REUSEPORT_CBPF程序，由接收数据报/连接的CPU选择套接字，需配合GROUP_PIN_CPU */
+
+typedef struct UdpListenGroup UdpListenGroup;
+
+/*
+ * UDP监听组数据报回调，在工作线程中调用
+ * idx：工作线程序号，0 ~ nworkers-1
+ * sockfd：该工作线程的套接字，可用于回复
+ * msgs：本次收到的数据报，msgs[i].buf来自缓存池(easy_buffer.h)，回调返回后被回收；
+ *       需要在回调之后继续使用时调用BufferRef保留，用完后在任意线程中调用BufferFree
+ * count：msgs数组元素个数
+ * arg：用户参数
+ */
+typedef void (*UdpGroupCallback)(int idx, int sockfd, struct UdpMsg *msgs, int count, void *arg);
+
+/*
+ * 创建UDP监听组：在同一地址上打开nworkers个SO_REUSEPORT套接字，每个套接字由一个工作线程接收
+ * 注意：多播数据报会复制给组内每个已加入该多播组的套接字，多播场景应只在部分套接字上调用UdpJoinMcast
+ * host：主机名、域名或者点分十进制IP地址、或者IPv6的16进制串
+ * service：端口或者服务名如ftp、ntp等
+ * nworkers：工作线程数，<=0则取CPU个数
+ * bufsize：每个数据报的接收缓存大小，单位字节，<=0则取2048，超过64KB时缓存池退化为malloc
+ * flags：GROUP_PIN_CPU/GROUP_CPU_STEER组合
+ * cb：数据报回调
+ * arg：用户参数
+ * return：group on success，NULL on fail
+ */
+UdpListenGroup *UdpListenGroupCreate(const char *host, const char *service, int nworkers, int bufsize, int flags, UdpGroupCallback cb, void *arg);
+
+/*
+ * 获取组内第idx个套接字，可用于加入多播组或设置套接字选项
+ * return：sockfd on success，-1 on fail
+ */
+int UdpListenGroupSocket(UdpListenGroup *group, int idx);
+
+/*
+ * 获取组内工作线程数
+ */
+int UdpListenGroupSize(UdpListenGroup *group);
+
+/*
+ * 启动工作线程
+ * return：0 on success，-1 on fail
+ */
+int UdpListenGroupStart(UdpListenGroup *group);
+
+/*
+ * 停止工作线程，关闭所有套接字并释放监听组
+ */
+void UdpListenGroupDestroy(UdpListenGroup *group);
+
+typedef struct TcpAcceptor TcpAcceptor;
+
+/*
+ * 新连接回调，在该分片的工作线程中调用
+ * idx：分片序号，0 ~ nshards-1
+ * loop：该分片的事件循环，可将clientfd注册到其中
+ * clientfd：已接受的连接，已设置为非阻塞和CLOEXEC，由回调负责关闭
+ * addr：客户端地址
+ * arg：用户参数
+ */
+typedef void (*TcpAcceptCallback)(int idx, EventLoop *loop, int clientfd, const struct sockaddr_storage *addr, void *arg);
+
+/*
+ * 创建分片TCP接收器：在同一地址上打开nshards个SO_REUSEPORT监听套接字，
+ * 每个分片一个工作线程和一个事件循环，可读时用accept4循环接受连接直到EAGAIN
+ * host：主机名、域名或者点分十进制IP地址、或者IPv6的16进制串
+ * service：端口或者服务名如ftp、ntp等
+ * nshards：分片数，<=0则取CPU个数
+ * backlog：每个监听套接字的未完成连接队列的最大长度
+ * flags：GROUP_PIN_CPU/GROUP_CPU_STEER组合
+ * cb：新连接回调
+ * arg：用户参数
+ * return：acceptor on success，NULL on fail
+ */
+TcpAcceptor *TcpAcceptorCreate(const char *host, const char *service, int nshards, int backlog, int flags, TcpAcceptCallback cb, void *arg);
+
+/*
+ * 获取分片数
+ */
+int TcpAcceptorSize(TcpAcceptor *acceptor);
+
+/*
+ * 获取第idx个分片的事件循环
+ * return：loop on success，NULL on fail
+ */
+EventLoop *TcpAcceptorLoop(TcpAcceptor *acceptor, int idx);
+
+/*
+ * 启动工作线程
+ * return：0 on success，-1 on fail
+ */
+int TcpAcceptorStart(TcpAcceptor *acceptor);
+
+/*
+ * 获取第idx个分片的接受连接统计
+ * total：保存累计接受的连接数，可为NULL
+ * per_sec：保存最近一秒接受的连接数，可为NULL
+ * return：0 on success，-1 on fail
+ */
+int TcpAcceptorStats(TcpAcceptor *acceptor, int idx, unsigned long long *total, unsigned long long *per_sec);
+
+/*
+ * 停止工作线程，关闭监听套接字并释放接收器（已接受的连接由用户负责关闭）
+ */
+void TcpAcceptorDestroy(TcpAcceptor *acceptor);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
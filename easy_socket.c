@@ -1,9 +1,14 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE /* recvmmsg */
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <string.h>
 #include <errno.h>
+#include <limits.h>
 #include <netdb.h>
 #include <ifaddrs.h>
 #include <ctype.h>
@@ -12,12 +17,61 @@
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <netinet/tcp.h>
+#include <netinet/udp.h>
 #include <sys/ioctl.h>
-#include <sys/select.h>
+#include <sys/uio.h>
+#include <sys/stat.h>
+#include <sys/sendfile.h>
+#include <poll.h>
 #include <sys/time.h>
 #include <net/if.h>
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
+#include <linux/sockios.h>
 
 #include "easy_socket.h"
+#include "easy_resolver.h"
+#include "easy_netif.h"
+#include "easy_stats.h"
+#include "easy_timer.h"
+
+#ifdef EASY_SOCKET_STATS
+/*
+ * 统计记录：公开的I/O函数以STATS_ENTER/STATS_LEAVE包住实际实现，
+ * 实现中的系统调用以STATS_SYSCALL/STATS_WAIT包住，均不改变返回值和errno
+ */
+#define STATS_ENTER(op) struct SocketStatsFrame stats_frame_; easy_stats_enter(&stats_frame_, (op))
+#define STATS_LEAVE(failed, bytes, is_short) easy_stats_leave(&stats_frame_, (failed), (bytes), (is_short))
+#define STATS_SYSCALL(expr) __extension__ ({ __typeof__(expr) stats_ret_ = (expr); easy_stats_syscall(stats_ret_ < 0); stats_ret_; })
+#define STATS_WAIT(expr) __extension__ ({ int stats_ret_ = (expr); easy_stats_wait(stats_ret_); stats_ret_; })
+#define STATS_TIMEOUT() easy_stats_timeout()
+
+static size_t udp_msgs_bytes(const struct UdpMsg *msgs, int n)
+{
+	size_t total = 0;
+	int i;
+
+	for (i=0; i<n; i++)
+		total += msgs[i].length;
+	return total;
+}
+
+static size_t udp_send_msgs_bytes(const struct UdpSendMsg *msgs, int n)
+{
+	size_t total = 0;
+	int i;
+
+	for (i=0; i<n; i++)
+		total += msgs[i].length;
+	return total;
+}
+#else
+#define STATS_ENTER(op)
+#define STATS_LEAVE(failed, bytes, is_short)
+#define STATS_SYSCALL(expr) (expr)
+#define STATS_WAIT(expr) (expr)
+#define STATS_TIMEOUT()
+#endif
 
 /*
  * 获取套接字地址族
@@ -34,6 +88,23 @@ static int sockfd_to_family(int sockfd)
 	return ss.ss_family;
 }
 
+/*
+ * 等待套接字就绪，以poll代替select，不受FD_SETSIZE(1024)限制
+ * sockfd：套接字句柄
+ * events：POLLIN/POLLOUT
+ * timeout：超时时间(ms)，小于0表示一直等待
+ * return：>0 就绪（含出错/对端关闭），0 超时，-1 出错
+ */
+static int wait_socket(int sockfd, short events, int timeout)
+{
+	struct pollfd pfd;
+
+	pfd.fd = sockfd;
+	pfd.events = events;
+	pfd.revents = 0;
+	return STATS_WAIT(poll(&pfd, 1, timeout));
+}
+
 static int family_to_level(int family)
 {
 	int level = IPPROTO_IP;
@@ -45,8 +116,53 @@ static int family_to_level(int family)
 	return level;
 }
 
+/* 0~255的十进制字符串，第4个字节为长度 */
+static const char g_dec4[256][4] = {
+	"0\0\0\1", "1\0\0\1", "2\0\0\1", "3\0\0\1", "4\0\0\1", "5\0\0\1", "6\0\0\1", "7\0\0\1",
+	"8\0\0\1", "9\0\0\1", "10\0\2", "11\0\2", "12\0\2", "13\0\2", "14\0\2", "15\0\2",
+	"16\0\2", "17\0\2", "18\0\2", "19\0\2", "20\0\2", "21\0\2", "22\0\2", "23\0\2",
+	"24\0\2", "25\0\2", "26\0\2", "27\0\2", "28\0\2", "29\0\2", "30\0\2", "31\0\2",
+	"32\0\2", "33\0\2", "34\0\2", "35\0\2", "36\0\2", "37\0\2", "38\0\2", "39\0\2",
+	"40\0\2", "41\0\2", "42\0\2", "43\0\2", "44\0\2", "45\0\2", "46\0\2", "47\0\2",
+	"48\0\2", "49\0\2", "50\0\2", "51\0\2", "52\0\2", "53\0\2", "54\0\2", "55\0\2",
+	"56\0\2", "57\0\2", "58\0\2", "59\0\2", "60\0\2", "61\0\2", "62\0\2", "63\0\2",
+	"64\0\2", "65\0\2", "66\0\2", "67\0\2", "68\0\2", "69\0\2", "70\0\2", "71\0\2",
+	"72\0\2", "73\0\2", "74\0\2", "75\0\2", "76\0\2", "77\0\2", "78\0\2", "79\0\2",
+	"80\0\2", "81\0\2", "82\0\2", "83\0\2", "84\0\2", "85\0\2", "86\0\2", "87\0\2",
+	"88\0\2", "89\0\2", "90\0\2", "91\0\2", "92\0\2", "93\0\2", "94\0\2", "95\0\2",
+	"96\0\2", "97\0\2", "98\0\2", "99\0\2", "100\3", "101\3", "102\3", "103\3",
+	"104\3", "105\3", "106\3", "107\3", "108\3", "109\3", "110\3", "111\3",
+	"112\3", "113\3", "114\3", "115\3", "116\3", "117\3", "118\3", "119\3",
+	"120\3", "121\3", "122\3", "123\3", "124\3", "125\3", "126\3", "127\3",
+	"128\3", "129\3", "130\3", "131\3", "132\3", "133\3", "134\3", "135\3",
+	"136\3", "137\3", "138\3", "139\3", "140\3", "141\3", "142\3", "143\3",
+	"144\3", "145\3", "146\3", "147\3", "148\3", "149\3", "150\3", "151\3",
+	"152\3", "153\3", "154\3", "155\3", "156\3", "157\3", "158\3", "159\3",
+	"160\3", "161\3", "162\3", "163\3", "164\3", "165\3", "166\3", "167\3",
+	"168\3", "169\3", "170\3", "171\3", "172\3", "173\3", "174\3", "175\3",
+	"176\3", "177\3", "178\3", "179\3", "180\3", "181\3", "182\3", "183\3",
+	"184\3", "185\3", "186\3", "187\3", "188\3", "189\3", "190\3", "191\3",
+	"192\3", "193\3", "194\3", "195\3", "196\3", "197\3", "198\3", "199\3",
+	"200\3", "201\3", "202\3", "203\3", "204\3", "205\3", "206\3", "207\3",
+	"208\3", "209\3", "210\3", "211\3", "212\3", "213\3", "214\3", "215\3",
+	"216\3", "217\3", "218\3", "219\3", "220\3", "221\3", "222\3", "223\3",
+	"224\3", "225\3", "226\3", "227\3", "228\3", "229\3", "230\3", "231\3",
+	"232\3", "233\3", "234\3", "235\3", "236\3", "237\3", "238\3", "239\3",
+	"240\3", "241\3", "242\3", "243\3", "244\3", "245\3", "246\3", "247\3",
+	"248\3", "249\3", "250\3", "251\3", "252\3", "253\3", "254\3", "255\3",
+};
+
+static const char g_hex[] = "0123456789abcdef";
+
+/* 十六进制字符的值加1，非十六进制字符为0 */
+static const unsigned char g_hexval[256] = {
+	['0'] = 1, ['1'] = 2, ['2'] = 3, ['3'] = 4, ['4'] = 5, ['5'] = 6, ['6'] = 7, ['7'] = 8, ['8'] = 9, ['9'] = 10,
+	['a'] = 11, ['b'] = 12, ['c'] = 13, ['d'] = 14, ['e'] = 15, ['f'] = 16,
+	['A'] = 11, ['B'] = 12, ['C'] = 13, ['D'] = 14, ['E'] = 15, ['F'] = 16,
+};
+
 /*
- * 将网络字节序的IPv4地址转换为点分十进制格式
+ * 将网络字节序的IPv4地址转换为点分十进制格式，查表生成，不调用stdio
  * src：待转换的IP地址
  * dest：保存转换结果
  * size：dest长度，单位字节
@@ -54,14 +170,46 @@ static int family_to_level(int family)
  */
 static const char *inet_ntop4(const unsigned char *src, char *dest, size_t size)
 {
-	const char *fmt = "%u.%u.%u.%u";
-	char temp[20] = {0};
-	int ret = snprintf(temp, sizeof(temp), fmt, src[0], src[1], src[2], src[3]);
-	return (ret >= size) ? NULL : strcpy(dest, temp);
+	char tmp[16];
+	char *tp = tmp;
+	const char *d;
+	int i;
+
+	/* 每段固定拷贝4字节再按实际长度前进，多写的字节被后续内容覆盖 */
+	for (i=0; i<4; i++)
+	{
+		d = g_dec4[src[i]];
+		memcpy(tp, d, 4);
+		tp += d[3];
+		*tp++ = '.';
+	}
+	tp[-1] = '\0';
+
+	if ((size_t)(tp - tmp) > size)
+		return NULL;
+	return (const char *)memcpy(dest, tmp, tp - tmp);
+}
+
+/*
+ * 输出不带前导0的16进制数
+ */
+static char *put_hex16(char *tp, unsigned int w)
+{
+	int n = 1 + (w > 0xf) + (w > 0xff) + (w > 0xfff);
+
+	switch (n)
+	{
+		case 4: *tp++ = g_hex[(w >> 12) & 0xf]; /* fall through */
+		case 3: *tp++ = g_hex[(w >> 8) & 0xf];  /* fall through */
+		case 2: *tp++ = g_hex[(w >> 4) & 0xf];  /* fall through */
+		default: *tp++ = g_hex[w & 0xf];
+	}
+	return tp;
 }
 
 /*
- * 将网络字节序的IPv6地址（16byte，128bit）转换为x:x:x:x:x:x:x:x格式
+ * 将网络字节序的IPv6地址（16byte，128bit）转换为RFC 5952格式：
+ * 小写、去掉前导0、最长的连续2个以上0段压缩为::（等长时取第一个），兼容/映射IPv4地址输出为点分十进制
  * src：待转换的IP地址
  * dest：保存转换结果
  * size：dest长度，单位字节
@@ -69,94 +217,203 @@ static const char *inet_ntop4(const unsigned char *src, char *dest, size_t size)
  */
 static const char *inet_ntop6(const unsigned char *src, char *dest, size_t size)
 {
-	char *tp = 0;
-	char tmp[128] = {0};
-	struct
-	{
-		int base;
-		int len;
-	} best = {-1, 0}, cur = {-1, 0};
+	char tmp[64];
+	char *tp = tmp;
 	unsigned int words[8];
+	int best_base = -1, best_len = 0;
+	int cur_base = -1, cur_len = 0;
 	int i;
 
-	// 将字节转换为字
-	for (i=0; i<16; i+=2)
-	{
-		words[i/2] = (src[i] << 8) | (src[i+1]);
-	}
-
 	for (i=0; i<8; i++)
 	{
+		words[i] = (src[2*i] << 8) | src[2*i+1];
 		if (words[i] == 0)
 		{
-			if (cur.base == -1)
-			{
-				cur.base = i, cur.len = 1;
-			}
-			else
+			if (cur_base == -1)
+				cur_base = i;
+			cur_len++;
+			if (cur_len > best_len)
 			{
-				cur.len++;
+				best_base = cur_base;
+				best_len = cur_len;
 			}
 		}
 		else
 		{
-			if (cur.base != -1)
-			{
-				if (best.base == -1 || cur.len > best.len)
-				{
-					best = cur;
-				}
-				cur.base = -1;
-			}
+			cur_base = -1;
+			cur_len = 0;
 		}
 	}
 
-	if (cur.base != -1)
+	if (best_len < 2)
+		best_base = -1;
+
+	for (i=0; i<8; i++)
 	{
-		if (best.base == -1 || cur.len > best.len)
+		if (i == best_base)
+		{
+			*tp++ = ':';
+			i += best_len - 1;
+			if (i == 7)
+				*tp++ = ':';
+			continue;
+		}
+
+		if (i != 0)
+			*tp++ = ':';
+
+		if (i == 6 && best_base == 0 && (best_len == 6 || (best_len == 5 && words[5] == 0xFFFF)))
 		{
-			best = cur;
+			inet_ntop4(src + 12, tp, sizeof(tmp) - (tp - tmp));
+			tp += strlen(tp);
+			break;
 		}
+
+		tp = put_hex16(tp, words[i]);
 	}
+	*tp++ = '\0';
+
+	if ((size_t)(tp - tmp) > size)
+		return NULL;
+	return (const char *)memcpy(dest, tmp, tp - tmp);
+}
+
+/*
+ * 解析点分十进制IPv4地址，只接受4段、无前导0的十进制格式，与inet_pton一致
+ * return：1 on success，0 格式错误
+ */
+static int inet_pton4(const char *src, unsigned char *dst)
+{
+	unsigned char tmp[4];
+	unsigned int val = 0, c;
+	int octets = 0, digits = 0;
 
-	if (best.base != -1 && best.len < 2)
+	for (;; src++)
 	{
-		best.base = -1;
+		c = (unsigned char)*src;
+		if (c - '0' < 10)
+		{
+			if (digits && val == 0) // 前导0
+				return 0;
+			val = val * 10 + (c - '0');
+			if (val > 255)
+				return 0;
+			digits++;
+		}
+		else if (c == '.' || c == '\0')
+		{
+			if (!digits || octets == 4)
+				return 0;
+			tmp[octets++] = (unsigned char)val;
+			val = 0;
+			digits = 0;
+			if (c == '\0')
+				break;
+		}
+		else
+		{
+			return 0;
+		}
 	}
 
-	tp = tmp;
-	for (i=0; i<8; i++)
+	if (octets != 4)
+		return 0;
+	memcpy(dst, tmp, 4);
+	return 1;
+}
+
+/*
+ * 解析IPv6地址，支持::压缩和结尾的点分十进制IPv4地址
+ * return：1 on success，0 格式错误
+ */
+static int inet_pton6(const char *src, unsigned char *dst)
+{
+	unsigned char tmp[16];
+	unsigned char *tp = tmp, *endp = tmp + 16, *colonp = NULL;
+	const char *curtok;
+	unsigned int val = 0, ch;
+	int digits = 0, x;
+	size_t n;
+
+	memset(tmp, 0, sizeof(tmp));
+
+	/* 开头的:必须是:: */
+	if (*src == ':' && *++src != ':')
+		return 0;
+
+	curtok = src;
+	while ((ch = (unsigned char)*src++) != '\0')
 	{
-		if (best.base != -1 && i >= best.base && i < (best.base + best.len))
+		x = g_hexval[ch];
+		if (x)
 		{
-			if (i == best.base)
-				*tp++ = ':';
+			if (++digits > 4)
+				return 0;
+			val = (val << 4) | (x - 1);
 			continue;
 		}
 
-		if (i != 0)
+		if (ch == ':')
 		{
-			*tp++ = ':';
+			curtok = src;
+			if (!digits)
+			{
+				if (colonp)
+					return 0;
+				colonp = tp;
+				continue;
+			}
+			if (*src == '\0' || tp + 2 > endp)
+				return 0;
+			*tp++ = (unsigned char)(val >> 8);
+			*tp++ = (unsigned char)val;
+			val = 0;
+			digits = 0;
+			continue;
 		}
 
-		if (i == 6 && best.base == 0 && (best.len == 6 || (best.len == 5 && words[5] == 0xFFFF)))
+		if (ch == '.' && tp + 4 <= endp && inet_pton4(curtok, tp) > 0)
 		{
-			if (!inet_ntop4(src + 12, tp, sizeof(tmp) - (tp - tmp)))
-				return NULL;
-			tp += strlen(tp);
+			tp += 4;
+			digits = 0;
 			break;
 		}
+		return 0;
+	}
 
-		tp += sprintf(tp, "%x", words[i]);
+	if (digits)
+	{
+		if (tp + 2 > endp)
+			return 0;
+		*tp++ = (unsigned char)(val >> 8);
+		*tp++ = (unsigned char)val;
 	}
 
-	if (best.base != -1 && (best.base + best.len) == 8)
+	if (colonp)
 	{
-		*tp++ = ':';
+		if (tp == endp)
+			return 0;
+		n = tp - colonp;
+		memmove(endp - n, colonp, n);
+		memset(colonp, 0, (endp - n) - colonp);
+		tp = endp;
 	}
-	*tp++ = '\0';
 
-	return ((size_t)(tp - tmp) >= size) ? NULL : strcpy(dest, tmp);
+	if (tp != endp)
+		return 0;
+	memcpy(dst, tmp, 16);
+	return 1;
+}
+
+int inet_pton2(int family, const char *src, void *dst)
+{
+	switch (family)
+	{
+		case AF_INET: return inet_pton4(src, (unsigned char *)dst);
+		case AF_INET6: return inet_pton6(src, (unsigned char *)dst);
+	}
+	errno = EAFNOSUPPORT;
+	return -1;
 }
 
 const char *inet_ntop2(int family, const void *src, char *dst, size_t size)
@@ -198,45 +455,7 @@ const char *inet_ntop3(const struct sockaddr *sa, char *dst, size_t size)
  */
 int DomainName2Addr(const char *host, const char *serv, struct sockaddr_storage *addr, int count)
 {
-	struct addrinfo hints, *result, *tmp;
-	int ret = 0, n = 0, idx = 0, exist = 0;
-
-	memset(&hints, 0, sizeof(hints));
-	hints.ai_family = AF_UNSPEC;
-
-	ret = getaddrinfo(host, serv, &hints, &result);
-	if (ret != 0)
-		return -1;
-
-	tmp = result;
-	while (tmp)
-	{
-		exist = 0;
-		for (idx=0; idx<n; idx++) // 去重
-		{
-			if (addr[idx].ss_family == tmp->ai_family)
-			{
-				if (0 == memcmp(&addr[idx], tmp->ai_addr, tmp->ai_addrlen))
-				{
-					exist = 1;
-					break;
-				}
-			}
-		}
-
-		if (exist)
-		{
-			tmp = tmp->ai_next;
-			continue;
-		}
-
-		memcpy(&addr[n++], tmp->ai_addr, tmp->ai_addrlen);
-		if (n >= count)
-			break;
-		tmp = tmp->ai_next;
-	}
-    freeaddrinfo(result); /* No longer needed */
-    return n;
+	return ResolverLookup(host, serv, addr, count);
 }
 
 /*
@@ -250,6 +469,14 @@ const char *GetLocalIpv4(char *dest, size_t size)
 	struct ifaddrs *ifaddr, *ifa;
 	int family;
 	const char *ptr = NULL;
+	unsigned char addr[16];
+
+	if (NetifCacheRunning()) // 网卡缓存已启动时直接读缓存
+	{
+		if (NetifGetAddr(NULL, AF_INET, addr) < 0)
+			return NULL;
+		return inet_ntop4(addr, dest, size);
+	}
 
 	if (getifaddrs(&ifaddr) == -1)
 	{
@@ -285,6 +512,14 @@ const char *GetLocalIpv6(char *dest, size_t size)
 	struct ifaddrs *ifaddr, *ifa;
 	int family;
 	const char *ptr = NULL;
+	unsigned char addr[16];
+
+	if (NetifCacheRunning())
+	{
+		if (NetifGetAddr(NULL, AF_INET6, addr) < 0)
+			return NULL;
+		return inet_ntop6(addr, dest, size);
+	}
 
 	if (getifaddrs(&ifaddr) == -1)
 	{
@@ -320,6 +555,19 @@ int GetLocalNetcard(char dest[][64], size_t size)
 	struct ifaddrs *ifaddr, *ifa;
 	int i, exist = 0, n = 0;
 
+	if (NetifCacheRunning())
+	{
+		struct NetifInfo *info = (struct NetifInfo *)malloc((size ? size : 1) * sizeof(struct NetifInfo));
+		if (!info)
+			return -1;
+
+		n = NetifList(info, (int)size);
+		for (i=0; i<n && i<size; i++)
+			strcpy(dest[i], info[i].name);
+		free(info);
+		return (n < 0) ? -1 : i;
+	}
+
 	if (getifaddrs(&ifaddr) == -1)
 	{
 		return -1;
@@ -362,13 +610,23 @@ int GetMacAddr(const char *interface, unsigned char mac[6])
 	struct ifreq ifr;
 	int ret = -1;
 
+	if (!interface)
+		interface = "eth0";
+
+	if (NetifCacheRunning())
+	{
+		struct NetifInfo info;
+		if (NetifGetByName(interface, &info) < 0)
+			return -1;
+		if (mac)
+			memcpy(mac, info.mac, 6);
+		return 0;
+	}
+
 	sockfd = CreateUdpSocket4();
 	if (sockfd < 0)
 		return -1;
 
-	if (!interface)
-		interface = "eth0";
-
 	strncpy(ifr.ifr_name, interface, sizeof(ifr.ifr_name));
 
 	ret = ioctl(sockfd, SIOCGIFHWADDR, &ifr);
@@ -429,7 +687,7 @@ int GetMacAddr2(const char *interface, unsigned char *buff, size_t size, const c
  */
 int CreateSocket(int family, int type)
 {
-	int sockfd = socket(family, type | SOCK_CLOEXEC, 0);
+	int sockfd = STATS_SYSCALL(socket(family, type | SOCK_CLOEXEC, 0));
 	return sockfd;
 }
 
@@ -439,7 +697,7 @@ int CreateSocket(int family, int type)
  */
 int CloseSocket(int sockfd)
 {
-	return (sockfd != -1) ? close(sockfd) : -1;
+	return (sockfd != -1) ? STATS_SYSCALL(close(sockfd)) : -1;
 }
 
 /*
@@ -522,7 +780,11 @@ int BindSocket4(int sockfd, const char *ipaddr, unsigned short port)
 
 	addr.sin_family = AF_INET;
 	addr.sin_port = htons(port);
-	addr.sin_addr.s_addr = ipaddr ? inet_addr(ipaddr) : 0;
+	if (ipaddr && inet_pton4(ipaddr, (unsigned char *)&addr.sin_addr.s_addr) != 1)
+	{
+		errno = EINVAL;
+		return -1;
+	}
 
 	return BindSocket(sockfd, (struct sockaddr *)&addr, sizeof(addr));
 }
@@ -545,7 +807,7 @@ int BindSocket6(int sockfd, const char *ipv6addr, unsigned short port)
 
 	addr.sin6_family = AF_INET6;
 	addr.sin6_port = htons(port);
-	//addr.sin6_scope_id = if_nametoindex("ens33");
+	//addr.sin6_scope_id = NetifNameToIndex("ens33");
 
 	return BindSocket(sockfd, (struct sockaddr *)&addr, sizeof(addr));
 }
@@ -561,19 +823,12 @@ int ListenSocket(int sockfd, int backlog)
 	return listen(sockfd, backlog);
 }
 
-/*
- * 接收客户端连接
- * sockfd：套接字句柄
- * sa：保存客户端地址信息
- * len：作为输入时表示sa大小，作为输出时表示客户端地址实际大小
- * return：client fd on success，-1 on fail
- */
-int AcceptSocket(int sockfd, struct sockaddr_storage *sa, socklen_t *len)
+static int accept_socket(int sockfd, struct sockaddr_storage *sa, socklen_t *len)
 {
 	int fd = -1;
 	while (1)
 	{
-		fd = accept(sockfd, (struct sockaddr *)sa, len);
+		fd = STATS_SYSCALL(accept(sockfd, (struct sockaddr *)sa, len));
 		if (fd == -1)
 		{
 			if (errno == EINTR)
@@ -586,24 +841,33 @@ int AcceptSocket(int sockfd, struct sockaddr_storage *sa, socklen_t *len)
 	return fd;
 }
 
-int AcceptSocket1(int sockfd, struct sockaddr_storage *sa, socklen_t *len, int timeout)
+/*
+ * 接收客户端连接
+ * sockfd：套接字句柄
+ * sa：保存客户端地址信息
+ * len：作为输入时表示sa大小，作为输出时表示客户端地址实际大小
+ * return：client fd on success，-1 on fail
+ */
+int AcceptSocket(int sockfd, struct sockaddr_storage *sa, socklen_t *len)
+{
+	int ret;
+
+	STATS_ENTER(SOCKET_OP_ACCEPT);
+	ret = accept_socket(sockfd, sa, len);
+	STATS_LEAVE(ret < 0, 0, 0);
+	return ret;
+}
+
+static int accept_socket1(int sockfd, struct sockaddr_storage *sa, socklen_t *len, int timeout)
 {
     int ret;
-    fd_set readfds;
     socklen_t nnn;
-    struct timeval tv_out;
     struct sockaddr_storage sin;
 
     if (timeout <= 0)
         timeout = 10;
 
-    tv_out.tv_sec = timeout / 1000;
-    tv_out.tv_usec = (timeout % 1000) * 1000;
-
-    FD_ZERO(&readfds);
-    FD_SET(sockfd, &readfds);
-
-    ret = select(sockfd + 1, &readfds, NULL, NULL, &tv_out);
+    ret = wait_socket(sockfd, POLLIN, timeout);
     if (ret <= 0)
     {
         return -1;
@@ -613,24 +877,24 @@ int AcceptSocket1(int sockfd, struct sockaddr_storage *sa, socklen_t *len, int t
     if (sa == NULL)
         sa = &sin;
 
-    ret = accept(sockfd, (struct sockaddr *)sa, len ? len : &nnn);
+    ret = STATS_SYSCALL(accept(sockfd, (struct sockaddr *)sa, len ? len : &nnn));
     return ret;
 }
 
-/*
- * 非阻塞连接指定的服务地址
- * sockfd：套接字句柄
- * saptr：待连接的服务地址
- * salen：saptr大小
- * ms：超时时间
- * return：0 on success，-1 on fail
- */
-int ConnectSocket(int sockfd, const struct sockaddr *saptr, socklen_t salen, unsigned int ms)
+int AcceptSocket1(int sockfd, struct sockaddr_storage *sa, socklen_t *len, int timeout)
+{
+	int ret;
+
+	STATS_ENTER(SOCKET_OP_ACCEPT1);
+	ret = accept_socket1(sockfd, sa, len, timeout);
+	STATS_LEAVE(ret < 0, 0, 0);
+	return ret;
+}
+
+static int connect_socket(int sockfd, const struct sockaddr *saptr, socklen_t salen, unsigned int ms)
 {
 	int flags = -1, n = 0, error = 0;
 	socklen_t len;
-	fd_set rset, wset;
-	struct timeval tval;
 
 	error = GetSocketFlag(sockfd, &flags);
 	if (error == -1)
@@ -640,7 +904,7 @@ int ConnectSocket(int sockfd, const struct sockaddr *saptr, socklen_t salen, uns
 	if (error == -1)
 		goto exit_;
 
-	n = connect(sockfd, saptr, salen);
+	n = STATS_SYSCALL(connect(sockfd, saptr, salen));
 	if (n < 0)
 	{
 		if (errno != EINPROGRESS)
@@ -653,24 +917,17 @@ int ConnectSocket(int sockfd, const struct sockaddr *saptr, socklen_t salen, uns
 	if (n == 0) // 连接成功了
 		goto exit_;
 
-	FD_ZERO(&rset);
-	FD_SET(sockfd, &rset);
-	wset = rset;
-
-	tval.tv_sec = ms / 1000;
-	tval.tv_usec = (ms % 1000) * 1000;
-
-	n = select(sockfd+1, &rset, &wset, NULL, &tval);
-	if (n == 0) // 超时
+	n = wait_socket(sockfd, POLLIN | POLLOUT, (int)ms);
+	if (n <= 0) // 超时或出错
 	{
 		CloseSocket(sockfd);
 		return -1;
 	}
 
-	if (FD_ISSET(sockfd, &rset) || FD_ISSET(sockfd, &wset))
+	if (n > 0)
 	{
 		len = sizeof(error);
-		n = getsockopt(sockfd, SOL_SOCKET, SO_ERROR, &error, &len);
+		n = STATS_SYSCALL(getsockopt(sockfd, SOL_SOCKET, SO_ERROR, &error, &len));
 		if (n < 0)
 		{
 			CloseSocket(sockfd);
@@ -689,13 +946,24 @@ exit_:
 }
 
 /*
- * TCP连接指定的主机
- * host：主机名、域名或者点分十进制IP地址、或者IPv6的16进制串
- * service：端口或者服务名如ftp、ntp等
- * timeout：超时时间，单位ms
- * return：sockfd on success，-1 on failed
+ * 非阻塞连接指定的服务地址
+ * sockfd：套接字句柄
+ * saptr：待连接的服务地址
+ * salen：saptr大小
+ * ms：超时时间
+ * return：0 on success，-1 on fail
  */
-int TcpConnectSocket(const char *host, const char *service, unsigned int timeout)
+int ConnectSocket(int sockfd, const struct sockaddr *saptr, socklen_t salen, unsigned int ms)
+{
+	int ret;
+
+	STATS_ENTER(SOCKET_OP_CONNECT);
+	ret = connect_socket(sockfd, saptr, salen, ms);
+	STATS_LEAVE(ret < 0, 0, 0);
+	return ret;
+}
+
+static int tcp_connect_socket(const char *host, const char *service, unsigned int timeout)
 {
 	int ret = -1, n = 0;
 	int sockfd = -1;
@@ -717,7 +985,7 @@ int TcpConnectSocket(const char *host, const char *service, unsigned int timeout
 
 		SetSocketBlock(sockfd, 0); // 设置非阻塞
 		socklen_t salen = (addr[n].ss_family == AF_INET) ? sizeof(struct sockaddr_in) : sizeof(struct sockaddr_in6);
-		if (ConnectSocket(sockfd, (struct sockaddr *)&addr[n], salen, timeout) == 0)
+		if (connect_socket(sockfd, (struct sockaddr *)&addr[n], salen, timeout) == 0)
 		{
 			break;
 		}
@@ -728,16 +996,29 @@ int TcpConnectSocket(const char *host, const char *service, unsigned int timeout
 }
 
 /*
- * 开启TCP监听，返回监听套接字
+ * TCP连接指定的主机
  * host：主机名、域名或者点分十进制IP地址、或者IPv6的16进制串
  * service：端口或者服务名如ftp、ntp等
- * backlo：套接字的未完成连接队列的最大长度
+ * timeout：超时时间，单位ms
  * return：sockfd on success，-1 on failed
  */
-int TcpListenSocket(const char *host, const char *service, int backlog)
+int TcpConnectSocket(const char *host, const char *service, unsigned int timeout)
 {
-	int ret = -1, n = 0;
+	int ret;
+
+	STATS_ENTER(SOCKET_OP_TCP_CONNECT);
+	ret = tcp_connect_socket(host, service, timeout);
+	STATS_LEAVE(ret < 0, 0, 0);
+	return ret;
+}
+
+static int tcp_send_socket(int sockfd, const void *msg, size_t length, int timeout);
+
+static int tcp_connect_socket2(const char *host, const char *service, unsigned int timeout, const void *msg, size_t length)
+{
+	int ret = -1, n = 0, sent = 0, error = 0;
 	int sockfd = -1;
+	socklen_t len;
 	struct sockaddr_storage addr[32]; /* guess should be enough */
 
 	ret = DomainName2Addr(host, service, addr, 32);
@@ -755,50 +1036,296 @@ int TcpListenSocket(const char *host, const char *service, int backlog)
 		}
 
 		SetSocketBlock(sockfd, 0); // 设置非阻塞
-		SetSocketReuseAddr(sockfd, 1);
-		SetSocketReusePort(sockfd, 1);
-
 		socklen_t salen = (addr[n].ss_family == AF_INET) ? sizeof(struct sockaddr_in) : sizeof(struct sockaddr_in6);
-		if (BindSocket(sockfd, (struct sockaddr *)&addr[n], salen) == 0)
+
+		/* 有cookie时数据随SYN发出，返回已排队的字节数；否则返回EINPROGRESS，只发出SYN */
+		sent = STATS_SYSCALL(sendto(sockfd, msg, length, MSG_FASTOPEN | MSG_NOSIGNAL, (struct sockaddr *)&addr[n], salen));
+		if (sent < 0)
 		{
-			if (ListenSocket(sockfd, backlog) == 0)
+			sent = 0;
+			if (errno != EINPROGRESS)
 			{
-				break;
+				/* 内核不支持TFO，退化为普通连接 */
+				if (connect_socket(sockfd, (struct sockaddr *)&addr[n], salen, timeout) < 0)
+				{
+					sockfd = -1;
+					continue;
+				}
+				goto send_;
 			}
 		}
 
-		CloseSocket(sockfd);
-		sockfd = -1; // 绑定失败
-	}
+		/* 等待握手完成，服务端拒绝cookie时由内核重传数据 */
+		error = -1;
+		if (wait_socket(sockfd, POLLOUT, (int)timeout) > 0)
+		{
+			len = sizeof(error);
+			if (STATS_SYSCALL(getsockopt(sockfd, SOL_SOCKET, SO_ERROR, &error, &len)) < 0)
+				error = -1;
+		}
 
-	return sockfd;
+		if (error != 0)
+		{
+			CloseSocket(sockfd);
+			sockfd = -1;
+			continue;
+		}
+
+send_:
+		if ((size_t)sent < length && tcp_send_socket(sockfd, (const char *)msg + sent, length - sent, (int)timeout) != (int)(length - sent))
+		{
+			CloseSocket(sockfd);
+			return -1;
+		}
+		return sockfd;
+	}
+	return -1;
 }
 
 /*
- * TCP读取数据
- * sockfd：套接字描述符
- * msg：保存数据的缓存
- * length：msg缓存大小，单位字节
- * timeout：超时时间(ms)
- * return：num of read bytes on success，-1 on failed
+ * TCP连接指定的主机并发送第一段数据，使用TCP Fast Open
+ * host：主机名、域名或者点分十进制IP地址、或者IPv6的16进制串
+ * service：端口或者服务名如ftp、ntp等
+ * timeout：连接及发送的超时时间，单位ms
+ * msg：待发送的数据
+ * length：msg数据大小，单位字节
+ * return：sockfd on success，-1 on failed
  */
-int TcpRecvSocket(int sockfd, void *msg, size_t length, int timeout)
+int TcpConnectSocket2(const char *host, const char *service, unsigned int timeout, const void *msg, size_t length)
+{
+	int ret;
+
+	STATS_ENTER(SOCKET_OP_TCP_CONNECT2);
+	ret = tcp_connect_socket2(host, service, timeout, msg, length);
+	STATS_LEAVE(ret < 0, ret < 0 ? 0 : length, 0);
+	return ret;
+}
+
+/*
+ * 按RFC 8305将地址按地址族交替排列：第一个地址的地址族优先
+ */
+static void interleave_family(struct sockaddr_storage *addr, int n)
+{
+	struct sockaddr_storage sorted[32];
+	int i, a = 0, b = 0, k = 0;
+	int first = addr[0].ss_family;
+	int idx_a[32], idx_b[32];
+
+	for (i=0; i<n; i++)
+	{
+		if (addr[i].ss_family == first)
+			idx_a[a++] = i;
+		else
+			idx_b[b++] = i;
+	}
+
+	for (i=0; i<a || i<b; i++)
+	{
+		if (i < a)
+			sorted[k++] = addr[idx_a[i]];
+		if (i < b)
+			sorted[k++] = addr[idx_b[i]];
+	}
+	memcpy(addr, sorted, n * sizeof(addr[0]));
+}
+
+static int tcp_connect_socket_race(const char *host, const char *service, unsigned int timeout, unsigned int delay)
+{
+	int ret = -1, n = 0, next = 0, i, error;
+	int winner = -1, active = 0;
+	socklen_t len;
+	long long now, deadline, next_start;
+	struct pollfd pfd[32];
+	struct sockaddr_storage addr[32]; /* guess should be enough */
+
+	ret = DomainName2Addr(host, service, addr, 32);
+	if (ret <= 0)
+	{
+		return -1;
+	}
+
+	if (delay == 0)
+		delay = 250;
+
+	interleave_family(addr, ret);
+
+	for (i=0; i<ret; i++)
+	{
+		pfd[i].fd = -1;
+		pfd[i].events = POLLOUT;
+		pfd[i].revents = 0;
+	}
+
+	now = TimerNow();
+	deadline = now + timeout;
+	next_start = now;
+
+	while (winner < 0)
+	{
+		now = TimerNow();
+
+		/* 到达间隔时间或当前没有进行中的连接时，发起下一个连接 */
+		while (next < ret && (now >= next_start || active == 0))
+		{
+			int fd = CreateTcpSocket(addr[next].ss_family);
+			n = next++;
+			if (fd < 0)
+				continue;
+
+			SetSocketBlock(fd, 0); // 设置非阻塞
+			socklen_t salen = (addr[n].ss_family == AF_INET) ? sizeof(struct sockaddr_in) : sizeof(struct sockaddr_in6);
+			if (STATS_SYSCALL(connect(fd, (struct sockaddr *)&addr[n], salen)) == 0)
+			{
+				pfd[n].fd = fd;
+				winner = n;
+				break;
+			}
+
+			if (errno != EINPROGRESS)
+			{
+				CloseSocket(fd);
+				continue;
+			}
+
+			pfd[n].fd = fd;
+			active++;
+			next_start = now + delay;
+			break;
+		}
+
+		if (winner >= 0)
+			break;
+
+		if (active == 0 || now >= deadline) // 全部失败或超时
+			break;
+
+		long long wait = deadline - now;
+		if (next < ret && next_start - now < wait)
+			wait = next_start - now;
+
+		n = STATS_WAIT(poll(pfd, next, (int)wait));
+		if (n < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+
+		for (i=0; i<next && n>0; i++)
+		{
+			if (pfd[i].fd < 0 || pfd[i].revents == 0)
+				continue;
+
+			error = 0;
+			len = sizeof(error);
+			if (STATS_SYSCALL(getsockopt(pfd[i].fd, SOL_SOCKET, SO_ERROR, &error, &len)) == 0 && error == 0)
+			{
+				winner = i;
+				break;
+			}
+
+			/* 该地址连接失败，立即尝试下一个 */
+			CloseSocket(pfd[i].fd);
+			pfd[i].fd = -1;
+			active--;
+			next_start = now;
+		}
+	}
+
+	for (i=0; i<next; i++)
+	{
+		if (i != winner && pfd[i].fd >= 0)
+			CloseSocket(pfd[i].fd);
+	}
+
+	return (winner >= 0) ? pfd[winner].fd : -1;
+}
+
+/*
+ * TCP竞速连接指定的主机(Happy Eyeballs，RFC 8305)
+ * return：sockfd（非阻塞） on success，-1 on failed
+ */
+int TcpConnectSocketRace(const char *host, const char *service, unsigned int timeout, unsigned int delay)
+{
+	int ret;
+
+	STATS_ENTER(SOCKET_OP_TCP_CONNECT_RACE);
+	ret = tcp_connect_socket_race(host, service, timeout, delay);
+	STATS_LEAVE(ret < 0, 0, 0);
+	return ret;
+}
+
+/*
+ * 开启TCP监听，返回监听套接字
+ * host：主机名、域名或者点分十进制IP地址、或者IPv6的16进制串
+ * service：端口或者服务名如ftp、ntp等
+ * backlo：套接字的未完成连接队列的最大长度
+ * return：sockfd on success，-1 on failed
+ */
+int TcpListenSocket(const char *host, const char *service, int backlog)
+{
+	return TcpListenSocket2(host, service, backlog, 0);
+}
+
+/*
+ * 开启TCP监听，并开启TCP Fast Open
+ * host：主机名、域名或者点分十进制IP地址、或者IPv6的16进制串
+ * service：端口或者服务名如ftp、ntp等
+ * backlog：套接字的未完成连接队列的最大长度
+ * tfo_qlen：TFO队列长度，<=0表示不开启
+ * return：sockfd on success，-1 on failed
+ */
+int TcpListenSocket2(const char *host, const char *service, int backlog, int tfo_qlen)
+{
+	int ret = -1, n = 0;
+	int sockfd = -1;
+	struct sockaddr_storage addr[32]; /* guess should be enough */
+
+	ret = DomainName2Addr(host, service, addr, 32);
+	if (ret <= 0)
+	{
+		return -1;
+	}
+
+	for (n=0; n<ret; n++)
+	{
+		sockfd = CreateTcpSocket(addr[n].ss_family);
+		if (sockfd < 0)
+		{
+			continue;
+		}
+
+		SetSocketBlock(sockfd, 0); // 设置非阻塞
+		SetSocketReuseAddr(sockfd, 1);
+		SetSocketReusePort(sockfd, 1);
+		if (tfo_qlen > 0)
+			SetSocketFastOpen(sockfd, tfo_qlen);
+
+		socklen_t salen = (addr[n].ss_family == AF_INET) ? sizeof(struct sockaddr_in) : sizeof(struct sockaddr_in6);
+		if (BindSocket(sockfd, (struct sockaddr *)&addr[n], salen) == 0)
+		{
+			if (ListenSocket(sockfd, backlog) == 0)
+			{
+				break;
+			}
+		}
+
+		CloseSocket(sockfd);
+		sockfd = -1; // 绑定失败
+	}
+
+	return sockfd;
+}
+
+static int tcp_recv_socket(int sockfd, void *msg, size_t length, int timeout)
 {
 	int ret = 0;
 	int len = 0;
-	fd_set readfds;
-	struct timeval tv_out;
 	char *ptr = (char *)msg;
 
 	while (len < length)
 	{
-		tv_out.tv_sec = timeout / 1000;
-		tv_out.tv_usec = (timeout % 1000) * 1000;
-
-		FD_ZERO(&readfds);
-		FD_SET(sockfd, &readfds);
-
-		ret = select(sockfd + 1, &readfds, NULL, NULL, &tv_out);
+		ret = wait_socket(sockfd, POLLIN, timeout);
 		if (ret == 0) // 超时
 		{
 			return len;
@@ -809,182 +1336,1219 @@ int TcpRecvSocket(int sockfd, void *msg, size_t length, int timeout)
 			return len;
 		}
 
-		if (FD_ISSET(sockfd, &readfds))
-		{
-			ret = recv(sockfd, ptr + len, length - len, 0);
-			if (ret == -1)
-			{
-				if (EINPROGRESS != errno && EINTR != errno)
-					return len;
-			}
-			else if (ret == 0)
-				return len;
-			else
-				len += ret;
-		}
-	}
+		ret = STATS_SYSCALL(recv(sockfd, ptr + len, length - len, 0));
+		if (ret == -1)
+		{
+			if (EINPROGRESS != errno && EINTR != errno)
+				return len;
+		}
+		else if (ret == 0)
+			return len;
+		else
+			len += ret;
+	}
+
+	return len;
+}
+
+/*
+ * TCP读取数据
+ * sockfd：套接字描述符
+ * msg：保存数据的缓存
+ * length：msg缓存大小，单位字节
+ * timeout：超时时间(ms)
+ * return：num of read bytes on success，-1 on failed
+ */
+int TcpRecvSocket(int sockfd, void *msg, size_t length, int timeout)
+{
+	int ret;
+
+	STATS_ENTER(SOCKET_OP_TCP_RECV);
+	ret = tcp_recv_socket(sockfd, msg, length, timeout);
+	STATS_LEAVE(ret < 0, ret > 0 ? ret : 0, ret >= 0 && (size_t)ret < length);
+	return ret;
+}
+
+static int tcp_send_socket(int sockfd, const void *msg, size_t length, int timeout)
+{
+    int ret = 0;
+    int len = 0;
+    const char *ptr = (const char *)msg;
+
+    while (len < length)
+    {
+        ret = wait_socket(sockfd, POLLOUT, timeout);
+        if (ret == 0)
+        {
+            return -1;
+        }
+
+        if (ret == -1)
+        {
+            return -2;
+        }
+
+        ret = STATS_SYSCALL(send(sockfd, ptr + len, length - len, 0));
+        if (ret == -1)
+        {
+            if (EINPROGRESS != errno)
+                return -3;
+        }
+        else
+            len += ret;
+    }
+
+    return len;
+}
+
+/*
+ * TCP发送数据
+ * sockfd：套接字描述符
+ * msg：待发送的数据
+ * length：msg数据大小，单位字节
+ * timeout：超时时间(ms)
+ * return：num of send on success，-1 on failed
+ */
+int TcpSendSocket(int sockfd, const void *msg, size_t length, int timeout)
+{
+	int ret;
+
+	STATS_ENTER(SOCKET_OP_TCP_SEND);
+	ret = tcp_send_socket(sockfd, msg, length, timeout);
+	STATS_LEAVE(ret < 0, ret > 0 ? ret : 0, ret >= 0 && (size_t)ret < length);
+	return ret;
+}
+
+/*
+ * 等待套接字就绪直到绝对截止时间
+ * deadline：截止时间(ms)，CLOCK_MONOTONIC，小于0表示一直等待
+ * return：>0 就绪，0 已到截止时间，-1 出错
+ */
+static int wait_socket_deadline(int sockfd, short events, long long deadline)
+{
+	long long remain;
+	int ret;
+
+	do
+	{
+		if (deadline < 0)
+		{
+			remain = -1;
+		}
+		else
+		{
+			remain = deadline - TimerNow();
+			if (remain <= 0)
+			{
+				STATS_TIMEOUT();
+				return 0;
+			}
+			if (remain > 0x7fffffff)
+				remain = 0x7fffffff;
+		}
+		ret = wait_socket(sockfd, events, (int)remain);
+	} while (ret == -1 && errno == EINTR);
+
+	return ret;
+}
+
+static int tcp_recv_socket2(int sockfd, void *msg, size_t length, long long deadline)
+{
+	char *ptr = (char *)msg;
+	size_t len = 0;
+	ssize_t ret;
+
+	while (len < length)
+	{
+		ret = STATS_SYSCALL(recv(sockfd, ptr + len, length - len, MSG_DONTWAIT));
+		if (ret > 0)
+		{
+			len += ret;
+			continue;
+		}
+
+		if (ret == 0) // 对端关闭
+			return len ? (int)len : -1;
+
+		if (errno == EINTR)
+			continue;
+		if (errno != EAGAIN && errno != EWOULDBLOCK)
+			return len ? (int)len : -1;
+
+		ret = wait_socket_deadline(sockfd, POLLIN, deadline);
+		if (ret == 0)
+			return (int)len;
+		if (ret < 0)
+			return len ? (int)len : -1;
+	}
+
+	return (int)len;
+}
+
+/*
+ * TCP读取数据，先直接recv，只在EAGAIN时等待
+ * return：num of read bytes，0 到截止时间仍未读到数据，-1 出错或对端关闭
+ */
+int TcpRecvSocket2(int sockfd, void *msg, size_t length, long long deadline)
+{
+	int ret;
+
+	STATS_ENTER(SOCKET_OP_TCP_RECV2);
+	ret = tcp_recv_socket2(sockfd, msg, length, deadline);
+	STATS_LEAVE(ret < 0, ret > 0 ? ret : 0, ret >= 0 && (size_t)ret < length);
+	return ret;
+}
+
+static int tcp_send_socket2(int sockfd, const void *msg, size_t length, long long deadline)
+{
+	const char *ptr = (const char *)msg;
+	size_t len = 0;
+	ssize_t ret;
+
+	while (len < length)
+	{
+		ret = STATS_SYSCALL(send(sockfd, ptr + len, length - len, MSG_DONTWAIT | MSG_NOSIGNAL));
+		if (ret >= 0)
+		{
+			len += ret;
+			continue;
+		}
+
+		if (errno == EINTR)
+			continue;
+		if (errno != EAGAIN && errno != EWOULDBLOCK)
+			return len ? (int)len : -1; // 已发送部分数据时返回已发送的长度，errno为出错原因
+
+		ret = wait_socket_deadline(sockfd, POLLOUT, deadline);
+		if (ret == 0)
+		{
+			errno = ETIMEDOUT;
+			return (int)len;
+		}
+		if (ret < 0)
+			return len ? (int)len : -1;
+	}
+
+	return (int)len;
+}
+
+/*
+ * TCP发送数据，先直接send，只在EAGAIN时等待
+ * return：length on success，小于length 到截止时间未发送完（errno为ETIMEDOUT）或发送部分数据后出错（errno为出错原因），
+ *         -1 未发送任何数据即出错
+ */
+int TcpSendSocket2(int sockfd, const void *msg, size_t length, long long deadline)
+{
+	int ret;
+
+	STATS_ENTER(SOCKET_OP_TCP_SEND2);
+	ret = tcp_send_socket2(sockfd, msg, length, deadline);
+	STATS_LEAVE(ret < 0, ret > 0 ? ret : 0, ret >= 0 && (size_t)ret < length);
+	return ret;
+}
+
+/*
+ * 跳过iov中已读写的n个字节，iov为调用者数组的副本
+ */
+static void advance_iov(struct iovec **iov, int *iovcnt, size_t n)
+{
+	while (*iovcnt > 0 && n >= (*iov)->iov_len)
+	{
+		n -= (*iov)->iov_len;
+		(*iov)++;
+		(*iovcnt)--;
+	}
+
+	if (*iovcnt > 0 && n > 0)
+	{
+		(*iov)->iov_base = (char *)(*iov)->iov_base + n;
+		(*iov)->iov_len -= n;
+	}
+}
+
+static size_t iov_total(const struct iovec *iov, int iovcnt)
+{
+	size_t total = 0;
+	int i;
+
+	for (i=0; i<iovcnt; i++)
+		total += iov[i].iov_len;
+	return total;
+}
+
+static int tcp_recv_socketv(int sockfd, const struct iovec *iov, int iovcnt, int timeout)
+{
+	struct iovec vec[IOV_MAX];
+	struct iovec *cur = vec;
+	size_t length;
+	int ret = 0;
+	int len = 0;
+
+	if (iovcnt < 0 || iovcnt > IOV_MAX)
+	{
+		errno = EINVAL;
+		return -1;
+	}
+
+	memcpy(vec, iov, iovcnt * sizeof(struct iovec));
+	length = iov_total(vec, iovcnt);
+
+	while (len < length)
+	{
+		ret = wait_socket(sockfd, POLLIN, timeout);
+		if (ret <= 0) // 超时或出错
+		{
+			return len;
+		}
+
+		ret = STATS_SYSCALL(readv(sockfd, cur, iovcnt));
+		if (ret == -1)
+		{
+			if (EINPROGRESS != errno && EINTR != errno)
+				return len;
+		}
+		else if (ret == 0)
+			return len;
+		else
+		{
+			len += ret;
+			advance_iov(&cur, &iovcnt, ret);
+		}
+	}
+
+	return len;
+}
+
+/*
+ * TCP分散读取数据(readv)
+ * sockfd：套接字描述符
+ * iov：保存数据的缓存数组
+ * iovcnt：iov数组元素个数
+ * timeout：超时时间(ms)
+ * return：num of read bytes on success，-1 on failed
+ */
+int TcpRecvSocketv(int sockfd, const struct iovec *iov, int iovcnt, int timeout)
+{
+	int ret;
+
+	STATS_ENTER(SOCKET_OP_TCP_RECVV);
+	ret = tcp_recv_socketv(sockfd, iov, iovcnt, timeout);
+	STATS_LEAVE(ret < 0, ret > 0 ? ret : 0, ret >= 0 && (size_t)ret < iov_total(iov, iovcnt));
+	return ret;
+}
+
+static int tcp_send_socketv(int sockfd, const struct iovec *iov, int iovcnt, int timeout)
+{
+	struct iovec vec[IOV_MAX];
+	struct iovec *cur = vec;
+	size_t length;
+	int ret = 0;
+	int len = 0;
+
+	if (iovcnt < 0 || iovcnt > IOV_MAX)
+	{
+		errno = EINVAL;
+		return -1;
+	}
+
+	memcpy(vec, iov, iovcnt * sizeof(struct iovec));
+	length = iov_total(vec, iovcnt);
+
+	while (len < length)
+	{
+		ret = wait_socket(sockfd, POLLOUT, timeout);
+		if (ret == 0)
+		{
+			return -1;
+		}
+
+		if (ret == -1)
+		{
+			return -2;
+		}
+
+		ret = STATS_SYSCALL(writev(sockfd, cur, iovcnt));
+		if (ret == -1)
+		{
+			if (EINPROGRESS != errno && EINTR != errno && EAGAIN != errno)
+				return -3;
+		}
+		else
+		{
+			len += ret;
+			advance_iov(&cur, &iovcnt, ret);
+		}
+	}
+
+	return len;
+}
+
+/*
+ * TCP聚集发送数据(writev)
+ * sockfd：套接字描述符
+ * iov：待发送的数据数组
+ * iovcnt：iov数组元素个数
+ * timeout：超时时间(ms)
+ * return：num of send on success，-1 on failed
+ */
+int TcpSendSocketv(int sockfd, const struct iovec *iov, int iovcnt, int timeout)
+{
+	int ret;
+
+	STATS_ENTER(SOCKET_OP_TCP_SENDV);
+	ret = tcp_send_socketv(sockfd, iov, iovcnt, timeout);
+	STATS_LEAVE(ret < 0, ret > 0 ? ret : 0, ret >= 0 && (size_t)ret < iov_total(iov, iovcnt));
+	return ret;
+}
+
+#define SENDFILE_CHUNK (1024 * 1024) /* 每次sendfile/splice的最大字节数 */
+
+/*
+ * 经由中间管道将filefd的数据splice到sockfd
+ * 已读入管道但未发出的数据：可定位的文件按偏移重新读取，不可定位的文件（如套接字、终端）无法退回，
+ * 因此只允许阻塞发送(timeout < 0)，此时只有套接字出错才会提前返回
+ * return：num of send，-1 on failed
+ */
+static ssize_t splice_to_socket(int sockfd, int filefd, off_t *offset, size_t length, int timeout, int direct)
+{
+	int pipefd[2] = {-1, -1};
+	size_t sent = 0;
+	size_t inpipe = 0;
+	ssize_t ret;
+	loff_t start = 0, off = 0;
+	int seekable = 0;
+
+	if (!direct)
+	{
+		/* offset为NULL时从当前位置开始，按偏移读取，结束后再设置文件位置 */
+		start = offset ? *offset : lseek(filefd, 0, SEEK_CUR);
+		seekable = (start >= 0);
+		if (!seekable && timeout >= 0)
+		{
+			errno = ESPIPE;
+			return -1;
+		}
+		off = start;
+
+		if (STATS_SYSCALL(pipe2(pipefd, O_CLOEXEC)) < 0)
+			return -1;
+	}
+
+	while (length == 0 || sent < length)
+	{
+		size_t want = (length == 0 || length - sent > SENDFILE_CHUNK) ? SENDFILE_CHUNK : (length - sent);
+
+		if (direct) // filefd本身是管道，直接splice到套接字
+		{
+			if (wait_socket(sockfd, POLLOUT, timeout) <= 0)
+				break;
+			ret = STATS_SYSCALL(splice(filefd, NULL, sockfd, NULL, want, SPLICE_F_MOVE | SPLICE_F_NONBLOCK | SPLICE_F_MORE));
+			if (ret == 0) // 写端已关闭
+				break;
+			if (ret < 0)
+			{
+				if (errno == EINTR || errno == EAGAIN)
+				{
+					/* 可能是管道暂时为空，等待管道可读 */
+					if (errno == EAGAIN && wait_socket(filefd, POLLIN, timeout) <= 0)
+						break;
+					continue;
+				}
+				break;
+			}
+			sent += ret;
+			continue;
+		}
+
+		if (inpipe == 0)
+		{
+			ret = STATS_SYSCALL(splice(filefd, seekable ? &off : NULL, pipefd[1], NULL, want, SPLICE_F_MOVE));
+			if (ret == 0) // 文件末尾
+				break;
+			if (ret < 0)
+			{
+				if (errno == EINTR)
+					continue;
+				break;
+			}
+			inpipe = ret;
+		}
+
+		ret = wait_socket(sockfd, POLLOUT, timeout);
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret <= 0)
+			break;
+
+		ret = STATS_SYSCALL(splice(pipefd[0], NULL, sockfd, NULL, inpipe, SPLICE_F_MOVE | SPLICE_F_NONBLOCK | SPLICE_F_MORE));
+		if (ret < 0)
+		{
+			if (errno == EINTR || errno == EAGAIN)
+				continue;
+			break;
+		}
+		inpipe -= ret;
+		sent += ret;
+	}
+
+	if (pipefd[0] >= 0)
+	{
+		close(pipefd[0]);
+		close(pipefd[1]);
+	}
+
+	/* 管道中未发出的数据不计入进度，续传时从偏移处重新读取 */
+	if (offset)
+		*offset += sent;
+	else if (seekable)
+		lseek(filefd, start + sent, SEEK_SET);
+
+	return (sent > 0) ? (ssize_t)sent : -1;
+}
+
+static ssize_t tcp_send_file(int sockfd, int filefd, off_t *offset, size_t length, int timeout)
+{
+	struct stat st;
+	size_t sent = 0;
+	ssize_t ret;
+
+	if (STATS_SYSCALL(fstat(filefd, &st)) < 0)
+		return -1;
+
+	if (S_ISFIFO(st.st_mode))
+		return splice_to_socket(sockfd, filefd, NULL, length, timeout, 1);
+
+	if (!S_ISREG(st.st_mode))
+		return splice_to_socket(sockfd, filefd, offset, length, timeout, 0);
+
+	if (length == 0)
+	{
+		off_t pos = offset ? *offset : lseek(filefd, 0, SEEK_CUR);
+		if (pos < 0 || pos >= st.st_size)
+			return 0;
+		length = st.st_size - pos;
+	}
+
+	while (sent < length)
+	{
+		size_t want = (length - sent > SENDFILE_CHUNK) ? SENDFILE_CHUNK : (length - sent);
+
+		if (wait_socket(sockfd, POLLOUT, timeout) <= 0)
+			break;
+
+		/* sendfile会自动更新offset（或文件当前位置） */
+		ret = STATS_SYSCALL(sendfile(sockfd, filefd, offset, want));
+		if (ret == 0) // 文件被截断
+			break;
+		if (ret < 0)
+		{
+			if (errno == EINTR || errno == EAGAIN)
+				continue;
+			break;
+		}
+		sent += ret;
+	}
+
+	return (sent > 0 || length == 0) ? (ssize_t)sent : -1;
+}
+
+/*
+ * 将文件内容直接发送到TCP套接字
+ * sockfd：套接字描述符
+ * filefd：文件描述符
+ * offset：起始偏移，返回时更新为下一个待发送的偏移
+ * length：待发送的字节数，为0表示发送到文件末尾
+ * timeout：超时时间(ms)
+ * return：num of send on success，-1 on failed
+ */
+ssize_t TcpSendFile(int sockfd, int filefd, off_t *offset, size_t length, int timeout)
+{
+	ssize_t ret;
+
+	STATS_ENTER(SOCKET_OP_TCP_SENDFILE);
+	ret = tcp_send_file(sockfd, filefd, offset, length, timeout);
+	STATS_LEAVE(ret < 0, ret > 0 ? ret : 0, ret >= 0 && length && (size_t)ret < length);
+	return ret;
+}
+
+#define ZEROCOPY_THRESHOLD (16 * 1024)
+
+/*
+ * 初始化零拷贝发送，开启套接字SO_ZEROCOPY选项
+ * zc：零拷贝状态
+ * sockfd：套接字描述符
+ * threshold：零拷贝的最小数据大小，单位字节
+ * return：0 on success，-1 on fail
+ */
+int TcpZeroCopyInit(struct TcpZeroCopy *zc, int sockfd, size_t threshold)
+{
+	int opt = 1;
+
+	memset(zc, 0, sizeof(*zc));
+	zc->sockfd = sockfd;
+	zc->threshold = threshold ? threshold : ZEROCOPY_THRESHOLD;
+	return setsockopt(sockfd, SOL_SOCKET, SO_ZEROCOPY, &opt, sizeof(opt));
+}
+
+static int tcp_send_socket_zerocopy(struct TcpZeroCopy *zc, const void *msg, size_t length, int timeout, unsigned int *token)
+{
+	int ret = 0;
+	int len = 0;
+	int flags = MSG_ZEROCOPY;
+	const char *ptr = (const char *)msg;
+
+	if (length < zc->threshold)
+	{
+		if (token)
+			*token = zc->done_id; // 已完成
+		ret = tcp_send_socket(zc->sockfd, msg, length, timeout);
+		return (ret >= 0) ? ret : -1;
+	}
+
+	/* 每次零拷贝send后更新token，出错返回时已发出的部分也能等待完成 */
+	if (token)
+		*token = zc->next_id;
+
+	while (len < length)
+	{
+		ret = wait_socket(zc->sockfd, POLLOUT, timeout);
+		if (ret <= 0)
+			return -1;
+
+		/* 未完成的编号超出记录窗口时拷贝发送，保证每个完成通知都能记录 */
+		if (zc->next_id - zc->done_id >= TCP_ZEROCOPY_WINDOW)
+			flags = 0;
+
+		ret = STATS_SYSCALL(send(zc->sockfd, ptr + len, length - len, flags));
+		if (ret == -1)
+		{
+			if (errno == ENOBUFS) // 超出optmem限制，剩余部分拷贝发送
+			{
+				flags = 0;
+				continue;
+			}
+			if (errno != EINTR && errno != EAGAIN)
+				return -1;
+		}
+		else
+		{
+			if (flags & MSG_ZEROCOPY)
+			{
+				zc->next_id++;
+				if (token)
+					*token = zc->next_id;
+			}
+			len += ret;
+		}
+	}
+
+	return len;
+}
+
+/*
+ * TCP零拷贝发送数据
+ * zc：零拷贝状态
+ * msg：待发送的数据
+ * length：msg数据大小，单位字节
+ * timeout：超时时间(ms)
+ * token：保存完成标记，失败时也会设置
+ * return：num of send on success，-1 on failed
+ */
+int TcpSendSocketZeroCopy(struct TcpZeroCopy *zc, const void *msg, size_t length, int timeout, unsigned int *token)
+{
+	int ret;
+
+	STATS_ENTER(SOCKET_OP_TCP_SEND_ZEROCOPY);
+	ret = tcp_send_socket_zerocopy(zc, msg, length, timeout, token);
+	STATS_LEAVE(ret < 0, ret > 0 ? ret : 0, ret >= 0 && (size_t)ret < length);
+	return ret;
+}
+
+/*
+ * 记录[lo, hi]范围内的send已完成，并推进done_id
+ */
+static void zerocopy_complete(struct TcpZeroCopy *zc, unsigned int lo, unsigned int hi)
+{
+	unsigned int id, bit;
+
+	for (id = lo; (int)(hi - id) >= 0; id++)
+	{
+		if ((int)(id - zc->done_id) < 0)
+			continue; // 已完成
+		if (id - zc->done_id >= TCP_ZEROCOPY_WINDOW)
+			break; // 超出窗口，不是已发出的编号
+		bit = id % TCP_ZEROCOPY_WINDOW;
+		zc->pending[bit / 32] |= 1U << (bit % 32);
+	}
+
+	while (zc->done_id != zc->next_id)
+	{
+		bit = zc->done_id % TCP_ZEROCOPY_WINDOW;
+		if (!(zc->pending[bit / 32] & (1U << (bit % 32))))
+			break;
+		zc->pending[bit / 32] &= ~(1U << (bit % 32));
+		zc->done_id++;
+	}
+}
+
+static int tcp_zerocopy_poll(struct TcpZeroCopy *zc, int timeout)
+{
+	struct msghdr mh;
+	struct cmsghdr *cmsg;
+	struct sock_extended_err *serr;
+	char ctrl[CMSG_SPACE(sizeof(struct sock_extended_err) + sizeof(struct sockaddr_in6))];
+	int n = 0;
+
+	if (timeout > 0 && zc->done_id != zc->next_id)
+	{
+		/* 错误队列非空时poll返回POLLERR */
+		if (wait_socket(zc->sockfd, 0, timeout) < 0)
+			return -1;
+	}
+
+	while (1)
+	{
+		memset(&mh, 0, sizeof(mh));
+		mh.msg_control = ctrl;
+		mh.msg_controllen = sizeof(ctrl);
+		if (STATS_SYSCALL(recvmsg(zc->sockfd, &mh, MSG_ERRQUEUE | MSG_DONTWAIT)) < 0)
+			break;
+
+		for (cmsg = CMSG_FIRSTHDR(&mh); cmsg != NULL; cmsg = CMSG_NXTHDR(&mh, cmsg))
+		{
+			if (!((cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR) ||
+				(cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR)))
+				continue;
+
+			serr = (struct sock_extended_err *)CMSG_DATA(cmsg);
+			if (serr->ee_errno != 0 || serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+				continue;
+
+			/* [ee_info, ee_data]范围内的send已完成，重传等情况下可能乱序到达 */
+			zerocopy_complete(zc, serr->ee_info, serr->ee_data);
+			if (serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+				zc->copied++;
+			n++;
+		}
+	}
+
+	return (n == 0 && errno != EAGAIN && errno != EWOULDBLOCK) ? -1 : n;
+}
+
+/*
+ * 读取套接字错误队列中的零拷贝完成通知
+ * timeout：等待时间(ms)
+ * return：本次读取的通知数，-1 on fail
+ */
+int TcpZeroCopyPoll(struct TcpZeroCopy *zc, int timeout)
+{
+	int ret;
+
+	STATS_ENTER(SOCKET_OP_TCP_ZEROCOPY_POLL);
+	ret = tcp_zerocopy_poll(zc, timeout);
+	STATS_LEAVE(ret < 0, 0, 0);
+	return ret;
+}
+
+/*
+ * 判断token对应的发送缓存是否可以复用
+ * return：1 可以复用，0 内核仍在引用
+ */
+int TcpZeroCopyDone(const struct TcpZeroCopy *zc, unsigned int token)
+{
+	return (int)(zc->done_id - token) >= 0;
+}
+
+/*
+ * 开启UDP监听
+ * host：主机名、域名或者点分十进制IP地址、或者IPv6的16进制串
+ * servic：端口或者服务名如ftp、ntp等
+ * return：sockfd on success，-1 on failed
+ */
+int UdpListenSocket(const char *host, const char *service)
+{
+	return UdpListenSocket2(host, service, 0);
+}
+
+/*
+ * 开启UDP监听并按需开启接收时间戳
+ * tstamp：TSTAMP_SOFTWARE/TSTAMP_HARDWARE组合，为0表示不开启
+ * return：sockfd on success，-1 on failed
+ */
+int UdpListenSocket2(const char *host, const char *service, int tstamp)
+{
+	int ret = -1, n = 0;
+	int sockfd = -1;
+	struct sockaddr_storage addr[32]; /* guess should be enough */
+
+	ret = DomainName2Addr(host, service, addr, 32);
+	if (ret <= 0)
+	{
+		return -1;
+	}
+
+	for (n=0; n<ret; n++)
+	{
+		sockfd = CreateUdpSocket(addr[n].ss_family);
+		if (sockfd < 0)
+		{
+			continue;
+		}
+
+		SetSocketBlock(sockfd, 0); // 非阻塞
+		SetSocketReuseAddr(sockfd, 1);
+		SetSocketReusePort(sockfd, 1);
+
+		socklen_t salen = (addr[n].ss_family == AF_INET) ? sizeof(struct sockaddr_in) : sizeof(struct sockaddr_in6);
+		if (BindSocket(sockfd, (struct sockaddr *)&addr[n], salen) == 0)
+		{
+			break;
+		}
+
+		CloseSocket(sockfd);
+		sockfd = -1; // 绑定失败
+	}
+
+	if (sockfd >= 0 && tstamp && SetSocketTimestamping(sockfd, tstamp, NULL) < 0)
+	{
+		CloseSocket(sockfd);
+		return -1;
+	}
+
+	return sockfd;
+}
+
+static int udp_recv_socket(int sockfd, void *msg, size_t length, int timeout, struct sockaddr_storage *peer_addr)
+{
+	int retlen = 0;
+	socklen_t usize;
+	int len = length;
+	char *buf = (char *)msg;
+	struct sockaddr_storage user_addr;
+	
+	usize = sizeof(user_addr);
+	if (timeout > 0)
+	{
+		int rc;
+
+		rc = wait_socket(sockfd, POLLIN, timeout);
+		if (rc < 0)
+			return -1;
+		if (rc == 0)
+			return -1;
+
+		retlen = STATS_SYSCALL(recvfrom(sockfd, buf, len, 0, (struct sockaddr *)&user_addr, &usize));
+		if (retlen <= 0)
+			return -1;
+
+		if (peer_addr != NULL)
+			memcpy(peer_addr, &user_addr, sizeof(user_addr));
+	}
+	else
+	{
+		retlen = STATS_SYSCALL(recvfrom(sockfd, buf, len, 0, (struct sockaddr *)&user_addr, &usize));
+		if (peer_addr != NULL)
+			memcpy(peer_addr, &user_addr, sizeof(user_addr));
+	}
+
+	return retlen;
+}
+
+/*
+ * UDP读取数据
+ * sockfd：套接字描述符
+ * msg：保存数据的缓存
+ * length：msg缓存大小，单位字节
+ * timeout：超时时间(ms)
+ * peer_addr：对端IP信息，可选
+ * return：num of read bytes on success，-1 on failed
+ */
+int UdpRecvSocket(int sockfd, void *msg, size_t length, int timeout, struct sockaddr_storage *peer_addr)
+{
+	int ret;
+
+	STATS_ENTER(SOCKET_OP_UDP_RECV);
+	ret = udp_recv_socket(sockfd, msg, length, timeout, peer_addr);
+	STATS_LEAVE(ret < 0, ret > 0 ? ret : 0, 0);
+	return ret;
+}
+
+/* 接收辅助数据所需空间：SO_TIMESTAMPNS/SO_TIMESTAMPING时间戳 + GRO分段大小 */
+#define RECV_CMSG_SPACE (CMSG_SPACE(sizeof(struct timespec)) + CMSG_SPACE(3 * sizeof(struct timespec)) + CMSG_SPACE(sizeof(int)))
+
+/*
+ * 解析接收到的辅助数据
+ */
+static void parse_recv_cmsg(struct msghdr *mh, struct UdpMsg *msg)
+{
+	struct cmsghdr *cmsg;
+
+	memset(&msg->stamp, 0, sizeof(msg->stamp));
+	memset(&msg->hwstamp, 0, sizeof(msg->hwstamp));
+	msg->segsize = 0;
+	if (mh->msg_controllen == 0)
+		return;
+
+	for (cmsg = CMSG_FIRSTHDR(mh); cmsg != NULL; cmsg = CMSG_NXTHDR(mh, cmsg))
+	{
+		if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS)
+		{
+			memcpy(&msg->stamp, CMSG_DATA(cmsg), sizeof(msg->stamp));
+		}
+		else if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPING)
+		{
+			/* ts[0]为软件时间戳，ts[2]为网卡原始硬件时间戳，ts[1]已废弃 */
+			struct timespec ts[3];
+			memcpy(ts, CMSG_DATA(cmsg), sizeof(ts));
+			if (ts[0].tv_sec || ts[0].tv_nsec)
+				msg->stamp = ts[0];
+			msg->hwstamp = ts[2];
+		}
+		else if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO)
+		{
+			memcpy(&msg->segsize, CMSG_DATA(cmsg), sizeof(msg->segsize));
+		}
+	}
+}
+
+static int udp_recv_socket2(int sockfd, struct UdpMsg *msg, int timeout)
+{
+	char ctrl[RECV_CMSG_SPACE];
+	struct msghdr mh;
+	struct iovec iov;
+	int ret;
+
+	if (!msg)
+	{
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (timeout > 0)
+	{
+		ret = wait_socket(sockfd, POLLIN, timeout);
+		if (ret <= 0)
+			return -1;
+	}
+
+	iov.iov_base = msg->buf;
+	iov.iov_len = msg->size;
+	memset(&mh, 0, sizeof(mh));
+	mh.msg_name = &msg->addr;
+	mh.msg_namelen = sizeof(msg->addr);
+	mh.msg_iov = &iov;
+	mh.msg_iovlen = 1;
+	mh.msg_control = ctrl;
+	mh.msg_controllen = sizeof(ctrl);
+
+	ret = STATS_SYSCALL(recvmsg(sockfd, &mh, 0));
+	if (ret < 0)
+		return -1;
+
+	msg->length = ret;
+	msg->flags = mh.msg_flags;
+	parse_recv_cmsg(&mh, msg);
+	return ret;
+}
+
+/*
+ * UDP读取一个数据报及其辅助数据
+ * return：num of read bytes on success，-1 on failed
+ */
+int UdpRecvSocket2(int sockfd, struct UdpMsg *msg, int timeout)
+{
+	int ret;
+
+	STATS_ENTER(SOCKET_OP_UDP_RECV2);
+	ret = udp_recv_socket2(sockfd, msg, timeout);
+	STATS_LEAVE(ret < 0, ret > 0 ? ret : 0, ret >= 0 && (msg->flags & MSG_TRUNC));
+	return ret;
+}
+
+static int udp_recv_socket_batch(int sockfd, struct UdpMsg *msgs, int count, int timeout)
+{
+	struct mmsghdr hdr[UDP_BATCH_MAX];
+	struct iovec iov[UDP_BATCH_MAX];
+	char ctrl[UDP_BATCH_MAX][RECV_CMSG_SPACE];
+	int i, n;
+
+	if (msgs == NULL || count <= 0)
+	{
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (count > UDP_BATCH_MAX)
+		count = UDP_BATCH_MAX;
+
+	if (timeout > 0)
+	{
+		if (wait_socket(sockfd, POLLIN, timeout) <= 0)
+			return -1;
+	}
+
+	for (i=0; i<count; i++)
+	{
+		iov[i].iov_base = msgs[i].buf;
+		iov[i].iov_len = msgs[i].size;
+
+		memset(&hdr[i], 0, sizeof(hdr[i]));
+		hdr[i].msg_hdr.msg_name = &msgs[i].addr;
+		hdr[i].msg_hdr.msg_namelen = sizeof(msgs[i].addr);
+		hdr[i].msg_hdr.msg_iov = &iov[i];
+		hdr[i].msg_hdr.msg_iovlen = 1;
+		hdr[i].msg_hdr.msg_control = ctrl[i];
+		hdr[i].msg_hdr.msg_controllen = sizeof(ctrl[i]);
+	}
+
+	/* MSG_WAITFORONE：收到第一个数据报后不再阻塞 */
+	n = STATS_SYSCALL(recvmmsg(sockfd, hdr, count, MSG_WAITFORONE, NULL));
+	if (n <= 0)
+		return -1;
+
+	for (i=0; i<n; i++)
+	{
+		msgs[i].length = hdr[i].msg_len;
+		msgs[i].flags = hdr[i].msg_hdr.msg_flags;
+		parse_recv_cmsg(&hdr[i].msg_hdr, &msgs[i]);
+	}
+
+	return n;
+}
+
+/*
+ * UDP批量读取数据
+ * sockfd：套接字描述符
+ * msgs：消息槽数组
+ * count：msgs数组元素个数
+ * timeout：超时时间(ms)
+ * return：num of received msgs on success，-1 on failed
+ */
+int UdpRecvSocketBatch(int sockfd, struct UdpMsg *msgs, int count, int timeout)
+{
+	int ret;
+
+	STATS_ENTER(SOCKET_OP_UDP_RECV_BATCH);
+	ret = udp_recv_socket_batch(sockfd, msgs, count, timeout);
+	STATS_LEAVE(ret < 0, udp_msgs_bytes(msgs, ret), 0);
+	return ret;
+}
 
-	return len;
+static int udp_send_socket(int sockfd, const struct sockaddr *dest_addr, int addrlen, const void *msg, size_t length)
+{
+	int ret = STATS_SYSCALL(sendto(sockfd, msg, length, 0, dest_addr, addrlen));
+	return ret;
 }
 
 /*
- * TCP发送数据
+ * UDP发送数据
  * sockfd：套接字描述符
  * msg：待发送的数据
  * length：msg数据大小，单位字节
- * timeout：超时时间(ms)
+ * dest_addr：目的IP地址
+ * addrlen：dest_addr大小
  * return：num of send on success，-1 on failed
  */
-int TcpSendSocket(int sockfd, const void *msg, size_t length, int timeout)
+int UdpSendSocket(int sockfd, const struct sockaddr *dest_addr, int addrlen, const void *msg, size_t length)
 {
-    int ret = 0;
-    int len = 0;
-    fd_set writefds;
-    struct timeval tv_out;
-    const char *ptr = (const char *)msg;
-
-    while (len < length)
-    {
-        tv_out.tv_sec = timeout / 1000;
-        tv_out.tv_usec = (timeout % 1000) * 1000;
-
-        FD_ZERO(&writefds);
-        FD_SET(sockfd, &writefds);
-
-        ret = select(sockfd + 1, NULL, &writefds, NULL, &tv_out);
-        if (ret == 0)
-        {
-            return -1;
-        }
-
-        if (ret == -1)
-        {
-            return -2;
-        }
-
-        ret = send(sockfd, ptr + len, length - len, 0);
-        if (ret == -1)
-        {
-            if (EINPROGRESS != errno)
-                return -3;
-        }
-        else
-            len += ret;
-    }
+	int ret;
 
-    return len;
+	STATS_ENTER(SOCKET_OP_UDP_SEND);
+	ret = udp_send_socket(sockfd, dest_addr, addrlen, msg, length);
+	STATS_LEAVE(ret < 0, ret > 0 ? ret : 0, ret >= 0 && (size_t)ret < length);
+	return ret;
 }
 
-/*
- * 开启UDP监听
- * host：主机名、域名或者点分十进制IP地址、或者IPv6的16进制串
- * servic：端口或者服务名如ftp、ntp等
- * return：sockfd on success，-1 on failed
- */
-int UdpListenSocket(const char *host, const char *service)
+static int udp_send_socket_batch(int sockfd, struct UdpSendMsg *msgs, int count)
 {
-	int ret = -1, n = 0;
-	int sockfd = -1;
-	struct sockaddr_storage addr[32]; /* guess should be enough */
+	struct mmsghdr hdr[UDP_BATCH_MAX];
+	int i, n, chunk, sent = 0;
 
-	ret = DomainName2Addr(host, service, addr, 32);
-	if (ret <= 0)
+	if (msgs == NULL || count <= 0)
 	{
+		errno = EINVAL;
 		return -1;
 	}
 
-	for (n=0; n<ret; n++)
+	while (sent < count)
 	{
-		sockfd = CreateUdpSocket(addr[n].ss_family);
-		if (sockfd < 0)
+		chunk = count - sent;
+		if (chunk > UDP_BATCH_MAX)
+			chunk = UDP_BATCH_MAX;
+
+		for (i=0; i<chunk; i++)
 		{
-			continue;
+			struct UdpSendMsg *m = &msgs[sent + i];
+			memset(&hdr[i], 0, sizeof(hdr[i]));
+			hdr[i].msg_hdr.msg_name = (void *)m->addr;
+			hdr[i].msg_hdr.msg_namelen = m->addrlen;
+			hdr[i].msg_hdr.msg_iov = (struct iovec *)m->iov;
+			hdr[i].msg_hdr.msg_iovlen = m->iovcnt;
 		}
 
-		SetSocketBlock(sockfd, 0); // 非阻塞
-		SetSocketReuseAddr(sockfd, 1);
-		SetSocketReusePort(sockfd, 1);
-
-		socklen_t salen = (addr[n].ss_family == AF_INET) ? sizeof(struct sockaddr_in) : sizeof(struct sockaddr_in6);
-		if (BindSocket(sockfd, (struct sockaddr *)&addr[n], salen) == 0)
+		n = STATS_SYSCALL(sendmmsg(sockfd, hdr, chunk, 0));
+		if (n < 0)
 		{
+			if (errno == EINTR)
+				continue;
 			break;
 		}
 
-		CloseSocket(sockfd);
-		sockfd = -1; // 绑定失败
+		for (i=0; i<n; i++)
+			msgs[sent + i].length = hdr[i].msg_len;
+
+		sent += n;
+		if (n < chunk) // 部分发送，后续消息出错
+			break;
 	}
 
-	return sockfd;
+	return (sent > 0) ? sent : -1;
 }
 
 /*
- * UDP读取数据
+ * UDP批量发送数据
  * sockfd：套接字描述符
- * msg：保存数据的缓存
- * length：msg缓存大小，单位字节
- * timeout：超时时间(ms)
- * peer_addr：对端IP信息，可选
- * return：num of read bytes on success，-1 on failed
+ * msgs：待发送的消息数组
+ * count：msgs数组元素个数
+ * return：num of sent msgs on success，-1 on failed
  */
-int UdpRecvSocket(int sockfd, void *msg, size_t length, int timeout, struct sockaddr_storage *peer_addr)
+int UdpSendSocketBatch(int sockfd, struct UdpSendMsg *msgs, int count)
 {
-	int retlen = 0;
-	socklen_t usize;
-	int len = length;
-	char *buf = (char *)msg;
-	struct sockaddr_storage user_addr;
-	
-	usize = sizeof(user_addr);
-	if (timeout > 0)
+	int ret;
+
+	STATS_ENTER(SOCKET_OP_UDP_SEND_BATCH);
+	ret = udp_send_socket_batch(sockfd, msgs, count);
+	STATS_LEAVE(ret < 0, udp_send_msgs_bytes(msgs, ret), ret >= 0 && ret < count);
+	return ret;
+}
+
+static int udp_send_socket_gso(int sockfd, const struct sockaddr *dest_addr, int addrlen, const void *msg, size_t length, unsigned short segsize)
+{
+	struct msghdr mh;
+	struct iovec iov;
+	struct cmsghdr *cmsg;
+	char ctrl[CMSG_SPACE(sizeof(unsigned short))];
+	int ret;
+
+	memset(&mh, 0, sizeof(mh));
+	iov.iov_base = (void *)msg;
+	iov.iov_len = length;
+	mh.msg_name = (void *)dest_addr;
+	mh.msg_namelen = addrlen;
+	mh.msg_iov = &iov;
+	mh.msg_iovlen = 1;
+
+	/* 不超过一个分段时无需GSO */
+	if (segsize > 0 && length > segsize)
 	{
-		fd_set fdread;
-		int rc;
-		struct timeval tv;
+		memset(ctrl, 0, sizeof(ctrl));
+		mh.msg_control = ctrl;
+		mh.msg_controllen = sizeof(ctrl);
+		cmsg = CMSG_FIRSTHDR(&mh);
+		cmsg->cmsg_level = SOL_UDP;
+		cmsg->cmsg_type = UDP_SEGMENT;
+		cmsg->cmsg_len = CMSG_LEN(sizeof(unsigned short));
+		memcpy(CMSG_DATA(cmsg), &segsize, sizeof(segsize));
+	}
 
-		tv.tv_sec = timeout / 1000;
-		tv.tv_usec = (timeout % 1000) * 1000;
-		FD_ZERO(&fdread);
-		FD_SET(sockfd, &fdread);
+	ret = STATS_SYSCALL(sendmsg(sockfd, &mh, 0));
+	return ret;
+}
 
-		rc = select(sockfd + 1, &fdread, NULL, NULL, &tv);
-		if (rc < 0)
-			return -1;
-		if (rc == 0)
-			return -1;
+/*
+ * UDP分段卸载(GSO)发送数据
+ * sockfd：套接字描述符
+ * dest_addr：目的IP地址
+ * addrlen：dest_addr大小
+ * msg：待发送的数据
+ * length：msg数据大小，单位字节
+ * segsize：每个数据报的大小，单位字节
+ * return：num of send on success，-1 on failed
+ */
+int UdpSendSocketGso(int sockfd, const struct sockaddr *dest_addr, int addrlen, const void *msg, size_t length, unsigned short segsize)
+{
+	int ret;
 
-		retlen = recvfrom(sockfd, buf, len, 0, (struct sockaddr *)&user_addr, &usize);
-		if (retlen <= 0)
-			return -1;
+	STATS_ENTER(SOCKET_OP_UDP_SEND_GSO);
+	ret = udp_send_socket_gso(sockfd, dest_addr, addrlen, msg, length, segsize);
+	STATS_LEAVE(ret < 0, ret > 0 ? ret : 0, ret >= 0 && (size_t)ret < length);
+	return ret;
+}
 
-		if (peer_addr != NULL)
-			memcpy(peer_addr, &user_addr, sizeof(user_addr));
+static int udp_recv_socket_gro(int sockfd, void *msg, size_t length, int timeout, struct sockaddr_storage *peer_addr, struct iovec *segs, int maxsegs)
+{
+	struct UdpMsg um;
+	size_t off;
+	int n;
+
+	if (segs == NULL || maxsegs <= 0)
+	{
+		errno = EINVAL;
+		return -1;
 	}
-	else
+
+	um.buf = msg;
+	um.size = length;
+	if (udp_recv_socket_batch(sockfd, &um, 1, timeout) != 1)
+		return -1;
+
+	if (peer_addr != NULL)
+		memcpy(peer_addr, &um.addr, sizeof(um.addr));
+
+	if (um.segsize <= 0) // 未合并
 	{
-		retlen = recvfrom(sockfd, buf, len, 0, (struct sockaddr *)&user_addr, &usize);
-		if (peer_addr != NULL)
-			memcpy(peer_addr, &user_addr, sizeof(user_addr));
+		segs[0].iov_base = msg;
+		segs[0].iov_len = um.length;
+		return 1;
 	}
 
-	return retlen;
+	for (off = 0, n = 0; off < um.length && n < maxsegs; off += um.segsize, n++)
+	{
+		segs[n].iov_base = (char *)msg + off;
+		segs[n].iov_len = (um.length - off < (size_t)um.segsize) ? (um.length - off) : (size_t)um.segsize;
+	}
+	return n;
 }
 
 /*
- * UDP发送数据
+ * UDP读取数据，并将GRO合并的数据报拆分回单个数据报
  * sockfd：套接字描述符
- * msg：待发送的数据
- * length：msg数据大小，单位字节
- * dest_addr：目的IP地址
- * addrlen：dest_addr大小
- * return：num of send on success，-1 on failed
+ * msg：保存数据的缓存
+ * length：msg缓存大小，单位字节
+ * timeout：超时时间(ms)
+ * peer_addr：对端IP信息，可选
+ * segs：保存每个数据报在msg中的位置和长度
+ * maxsegs：segs数组元素个数
+ * return：num of datagrams on success，-1 on failed
  */
-int UdpSendSocket(int sockfd, const struct sockaddr *dest_addr, int addrlen, const void *msg, size_t length)
+int UdpRecvSocketGro(int sockfd, void *msg, size_t length, int timeout, struct sockaddr_storage *peer_addr, struct iovec *segs, int maxsegs)
 {
-	int ret = sendto(sockfd, msg, length, 0, dest_addr, addrlen);
+	int ret;
+
+	STATS_ENTER(SOCKET_OP_UDP_RECV_GRO);
+	ret = udp_recv_socket_gro(sockfd, msg, length, timeout, peer_addr, segs, maxsegs);
+	STATS_LEAVE(ret < 0, ret > 0 ? iov_total(segs, ret) : 0, 0);
 	return ret;
 }
 
+static int udp_send_socket4(int sockfd, const char *dest_addr, unsigned short port, const void *msg, size_t length)
+{
+    int ret;
+	struct sockaddr_in dst_addr;
+
+	memset(&dst_addr, 0, sizeof(dst_addr));
+	dst_addr.sin_family = AF_INET;
+	dst_addr.sin_port = htons(port);
+	if (!dest_addr || inet_pton4(dest_addr, (unsigned char *)&dst_addr.sin_addr.s_addr) != 1)
+	{
+		errno = EINVAL;
+		return -1;
+	}
+
+    ret = STATS_SYSCALL(sendto(sockfd, msg, length, 0, (struct sockaddr *)&dst_addr, sizeof(dst_addr)));
+    return ret == length ? ret : -1;
+}
+
 /*
  * UDP发送数据
  * sockfd：套接字描述符
@@ -996,16 +2560,12 @@ int UdpSendSocket(int sockfd, const struct sockaddr *dest_addr, int addrlen, con
  */
 int UdpSendSocket4(int sockfd, const char *dest_addr, unsigned short port, const void *msg, size_t length)
 {
-    int ret;
-	struct sockaddr_in dst_addr;
-
-	memset(&dst_addr, 0, sizeof(dst_addr));
-	dst_addr.sin_family = AF_INET;
-	dst_addr.sin_port = htons(port);
-	dst_addr.sin_addr.s_addr = inet_addr(dest_addr);
+	int ret;
 
-    ret = sendto(sockfd, msg, length, 0, (struct sockaddr *)&dst_addr, sizeof(dst_addr));
-    return ret == length ? ret : -1;
+	STATS_ENTER(SOCKET_OP_UDP_SEND4);
+	ret = udp_send_socket4(sockfd, dest_addr, port, msg, length);
+	STATS_LEAVE(ret < 0, ret > 0 ? ret : 0, 0);
+	return ret;
 }
 
 /*
@@ -1025,7 +2585,7 @@ int UdpJoinMcast(int sockfd, const struct sockaddr *grp, socklen_t grplen, const
 	}
 	else if (netcardName != 0)
 	{
-		if ((req.gr_interface = if_nametoindex(netcardName)) == 0)
+		if ((req.gr_interface = NetifNameToIndex(netcardName)) == 0)
 		{
 			errno = ENXIO; // not found this if
 			return -1;
@@ -1091,7 +2651,7 @@ doioctl:
 			}
 			else if (netcardName)
 			{
-				if ((mreq6.ipv6mr_interface = if_nametoindex(netcardName)) == 0)
+				if ((mreq6.ipv6mr_interface = NetifNameToIndex(netcardName)) == 0)
 				{
 					errno = ENXIO;// not found
 					return -1;
@@ -1281,7 +2841,7 @@ doioctl:
 					return -1;
 				}
 
-				if ( (idx = if_nametoindex(ifname)) == 0 )
+				if ( (idx = NetifNameToIndex(ifname)) == 0 )
 				{
 					errno = ENXIO;
 					return -1;
@@ -1305,7 +2865,7 @@ doioctl:
  */
 int GetSocketFlag(int sockfd, int *flag)
 {
-	int flg = fcntl(sockfd, F_GETFL, 0);
+	int flg = STATS_SYSCALL(fcntl(sockfd, F_GETFL, 0));
 	if (flg == -1)
 		return -1;
 	if (flag)
@@ -1321,7 +2881,131 @@ int GetSocketFlag(int sockfd, int *flag)
  */
 int SetSocketFlag(int sockfd, int flag)
 {
-	return fcntl(sockfd, F_SETFL, flag);
+	return STATS_SYSCALL(fcntl(sockfd, F_SETFL, flag));
+}
+
+/*
+ * 内核struct tcp_info的布局，只会在末尾追加字段；
+ * glibc的netinet/tcp.h中的定义缺少较新的字段，而linux/tcp.h与其冲突，故在此单独定义
+ */
+struct kernel_tcp_info
+{
+	unsigned char state;
+	unsigned char ca_state;
+	unsigned char retransmits;
+	unsigned char probes;
+	unsigned char backoff;
+	unsigned char options;
+	unsigned char wscale;
+	unsigned char app_limited;   /* bit0: delivery_rate_app_limited */
+
+	unsigned int rto;
+	unsigned int ato;
+	unsigned int snd_mss;
+	unsigned int rcv_mss;
+
+	unsigned int unacked;
+	unsigned int sacked;
+	unsigned int lost;
+	unsigned int retrans;
+	unsigned int fackets;
+
+	unsigned int last_data_sent;
+	unsigned int last_ack_sent;
+	unsigned int last_data_recv;
+	unsigned int last_ack_recv;
+
+	unsigned int pmtu;
+	unsigned int rcv_ssthresh;
+	unsigned int rtt;
+	unsigned int rttvar;
+	unsigned int snd_ssthresh;
+	unsigned int snd_cwnd;
+	unsigned int advmss;
+	unsigned int reordering;
+
+	unsigned int rcv_rtt;
+	unsigned int rcv_space;
+
+	unsigned int total_retrans;
+
+	unsigned long long pacing_rate;
+	unsigned long long max_pacing_rate;
+	unsigned long long bytes_acked;
+	unsigned long long bytes_received;
+	unsigned int segs_out;
+	unsigned int segs_in;
+
+	unsigned int notsent_bytes;
+	unsigned int min_rtt;
+	unsigned int data_segs_in;
+	unsigned int data_segs_out;
+
+	unsigned long long delivery_rate;
+
+	unsigned long long busy_time;
+	unsigned long long rwnd_limited;
+	unsigned long long sndbuf_limited;
+
+	unsigned int delivered;
+	unsigned int delivered_ce;
+
+	unsigned long long bytes_sent;
+	unsigned long long bytes_retrans;
+	unsigned int dsack_dups;
+	unsigned int reord_seen;
+
+	unsigned int rcv_ooopack;
+
+	unsigned int snd_wnd;
+};
+
+/*
+ * 获取TCP连接状态快照(TCP_INFO)
+ * return：0 on success，-1 on fail
+ */
+int GetSocketTcpInfo(int sockfd, struct TcpInfo *info)
+{
+	struct kernel_tcp_info ti;
+	socklen_t len = sizeof(ti);
+
+	if (!info)
+	{
+		errno = EINVAL;
+		return -1;
+	}
+
+	/* 旧内核只填充前面的部分，其余保持为0 */
+	memset(&ti, 0, sizeof(ti));
+	if (getsockopt(sockfd, IPPROTO_TCP, TCP_INFO, &ti, &len) < 0)
+		return -1;
+
+	memset(info, 0, sizeof(*info));
+	info->state = ti.state;
+	info->rtt = ti.rtt;
+	info->rttvar = ti.rttvar;
+	info->min_rtt = ti.min_rtt;
+	info->rto = ti.rto;
+	info->snd_mss = ti.snd_mss;
+	info->snd_cwnd = ti.snd_cwnd;
+	info->snd_ssthresh = ti.snd_ssthresh;
+	info->snd_wnd = ti.snd_wnd;
+	info->unacked = ti.unacked;
+	info->lost = ti.lost;
+	info->retransmits = ti.retransmits;
+	info->total_retrans = ti.total_retrans;
+	info->notsent_bytes = ti.notsent_bytes;
+	info->app_limited = ti.app_limited & 1;
+	info->delivery_rate = ti.delivery_rate;
+	info->pacing_rate = ti.pacing_rate;
+	info->bytes_sent = ti.bytes_sent;
+	info->bytes_retrans = ti.bytes_retrans;
+	info->bytes_acked = ti.bytes_acked;
+	info->bytes_received = ti.bytes_received;
+	info->busy_time = ti.busy_time;
+	info->rwnd_limited = ti.rwnd_limited;
+	info->sndbuf_limited = ti.sndbuf_limited;
+	return 0;
 }
 
 /*
@@ -1522,12 +3206,12 @@ int GetSocketAddr2(int sockfd, char *buff, int size)
 int SetSocketBlock(int sockfd, int block)
 {
 	int flag;
-	flag = fcntl(sockfd, F_GETFL, 0);
+	flag = STATS_SYSCALL(fcntl(sockfd, F_GETFL, 0));
 	if (flag == -1)
 	{
 		return -1;
 	}
-	return fcntl(sockfd, F_SETFL, block ? (flag & (~O_NONBLOCK)) : (flag | O_NONBLOCK));
+	return STATS_SYSCALL(fcntl(sockfd, F_SETFL, block ? (flag & (~O_NONBLOCK)) : (flag | O_NONBLOCK)));
 }
 
 /*
@@ -1682,4 +3366,117 @@ int SetSocketDeferAccept(int sock)
     return 0;
 }
 
+/*
+ * 设置套接字是否记录内核接收时间戳(SO_TIMESTAMPNS)
+ * sockfd：套接字句柄
+ * on：0：不开启，1：开启
+ * return：0 on success，-1 on fail
+ */
+int SetSocketTimestamp(int sockfd, int on)
+{
+	int opt = !!on;
+	return setsockopt(sockfd, SOL_SOCKET, SO_TIMESTAMPNS, &opt, sizeof(opt));
+}
+
+/*
+ * 开启网卡的硬件接收时间戳
+ * 配置是整个网卡共享的，先读取当前配置，只修改rx_filter，保留其他程序（如ptp4l）设置的tx_type
+ * return：0 on success，-1 on fail
+ */
+static int enable_hw_timestamp(int sockfd, const char *ifname)
+{
+	struct hwtstamp_config cfg;
+	struct ifreq ifr;
+
+	memset(&cfg, 0, sizeof(cfg));
+	memset(&ifr, 0, sizeof(ifr));
+	strncpy(ifr.ifr_name, ifname, sizeof(ifr.ifr_name) - 1);
+	ifr.ifr_data = (char *)&cfg;
+	if (ioctl(sockfd, SIOCGHWTSTAMP, &ifr) < 0)
+		return -1;
+
+	if (cfg.rx_filter == HWTSTAMP_FILTER_ALL)
+		return 0; // 已开启
+
+	cfg.rx_filter = HWTSTAMP_FILTER_ALL;
+	if (ioctl(sockfd, SIOCSHWTSTAMP, &ifr) < 0)
+		return -1;
+
+	/* 驱动可能改用其他过滤方式，NONE表示未开启 */
+	if (cfg.rx_filter == HWTSTAMP_FILTER_NONE)
+	{
+		errno = EOPNOTSUPP;
+		return -1;
+	}
+	return 0;
+}
+
+/*
+ * 设置套接字的接收时间戳(SO_TIMESTAMPING)
+ * return：0 on success，1 网卡硬件时间戳未开启（只有软件时间戳），-1 on fail
+ */
+int SetSocketTimestamping(int sockfd, int flags, const char *ifname)
+{
+	int opt = 0, hw_ok = 1, saved = 0;
+
+	/* 硬件时间戳总是附带软件时间戳，网卡不支持时仍有软件时间戳 */
+	if (flags & (TSTAMP_SOFTWARE | TSTAMP_HARDWARE))
+		opt |= SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+
+	if (flags & TSTAMP_HARDWARE)
+	{
+		opt |= SOF_TIMESTAMPING_RX_HARDWARE | SOF_TIMESTAMPING_RAW_HARDWARE;
+		/* 网卡不支持或无权限时仍开启套接字选项，只有软件时间戳 */
+		if (ifname && enable_hw_timestamp(sockfd, ifname) < 0)
+		{
+			hw_ok = 0;
+			saved = errno;
+		}
+	}
+
+	if (setsockopt(sockfd, SOL_SOCKET, SO_TIMESTAMPING, &opt, sizeof(opt)) < 0)
+		return -1;
+
+	if (!hw_ok)
+	{
+		errno = saved;
+		return 1;
+	}
+	return 0;
+}
+
+/*
+ * 设置UDP套接字默认的GSO分段大小(UDP_SEGMENT)
+ * sockfd：套接字句柄
+ * segsize：分段大小，单位字节，为0表示关闭
+ * return：0 on success，-1 on fail
+ */
+int SetSocketUdpGso(int sockfd, int segsize)
+{
+	return setsockopt(sockfd, SOL_UDP, UDP_SEGMENT, &segsize, sizeof(segsize));
+}
 
+/*
+ * 设置UDP套接字是否接收GRO合并的数据报(UDP_GRO)
+ * sockfd：套接字句柄
+ * on：0：不开启，1：开启
+ * return：0 on success，-1 on fail
+ */
+int SetSocketUdpGro(int sockfd, int on)
+{
+	int opt = !!on;
+	return setsockopt(sockfd, SOL_UDP, UDP_GRO, &opt, sizeof(opt));
+}
+
+
+
+/*
+ * 设置监听套接字的TCP Fast Open队列长度
+ * sockfd：套接字句柄
+ * qlen：TFO队列长度，为0表示关闭
+ * return：0 on success，-1 on fail
+ */
+int SetSocketFastOpen(int sockfd, int qlen)
+{
+	return setsockopt(sockfd, IPPROTO_TCP, TCP_FASTOPEN, &qlen, sizeof(qlen));
+}
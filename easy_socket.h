@@ -9,6 +9,8 @@
 
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
+#include <time.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -27,7 +29,16 @@ const char *inet_ntop2(int family, const void *src, char *dest, size_t size);
 const char *inet_ntop3(const struct sockaddr *sa, char *dest, size_t size);
 
 /*
- * 域名转IP地址
+ * 将点分十进制IPv4地址或IPv6地址转换为网络字节序，查表解析，接受的格式与inet_pton相同
+ * family：AF_INET/AF_INET6
+ * src：待转换的字符串
+ * dst：保存转换结果，AF_INET为4字节，AF_INET6为16字节
+ * return：1 on success，0 格式错误，-1 不支持的family
+ */
+int inet_pton2(int family, const char *src, void *dst);
+
+/*
+ * 域名转IP地址，结果按TTL缓存，见easy_resolver.h
  * host：主机名/域名/IP地址
  * serv：端口号/服务名（如NTP、FTP、SIP等）
  * addr：保存返回的地址信息数组
@@ -141,7 +152,7 @@ int BindSocket(int sockfd, const struct sockaddr *sa, socklen_t salen);
 /*
  * 套接字绑定IPv4的IP地址和端口
  * sockfd：套接字句柄
- * ipaddr：待绑定的IPv4地址，格式如：ddd.ddd.ddd.ddd
+ * ipaddr：待绑定的IPv4地址，格式如：ddd.ddd.ddd.ddd，为NULL表示任意地址
  * port：待绑定的端口
  * return：0 on success，-1 on fail
  */
@@ -193,6 +204,30 @@ int ConnectSocket(int sockfd, const struct sockaddr *saptr, socklen_t salen, uns
  */
 int TcpConnectSocket(const char *host, const char *service, unsigned int timeout);
 
+/*
+ * TCP竞速连接指定的主机(Happy Eyeballs，RFC 8305)
+ * 解析出的地址按IPv6/IPv4交替排列，先发起第一个连接，每隔delay毫秒（或前一个连接失败时立即）
+ * 再发起下一个，最先完成握手的连接胜出，其余连接被关闭
+ * host：主机名、域名或者点分十进制IP地址、或者IPv6的16进制串
+ * service：端口或者服务名如ftp、ntp等
+ * timeout：总超时时间，单位ms
+ * delay：发起相邻两次连接的间隔，单位ms，为0则取250ms
+ * return：sockfd（非阻塞） on success，-1 on failed
+ */
+int TcpConnectSocketRace(const char *host, const char *service, unsigned int timeout, unsigned int delay);
+
+/*
+ * TCP连接指定的主机并发送第一段数据，使用TCP Fast Open(MSG_FASTOPEN)在SYN中携带数据
+ * 没有TFO cookie、内核不支持或服务端拒绝cookie时，自动退化为普通连接后再发送
+ * host：主机名、域名或者点分十进制IP地址、或者IPv6的16进制串
+ * service：端口或者服务名如ftp、ntp等
+ * timeout：连接及发送的超时时间，单位ms
+ * msg：待发送的数据
+ * length：msg数据大小，单位字节
+ * return：sockfd（非阻塞，msg已全部发送） on success，-1 on failed
+ */
+int TcpConnectSocket2(const char *host, const char *service, unsigned int timeout, const void *msg, size_t length);
+
 /*
  * 开启TCP监听
  * host：主机名、域名或者点分十进制IP地址、或者IPv6的16进制串
@@ -202,6 +237,17 @@ int TcpConnectSocket(const char *host, const char *service, unsigned int timeout
  */
 int TcpListenSocket(const char *host, const char *service, int backlog);
 
+/*
+ * 开启TCP监听，并开启TCP Fast Open(TFO)
+ * host：主机名、域名或者点分十进制IP地址、或者IPv6的16进制串
+ * service：端口或者服务名如ftp、ntp等
+ * backlog：套接字的未完成连接队列的最大长度
+ * tfo_qlen：TFO队列长度，即未完成三次握手但已携带数据的连接最大数量，<=0表示不开启
+ * 注意：服务端TFO还需开启内核参数net.ipv4.tcp_fastopen的第2位（如设置为3）
+ * return：sockfd on success，-1 on failed
+ */
+int TcpListenSocket2(const char *host, const char *service, int backlog, int tfo_qlen);
+
 /*
  * TCP读取数据
  * sockfd：套接字描述符
@@ -222,6 +268,112 @@ int TcpRecvSocket(int sockfd, void *msg, size_t length, int timeout);
  */
 int TcpSendSocket(int sockfd, const void *msg, size_t length, int timeout);
 
+/*
+ * TCP读取数据，先以非阻塞方式recv，只在EAGAIN时用poll等待，已有数据时不产生额外的系统调用
+ * sockfd：套接字描述符
+ * msg：保存数据的缓存
+ * length：msg缓存大小，单位字节
+ * deadline：整个调用的绝对截止时间(ms)，基于CLOCK_MONOTONIC（同TimerNow），小于0表示一直等待
+ * return：num of read bytes，到截止时间或对端关闭时可能小于length，0 到截止时间仍未读到数据，-1 出错或对端关闭
+ */
+int TcpRecvSocket2(int sockfd, void *msg, size_t length, long long deadline);
+
+/*
+ * TCP发送数据，先以非阻塞方式send，只在EAGAIN时用poll等待
+ * sockfd：套接字描述符
+ * msg：待发送的数据
+ * length：msg数据大小，单位字节
+ * deadline：整个调用的绝对截止时间(ms)，基于CLOCK_MONOTONIC（同TimerNow），小于0表示一直等待
+ * return：length on success，小于length 到截止时间未发送完（errno为ETIMEDOUT）或发送部分数据后出错（errno为出错原因，如EPIPE），
+ *         -1 未发送任何数据即出错；与TcpRecvSocket2一致，已传输的数据总会计入返回值
+ */
+int TcpSendSocket2(int sockfd, const void *msg, size_t length, long long deadline);
+
+/*
+ * TCP分散读取数据(readv)，依次填满iov中的每个缓存，语义同TcpRecvSocket
+ * sockfd：套接字描述符
+ * iov：保存数据的缓存数组
+ * iovcnt：iov数组元素个数，不超过IOV_MAX
+ * timeout：超时时间(ms)
+ * return：num of read bytes on success，-1 on failed
+ */
+int TcpRecvSocketv(int sockfd, const struct iovec *iov, int iovcnt, int timeout);
+
+/*
+ * TCP聚集发送数据(writev)，如协议头+数据体一次发送，语义同TcpSendSocket
+ * sockfd：套接字描述符
+ * iov：待发送的数据数组
+ * iovcnt：iov数组元素个数，不超过IOV_MAX
+ * timeout：超时时间(ms)
+ * return：num of send on success，-1 on failed
+ */
+int TcpSendSocketv(int sockfd, const struct iovec *iov, int iovcnt, int timeout);
+
+/*
+ * 将文件内容直接发送到TCP套接字，数据不经过用户空间
+ * 普通文件使用sendfile，管道使用splice，其他文件（如字符设备、套接字）经由中间管道splice；
+ * 其中不可定位的文件（如套接字、终端）读出后无法退回，只支持阻塞发送(timeout < 0)，否则返回-1，errno为ESPIPE
+ * sockfd：套接字描述符
+ * filefd：文件描述符
+ * offset：输入为起始偏移，返回时更新为下一个待发送的偏移，可据此断点续传；
+ *         为NULL则从文件当前位置开始；管道忽略该参数
+ * length：待发送的字节数，为0表示发送到文件末尾
+ * timeout：超时时间(ms)，与TcpSendSocket相同，每次等待可写的超时时间
+ * return：num of send（超时或出错时可能小于length） on success，-1 on failed
+ */
+ssize_t TcpSendFile(int sockfd, int filefd, off_t *offset, size_t length, int timeout);
+
+/* 同时未完成的零拷贝send数上限，超过时拷贝发送 */
+#define TCP_ZEROCOPY_WINDOW 1024
+
+/*
+ * TCP零拷贝发送(MSG_ZEROCOPY)的状态，每个套接字一个，由TcpZeroCopyInit初始化
+ * 内核按成功的send调用依次编号，完成通知从套接字错误队列中读取
+ */
+struct TcpZeroCopy
+{
+	int sockfd;
+	size_t threshold;       /* 小于该大小的数据直接拷贝发送 */
+	unsigned int next_id;   /* 下一次零拷贝send的编号 */
+	unsigned int done_id;   /* 编号小于done_id的send均已完成 */
+	unsigned int copied;    /* 内核实际退化为拷贝的次数，持续增长说明零拷贝无收益 */
+	unsigned int pending[TCP_ZEROCOPY_WINDOW / 32]; /* 编号大于done_id且已完成的send，按编号取模记录乱序到达的通知 */
+};
+
+/*
+ * 初始化零拷贝发送，开启套接字SO_ZEROCOPY选项
+ * zc：零拷贝状态
+ * sockfd：套接字描述符
+ * threshold：零拷贝的最小数据大小，单位字节，为0则取16KB
+ * return：0 on success，-1 on fail
+ */
+int TcpZeroCopyInit(struct TcpZeroCopy *zc, int sockfd, size_t threshold);
+
+/*
+ * TCP零拷贝发送数据，返回后msg不能立即修改或释放，须等到TcpZeroCopyDone(zc, *token)返回1
+ * zc：零拷贝状态
+ * msg：待发送的数据
+ * length：msg数据大小，单位字节，小于threshold时拷贝发送，msg可立即复用
+ * timeout：超时时间(ms)
+ * token：保存完成标记，失败时也会设置：出错前可能已有部分数据以零拷贝方式发出，
+ *        同样须等到TcpZeroCopyDone(zc, *token)返回1才能修改或释放msg
+ * return：num of send on success，-1 on failed
+ */
+int TcpSendSocketZeroCopy(struct TcpZeroCopy *zc, const void *msg, size_t length, int timeout, unsigned int *token);
+
+/*
+ * 读取套接字错误队列中的零拷贝完成通知
+ * timeout：等待时间(ms)，0表示不等待
+ * return：本次读取的通知数，-1 on fail
+ */
+int TcpZeroCopyPoll(struct TcpZeroCopy *zc, int timeout);
+
+/*
+ * 判断token对应的发送缓存是否可以复用
+ * return：1 可以复用，0 内核仍在引用
+ */
+int TcpZeroCopyDone(const struct TcpZeroCopy *zc, unsigned int token);
+
 /*
  * 开启UDP监听，返回监听套接字
  * host：主机名、域名或者点分十进制IP地址、或者IPv6的16进制串
@@ -230,6 +382,15 @@ int TcpSendSocket(int sockfd, const void *msg, size_t length, int timeout);
  */
 int UdpListenSocket(const char *host, const char *service);
 
+/*
+ * 开启UDP监听，并按需开启接收时间戳(SO_TIMESTAMPING)，由UdpRecvSocket2/UdpRecvSocketBatch返回每个数据报的时间戳
+ * host：主机名、域名或者点分十进制IP地址、或者IPv6的16进制串
+ * service：端口或者服务名如ftp、ntp等
+ * tstamp：TSTAMP_SOFTWARE/TSTAMP_HARDWARE组合，为0表示不开启；硬件时间戳还需SetSocketTimestamping指定网卡
+ * return：sockfd on success，-1 on failed
+ */
+int UdpListenSocket2(const char *host, const char *service, int tstamp);
+
 /*
  * UDP读取数据
  * sockfd：套接字描述符
@@ -263,6 +424,90 @@ int UdpSendSocket(int sockfd, const struct sockaddr *dest_addr, int addrlen, con
  */
 int UdpSendSocket4(int sockfd, const char *dest_addr, unsigned short port, const void *msg, size_t length);
 
+/*
+ * UDP批量接收的消息槽
+ * buf/size由调用者填写，其余字段由UdpRecvSocketBatch填写
+ */
+struct UdpMsg
+{
+	void *buf;                     /* 接收缓存 */
+	size_t size;                   /* buf大小，单位字节 */
+	size_t length;                 /* 实际接收的字节数 */
+	struct sockaddr_storage addr;  /* 对端地址 */
+	struct timespec stamp;         /* 内核软件接收时间戳(CLOCK_REALTIME)，需先调用SetSocketTimestamp/SetSocketTimestamping开启，否则为0 */
+	struct timespec hwstamp;       /* 网卡硬件接收时间戳（网卡时钟），需开启TSTAMP_HARDWARE且网卡支持，否则为0 */
+	int flags;                     /* 接收标志，如MSG_TRUNC表示数据被截断 */
+	int segsize;                   /* 开启GRO时合并数据报的分段大小，未合并为0 */
+};
+
+/*
+ * UDP读取一个数据报，同时返回对端地址、接收时间戳等辅助数据
+ * sockfd：套接字描述符
+ * msg：消息槽，buf/size由调用者填写
+ * timeout：超时时间(ms)，<=0表示不等待
+ * return：num of read bytes on success，-1 on failed
+ */
+int UdpRecvSocket2(int sockfd, struct UdpMsg *msg, int timeout);
+
+/*
+ * UDP批量读取数据，一次recvmmsg系统调用最多接收UDP_BATCH_MAX个数据报
+ * sockfd：套接字描述符
+ * msgs：消息槽数组
+ * count：msgs数组元素个数
+ * timeout：超时时间(ms)，<=0则不等待直接读取（阻塞套接字会阻塞至少收到一个数据报）
+ * return：num of received msgs on success，-1 on failed
+ */
+#define UDP_BATCH_MAX 64
+int UdpRecvSocketBatch(int sockfd, struct UdpMsg *msgs, int count, int timeout);
+
+/*
+ * UDP批量发送的消息
+ * length由UdpSendSocketBatch填写，其余字段由调用者填写
+ */
+struct UdpSendMsg
+{
+	const struct sockaddr *addr;   /* 目的地址，预先构造好可避免每次解析 */
+	socklen_t addrlen;             /* addr大小 */
+	const struct iovec *iov;       /* 待发送的数据 */
+	int iovcnt;                    /* iov数组元素个数 */
+	size_t length;                 /* 实际发送的字节数 */
+};
+
+/*
+ * UDP批量发送数据，每UDP_BATCH_MAX个数据报一次sendmmsg系统调用
+ * sockfd：套接字描述符
+ * msgs：待发送的消息数组
+ * count：msgs数组元素个数
+ * return：num of sent msgs on success（可能小于count，表示后续消息发送失败），-1 on failed
+ */
+int UdpSendSocketBatch(int sockfd, struct UdpSendMsg *msgs, int count);
+
+/*
+ * UDP分段卸载(GSO)发送数据：msg按segsize切分为多个数据报，由内核/网卡完成分段
+ * 一次调用最多发送64KB，适合大量等长数据报，最后一个分段可以小于segsize
+ * sockfd：套接字描述符
+ * dest_addr：目的IP地址
+ * addrlen：dest_addr大小
+ * msg：待发送的数据
+ * length：msg数据大小，单位字节
+ * segsize：每个数据报的大小，单位字节
+ * return：num of send on success，-1 on failed
+ */
+int UdpSendSocketGso(int sockfd, const struct sockaddr *dest_addr, int addrlen, const void *msg, size_t length, unsigned short segsize);
+
+/*
+ * UDP读取数据，并将GRO合并的数据报拆分回单个数据报
+ * sockfd：套接字描述符，需先调用SetSocketUdpGro开启GRO
+ * msg：保存数据的缓存，建议64KB
+ * length：msg缓存大小，单位字节
+ * timeout：超时时间(ms)
+ * peer_addr：对端IP信息，可选
+ * segs：保存每个数据报在msg中的位置和长度
+ * maxsegs：segs数组元素个数，超出部分的数据报被丢弃
+ * return：num of datagrams on success，-1 on failed
+ */
+int UdpRecvSocketGro(int sockfd, void *msg, size_t length, int timeout, struct sockaddr_storage *peer_addr, struct iovec *segs, int maxsegs);
+
 /*
  * 加入组播
  * grp：要加入的多播组
@@ -301,6 +546,45 @@ int UdpSetMcastLoop(int sockfd, int flag);
  */
 int UdpSetMcastIf(int sockfd, const char *ifname, unsigned int ifindex);
 
+/*
+ * TCP连接状态快照，由TCP_INFO归一化而来，时间单位为us，内核不支持的字段为0
+ */
+struct TcpInfo
+{
+	int state;                          /* TCP_ESTABLISHED等 */
+	unsigned int rtt;                   /* 平滑RTT */
+	unsigned int rttvar;                /* RTT偏差 */
+	unsigned int min_rtt;               /* 最小RTT */
+	unsigned int rto;                   /* 重传超时 */
+	unsigned int snd_mss;               /* 发送MSS，单位字节 */
+	unsigned int snd_cwnd;              /* 拥塞窗口，单位段 */
+	unsigned int snd_ssthresh;          /* 慢启动阈值，单位段 */
+	unsigned int snd_wnd;               /* 对端通告的接收窗口，单位字节 */
+	unsigned int unacked;               /* 已发送未确认的段数 */
+	unsigned int lost;                  /* 判定丢失的段数 */
+	unsigned int retransmits;           /* 当前连续超时重传次数 */
+	unsigned int total_retrans;         /* 累计重传段数 */
+	unsigned int notsent_bytes;         /* 发送缓存中尚未发出的字节数 */
+	int app_limited;                    /* delivery_rate采样时是否受应用限制 */
+	unsigned long long delivery_rate;   /* 最近的交付速率，单位bytes/s */
+	unsigned long long pacing_rate;     /* 发送速率上限，单位bytes/s */
+	unsigned long long bytes_sent;      /* 累计发送字节数（含重传） */
+	unsigned long long bytes_retrans;   /* 累计重传字节数 */
+	unsigned long long bytes_acked;     /* 累计被确认的字节数 */
+	unsigned long long bytes_received;  /* 累计接收的字节数 */
+	unsigned long long busy_time;       /* 有数据待发送的累计时间 */
+	unsigned long long rwnd_limited;    /* 其中受对端接收窗口限制的时间 */
+	unsigned long long sndbuf_limited;  /* 其中受本端发送缓存限制的时间 */
+};
+
+/*
+ * 获取TCP连接状态快照(TCP_INFO)
+ * sockfd：TCP套接字句柄
+ * info：保存快照
+ * return：0 on success，-1 on fail
+ */
+int GetSocketTcpInfo(int sockfd, struct TcpInfo *info);
+
 /*
  * 获取套接字当前文件标志
  * sockfd：套接字句柄
@@ -467,6 +751,54 @@ int SetSocketKeepalive2(int sockfd, int on, int interval, int retry_interval, in
  */
 int SetSocketDeferAccept(int sock);
 
+/*
+ * 设置监听套接字的TCP Fast Open队列长度
+ * sockfd：套接字句柄
+ * qlen：TFO队列长度，为0表示关闭
+ * return：0 on success，-1 on fail
+ */
+int SetSocketFastOpen(int sockfd, int qlen);
+
+/*
+ * 设置套接字是否记录内核接收时间戳(SO_TIMESTAMPNS)
+ * 开启后UdpRecvSocketBatch会在UdpMsg.stamp中返回每个数据报的接收时间
+ * sockfd：套接字句柄
+ * on：0：不开启，1：开启
+ * return：0 on success，-1 on fail
+ */
+int SetSocketTimestamp(int sockfd, int on);
+
+/* 接收时间戳类型 */
+#define TSTAMP_SOFTWARE  0x01 /* 内核软件时间戳 */
+#define TSTAMP_HARDWARE  0x02 /* 网卡硬件时间戳 */
+
+/*
+ * 设置套接字的接收时间戳(SO_TIMESTAMPING)，与SetSocketTimestamp二选一
+ * 软件时间戳记录数据报进入协议栈的时间，与应用读取时间之差即为本进程的排队延迟
+ * sockfd：套接字句柄
+ * flags：TSTAMP_SOFTWARE/TSTAMP_HARDWARE组合，为0表示关闭；TSTAMP_HARDWARE总是同时开启软件时间戳
+ * ifname：开启TSTAMP_HARDWARE时配置该网卡的硬件时间戳(SIOCSHWTSTAMP，需要CAP_NET_ADMIN)，
+ *         只修改接收过滤(rx_filter)，不改变发送时间戳配置；
+ *         为NULL表示网卡已由其他程序（如ptp4l）配置，此时无法检测网卡是否已开启
+ * return：0 on success，1 网卡硬件时间戳配置失败（errno为原因），套接字已开启但只有软件时间戳，-1 on fail
+ */
+int SetSocketTimestamping(int sockfd, int flags, const char *ifname);
+
+/*
+ * 设置UDP套接字默认的GSO分段大小(UDP_SEGMENT)，之后的每次发送都按segsize分段
+ * sockfd：套接字句柄，如CreateUdpSocket/UdpListenSocket返回的套接字
+ * segsize：分段大小，单位字节，为0表示关闭
+ * return：0 on success，-1 on fail
+ */
+int SetSocketUdpGso(int sockfd, int segsize);
+
+/*
+ * 设置UDP套接字是否接收GRO合并的数据报(UDP_GRO)
+ * sockfd：套接字句柄，如CreateUdpSocket/UdpListenSocket返回的套接字
+ * on：0：不开启，1：开启
+ * return：0 on success，-1 on fail
+ */
+int SetSocketUdpGro(int sockfd, int on);
 
 
 
@@ -0,0 +1,342 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "easy_stats.h"
+
+#define HIST_SUB_BITS 2
+#define HIST_SUB (1 << HIST_SUB_BITS)
+
+static const char *g_op_name[SOCKET_OP_MAX] =
+{
+	"AcceptSocket",
+	"AcceptSocket1",
+	"ConnectSocket",
+	"TcpConnectSocket",
+	"TcpConnectSocket2",
+	"TcpConnectSocketRace",
+	"TcpRecvSocket",
+	"TcpSendSocket",
+	"TcpRecvSocket2",
+	"TcpSendSocket2",
+	"TcpRecvSocketv",
+	"TcpSendSocketv",
+	"TcpSendFile",
+	"TcpSendSocketZeroCopy",
+	"TcpZeroCopyPoll",
+	"UdpRecvSocket",
+	"UdpRecvSocket2",
+	"UdpRecvSocketBatch",
+	"UdpRecvSocketGro",
+	"UdpSendSocket",
+	"UdpSendSocket4",
+	"UdpSendSocketBatch",
+	"UdpSendSocketGso",
+};
+
+/*
+ * 统计只是一组unsigned long long，合并/相减时按数组处理
+ */
+#define STATS_WORDS (sizeof(struct SocketStats) / sizeof(unsigned long long))
+
+static void stats_add(struct SocketStats *dst, const struct SocketStats *src)
+{
+	unsigned long long *d = (unsigned long long *)dst;
+	const unsigned long long *s = (const unsigned long long *)src;
+	size_t i;
+
+	for (i=0; i<STATS_WORDS; i++)
+		d[i] += __atomic_load_n(&s[i], __ATOMIC_RELAXED);
+}
+
+static void stats_sub(struct SocketStats *dst, const struct SocketStats *src)
+{
+	unsigned long long *d = (unsigned long long *)dst;
+	const unsigned long long *s = (const unsigned long long *)src;
+	size_t i;
+
+	for (i=0; i<STATS_WORDS; i++)
+		d[i] -= s[i];
+}
+
+struct ThreadStats
+{
+	struct SocketStats stats;
+	struct ThreadStats *prev;
+	struct ThreadStats *next;
+};
+
+static pthread_mutex_t g_registry_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct ThreadStats *g_registry;  /* 所有线程的统计 */
+static struct SocketStats g_retired;    /* 已退出线程的统计之和 */
+static struct SocketStats g_base;       /* SocketStatsReset时的统计之和 */
+
+/*
+ * 所有线程的统计之和，调用者持有g_registry_lock
+ */
+static void sum_locked(struct SocketStats *stats)
+{
+	struct ThreadStats *t;
+
+	memcpy(stats, &g_retired, sizeof(*stats));
+	for (t = g_registry; t; t = t->next)
+		stats_add(stats, &t->stats);
+}
+
+/*
+ * 统计是否已编译进库
+ */
+int SocketStatsEnabled(void)
+{
+#ifdef EASY_SOCKET_STATS
+	return 1;
+#else
+	return 0;
+#endif
+}
+
+/*
+ * 获取所有线程的统计之和
+ */
+void SocketStatsSnapshot(struct SocketStats *stats)
+{
+	if (!stats)
+		return;
+
+	pthread_mutex_lock(&g_registry_lock);
+	sum_locked(stats);
+	stats_sub(stats, &g_base);
+	pthread_mutex_unlock(&g_registry_lock);
+}
+
+/*
+ * 清零统计
+ */
+void SocketStatsReset(void)
+{
+	pthread_mutex_lock(&g_registry_lock);
+	sum_locked(&g_base);
+	pthread_mutex_unlock(&g_registry_lock);
+}
+
+/*
+ * 获取函数名称
+ */
+const char *SocketStatsOpName(int op)
+{
+	if (op < 0 || op >= SOCKET_OP_MAX)
+		return "unknown";
+	return g_op_name[op];
+}
+
+/*
+ * 获取直方图桶的上限
+ */
+unsigned long long SocketStatsBucketMax(int index)
+{
+	int e, sub;
+
+	if (index < 0)
+		return 0;
+	if (index < HIST_SUB)
+		return (unsigned long long)index;
+	if (index >= SOCKET_HIST_BUCKETS - 1)
+		return ~0ULL;
+
+	e = (index >> HIST_SUB_BITS) + HIST_SUB_BITS - 1;
+	sub = index & (HIST_SUB - 1);
+	return ((unsigned long long)(HIST_SUB + sub + 1) << (e - HIST_SUB_BITS)) - 1;
+}
+
+/*
+ * 计算耗时百分位
+ */
+unsigned long long SocketStatsPercentile(const struct SocketOpStats *op, double pct)
+{
+	unsigned long long total = 0, target, sum = 0;
+	int i;
+
+	if (!op)
+		return 0;
+
+	for (i=0; i<SOCKET_HIST_BUCKETS; i++)
+		total += op->hist[i];
+	if (total == 0)
+		return 0;
+
+	if (pct < 0)
+		pct = 0;
+	if (pct > 100)
+		pct = 100;
+	target = (unsigned long long)(total * pct / 100.0 + 0.5);
+	if (target == 0)
+		target = 1;
+
+	for (i=0; i<SOCKET_HIST_BUCKETS; i++)
+	{
+		sum += op->hist[i];
+		if (sum >= target)
+			return SocketStatsBucketMax(i);
+	}
+	return SocketStatsBucketMax(SOCKET_HIST_BUCKETS - 1);
+}
+
+#ifdef EASY_SOCKET_STATS
+
+static pthread_key_t g_key;
+static pthread_once_t g_once = PTHREAD_ONCE_INIT;
+static __thread struct ThreadStats *t_stats;
+static __thread struct SocketOpStats *t_cur; /* 当前所在的被统计函数 */
+
+/*
+ * 只有所属线程写，快照线程读；用relaxed store避免撕裂，不需要原子加
+ */
+#define BUMP(field, n) __atomic_store_n(&(field), (field) + (n), __ATOMIC_RELAXED)
+
+/*
+ * 耗时对应的桶：小于HIST_SUB的值各占一个桶，之后每个2的幂区间分为HIST_SUB个桶
+ */
+static int bucket_index(unsigned long long v)
+{
+	int e, idx;
+
+	if (v < HIST_SUB)
+		return (int)v;
+
+	e = 63 - __builtin_clzll(v);
+	idx = ((e - HIST_SUB_BITS + 1) << HIST_SUB_BITS) + (int)((v >> (e - HIST_SUB_BITS)) & (HIST_SUB - 1));
+	return (idx < SOCKET_HIST_BUCKETS) ? idx : SOCKET_HIST_BUCKETS - 1;
+}
+
+static long long monotonic_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/*
+ * 线程退出时合并统计
+ */
+static void thread_stats_destroy(void *param)
+{
+	struct ThreadStats *t = (struct ThreadStats *)param;
+
+	pthread_mutex_lock(&g_registry_lock);
+	if (t->prev)
+		t->prev->next = t->next;
+	else
+		g_registry = t->next;
+	if (t->next)
+		t->next->prev = t->prev;
+	stats_add(&g_retired, &t->stats);
+	pthread_mutex_unlock(&g_registry_lock);
+
+	free(t);
+	t_stats = NULL;
+	t_cur = NULL;
+}
+
+static void make_key(void)
+{
+	pthread_key_create(&g_key, thread_stats_destroy);
+}
+
+static struct ThreadStats *get_stats(void)
+{
+	struct ThreadStats *t = t_stats;
+	if (t)
+		return t;
+
+	pthread_once(&g_once, make_key);
+	t = (struct ThreadStats *)calloc(1, sizeof(*t));
+	if (!t)
+		return NULL;
+
+	pthread_mutex_lock(&g_registry_lock);
+	t->next = g_registry;
+	if (g_registry)
+		g_registry->prev = t;
+	g_registry = t;
+	pthread_mutex_unlock(&g_registry_lock);
+
+	pthread_setspecific(g_key, t);
+	t_stats = t;
+	return t;
+}
+
+void easy_stats_enter(struct SocketStatsFrame *frame, int op)
+{
+	int saved = errno;
+	struct ThreadStats *t = get_stats();
+
+	frame->prev = t_cur;
+	frame->op = t ? &t->stats.op[op] : NULL;
+	frame->start = monotonic_ns();
+	t_cur = frame->op;
+	errno = saved;
+}
+
+void easy_stats_leave(struct SocketStatsFrame *frame, int failed, unsigned long long bytes, int is_short)
+{
+	struct SocketOpStats *s = frame->op;
+	int idx, saved = errno;
+	long long elapsed = monotonic_ns() - frame->start;
+
+	t_cur = frame->prev;
+	if (!s)
+		return;
+
+	if (elapsed < 0)
+		elapsed = 0;
+	idx = bucket_index((unsigned long long)elapsed);
+	BUMP(s->calls, 1);
+	BUMP(s->errors, failed ? 1 : 0);
+	BUMP(s->shorts, is_short ? 1 : 0);
+	BUMP(s->bytes, bytes);
+	BUMP(s->elapsed_ns, (unsigned long long)elapsed);
+	BUMP(s->hist[idx], 1);
+	errno = saved;
+}
+
+void easy_stats_syscall(int failed)
+{
+	struct SocketOpStats *s = t_cur;
+
+	if (!s)
+		return;
+
+	BUMP(s->syscalls, 1);
+	if (!failed)
+		return;
+	if (errno == EAGAIN || errno == EWOULDBLOCK)
+		BUMP(s->eagain, 1);
+	else if (errno == EINTR)
+		BUMP(s->eintr, 1);
+}
+
+void easy_stats_wait(int ret)
+{
+	struct SocketOpStats *s = t_cur;
+
+	if (!s)
+		return;
+
+	BUMP(s->waits, 1);
+	easy_stats_syscall(ret < 0);
+	if (ret == 0)
+		BUMP(s->timeouts, 1);
+}
+
+void easy_stats_timeout(void)
+{
+	struct SocketOpStats *s = t_cur;
+
+	if (s)
+		BUMP(s->timeouts, 1);
+}
+
+#endif
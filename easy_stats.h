@@ -0,0 +1,135 @@
+/*
+ * 套接字I/O统计: C接口方式
+ * Copyright FreeCode. All Rights Reserved.
+ * MIT License (https://opensource.org/licenses/MIT)
+ * 2024 by liuqingshuige
+ */
+#ifndef __FREE_EASY_STATS_H__
+#define __FREE_EASY_STATS_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * 统计只在定义了EASY_SOCKET_STATS时编译进库（make STATS=1），否则所有计数恒为0
+ * 计数按线程保存，记录时不加锁也不使用原子加；线程退出时合并到全局
+ */
+
+/* 被统计的函数，与easy_socket.h中的函数一一对应 */
+#define SOCKET_OP_ACCEPT               0   /* AcceptSocket */
+#define SOCKET_OP_ACCEPT1              1   /* AcceptSocket1 */
+#define SOCKET_OP_CONNECT              2   /* ConnectSocket */
+#define SOCKET_OP_TCP_CONNECT          3   /* TcpConnectSocket */
+#define SOCKET_OP_TCP_CONNECT2         4   /* TcpConnectSocket2 */
+#define SOCKET_OP_TCP_CONNECT_RACE     5   /* TcpConnectSocketRace */
+#define SOCKET_OP_TCP_RECV             6   /* TcpRecvSocket */
+#define SOCKET_OP_TCP_SEND             7   /* TcpSendSocket */
+#define SOCKET_OP_TCP_RECV2            8   /* TcpRecvSocket2 */
+#define SOCKET_OP_TCP_SEND2            9   /* TcpSendSocket2 */
+#define SOCKET_OP_TCP_RECVV            10  /* TcpRecvSocketv */
+#define SOCKET_OP_TCP_SENDV            11  /* TcpSendSocketv */
+#define SOCKET_OP_TCP_SENDFILE         12  /* TcpSendFile */
+#define SOCKET_OP_TCP_SEND_ZEROCOPY    13  /* TcpSendSocketZeroCopy */
+#define SOCKET_OP_TCP_ZEROCOPY_POLL    14  /* TcpZeroCopyPoll */
+#define SOCKET_OP_UDP_RECV             15  /* UdpRecvSocket */
+#define SOCKET_OP_UDP_RECV2            16  /* UdpRecvSocket2 */
+#define SOCKET_OP_UDP_RECV_BATCH       17  /* UdpRecvSocketBatch */
+#define SOCKET_OP_UDP_RECV_GRO         18  /* UdpRecvSocketGro */
+#define SOCKET_OP_UDP_SEND             19  /* UdpSendSocket */
+#define SOCKET_OP_UDP_SEND4            20  /* UdpSendSocket4 */
+#define SOCKET_OP_UDP_SEND_BATCH       21  /* UdpSendSocketBatch */
+#define SOCKET_OP_UDP_SEND_GSO         22  /* UdpSendSocketGso */
+#define SOCKET_OP_MAX                  23
+
+/*
+ * 耗时直方图按对数线性分桶：每个2的幂区间再均分为4个桶，相对误差不超过25%，
+ * 单位ns，最后一个桶包含所有超过约32分钟的值
+ */
+#define SOCKET_HIST_BUCKETS            160
+
+/*
+ * 单个函数的统计，嵌套调用时（如TcpConnectSocket调用ConnectSocket）系统调用计入内层函数
+ */
+struct SocketOpStats
+{
+	unsigned long long calls;       /* 调用次数 */
+	unsigned long long errors;      /* 返回失败的次数 */
+	unsigned long long shorts;      /* 成功但未读写完请求长度的次数 */
+	unsigned long long bytes;       /* 读写的字节数 */
+	unsigned long long syscalls;    /* 系统调用次数，含等待 */
+	unsigned long long waits;       /* 其中poll等待的次数 */
+	unsigned long long eagain;      /* 系统调用返回EAGAIN的次数 */
+	unsigned long long eintr;       /* 系统调用返回EINTR的次数 */
+	unsigned long long timeouts;    /* 等待超时的次数 */
+	unsigned long long elapsed_ns;  /* 累计耗时，单位ns */
+	unsigned long long hist[SOCKET_HIST_BUCKETS]; /* 单次调用耗时分布 */
+};
+
+struct SocketStats
+{
+	struct SocketOpStats op[SOCKET_OP_MAX]; /* 以SOCKET_OP_XXX为下标 */
+};
+
+/*
+ * 统计是否已编译进库
+ * return：1 已编译，0 未编译
+ */
+int SocketStatsEnabled(void);
+
+/*
+ * 获取所有线程的统计之和（自上次SocketStatsReset以来）
+ * stats：保存统计，结构较大，不宜放在栈上
+ */
+void SocketStatsSnapshot(struct SocketStats *stats);
+
+/*
+ * 清零统计，不会修改各线程的计数，而是记录当前值作为之后快照的基准
+ */
+void SocketStatsReset(void);
+
+/*
+ * 获取函数名称
+ * op：SOCKET_OP_XXX
+ * return：名称，op无效时返回"unknown"
+ */
+const char *SocketStatsOpName(int op);
+
+/*
+ * 获取直方图桶的上限
+ * index：桶下标
+ * return：桶内最大值，单位ns
+ */
+unsigned long long SocketStatsBucketMax(int index);
+
+/*
+ * 计算耗时百分位
+ * op：单个函数的统计
+ * pct：百分位，如50、99、99.9
+ * return：百分位所在桶的上限，单位ns，无数据时为0
+ */
+unsigned long long SocketStatsPercentile(const struct SocketOpStats *op, double pct);
+
+#ifdef EASY_SOCKET_STATS
+/*
+ * 以下供库内部记录统计使用
+ */
+struct SocketStatsFrame
+{
+	struct SocketOpStats *op;
+	struct SocketOpStats *prev;  /* 外层函数的统计 */
+	long long start;
+};
+
+void easy_stats_enter(struct SocketStatsFrame *frame, int op);
+void easy_stats_leave(struct SocketStatsFrame *frame, int failed, unsigned long long bytes, int is_short);
+void easy_stats_syscall(int failed);
+void easy_stats_wait(int ret);
+void easy_stats_timeout(void);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,328 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "easy_tcpinfo.h"
+#include "easy_timer.h"
+
+#define TCPSAMPLER_INIT_FDS 16
+
+struct TcpSampler
+{
+	pthread_t tid;
+	pthread_mutex_t lock;
+	pthread_cond_t cond;
+	int stop;
+	unsigned int interval_ms;
+	TcpSampleCallback cb;
+	void *arg;
+	struct TcpSample *samples;  /* 已登记描述符的最近一次采样，无序 */
+	int nsamples;
+	int capacity;
+	struct TcpSample *scratch;  /* 采样线程私有，解锁后依次回调 */
+	int nscratch;
+};
+
+static unsigned int percent(unsigned long long part, unsigned long long whole)
+{
+	if (!whole)
+		return 0;
+	if (part >= whole)
+		return 100;
+	return (unsigned int)(part * 100 / whole);
+}
+
+/*
+ * 根据与上一次采样的差值计算速率并判断限制因素
+ */
+static void update_sample(struct TcpSample *s, const struct TcpInfo *info, long long now)
+{
+	const struct TcpInfo *prev = &s->info;
+	unsigned long long dt_us = (unsigned long long)(now - s->timestamp) * 1000;
+	unsigned long long acked, busy, rwnd, sndbuf, network;
+
+	if (now <= s->timestamp)
+		return; // 周期过短，保留上一次结果
+
+	acked = info->bytes_acked - prev->bytes_acked;
+	busy = info->busy_time - prev->busy_time;
+	rwnd = info->rwnd_limited - prev->rwnd_limited;
+	sndbuf = info->sndbuf_limited - prev->sndbuf_limited;
+	network = (busy > rwnd + sndbuf) ? busy - rwnd - sndbuf : 0;
+
+	s->send_rate = acked * 1000000 / dt_us;
+	s->recv_rate = (info->bytes_received - prev->bytes_received) * 1000000 / dt_us;
+	s->retrans = info->total_retrans - prev->total_retrans;
+	s->busy_pct = percent(busy, dt_us);
+	s->rwnd_limited_pct = percent(rwnd, busy);
+	s->sndbuf_limited_pct = percent(sndbuf, busy);
+
+	if (!busy)
+		s->limit = acked ? TCP_LIMIT_APP : TCP_LIMIT_NONE;
+	else if (rwnd >= sndbuf && rwnd >= network)
+		s->limit = TCP_LIMIT_RWND;
+	else if (sndbuf >= network)
+		s->limit = TCP_LIMIT_SNDBUF;
+	else if (s->busy_pct < 50 && info->app_limited) // 大部分时间没有数据可发
+		s->limit = TCP_LIMIT_APP;
+	else
+		s->limit = TCP_LIMIT_NETWORK;
+
+	s->info = *info;
+	s->timestamp = now;
+}
+
+static struct TcpSample *find_sample(TcpSampler *sampler, int sockfd)
+{
+	int i;
+
+	for (i=0; i<sampler->nsamples; i++)
+	{
+		if (sampler->samples[i].sockfd == sockfd)
+			return &sampler->samples[i];
+	}
+	return NULL;
+}
+
+/*
+ * 采样所有已登记的描述符，结果复制到scratch
+ * return：本次采样的个数
+ */
+static int sample_all(TcpSampler *sampler)
+{
+	struct TcpInfo info;
+	struct TcpSample *ptr;
+	long long now = TimerNow();
+	int i, n = 0;
+
+	if (sampler->nscratch < sampler->nsamples)
+	{
+		ptr = (struct TcpSample *)realloc(sampler->scratch, sampler->capacity * sizeof(*ptr));
+		if (!ptr)
+			return 0;
+		sampler->scratch = ptr;
+		sampler->nscratch = sampler->capacity;
+	}
+
+	for (i=0; i<sampler->nsamples; i++)
+	{
+		/* 描述符可能已被关闭，跳过，等待注销 */
+		if (GetSocketTcpInfo(sampler->samples[i].sockfd, &info) < 0)
+			continue;
+		update_sample(&sampler->samples[i], &info, now);
+		sampler->scratch[n++] = sampler->samples[i];
+	}
+	return n;
+}
+
+static void *sampler_thread(void *param)
+{
+	TcpSampler *sampler = (TcpSampler *)param;
+	struct timespec ts;
+	long long deadline = TimerNow();
+	int i, n;
+
+	pthread_mutex_lock(&sampler->lock);
+	while (!sampler->stop)
+	{
+		deadline += sampler->interval_ms;
+		ts.tv_sec = deadline / 1000;
+		ts.tv_nsec = (deadline % 1000) * 1000000;
+		while (!sampler->stop && pthread_cond_timedwait(&sampler->cond, &sampler->lock, &ts) != ETIMEDOUT)
+			;
+		if (sampler->stop)
+			break;
+
+		n = sample_all(sampler);
+		if (sampler->cb && n > 0)
+		{
+			pthread_mutex_unlock(&sampler->lock);
+			for (i=0; i<n; i++)
+				sampler->cb(&sampler->scratch[i], sampler->arg);
+			pthread_mutex_lock(&sampler->lock);
+		}
+
+		/* 处理过慢时不追赶错过的周期 */
+		if (deadline < TimerNow())
+			deadline = TimerNow();
+	}
+	pthread_mutex_unlock(&sampler->lock);
+	return NULL;
+}
+
+/*
+ * 创建采样器并启动采样线程
+ * return：sampler on success，NULL on fail
+ */
+TcpSampler *TcpSamplerCreate(unsigned int interval_ms, TcpSampleCallback cb, void *arg)
+{
+	pthread_condattr_t attr;
+	TcpSampler *sampler;
+
+	if (!interval_ms)
+	{
+		errno = EINVAL;
+		return NULL;
+	}
+
+	sampler = (TcpSampler *)calloc(1, sizeof(*sampler));
+	if (!sampler)
+		return NULL;
+
+	sampler->interval_ms = interval_ms;
+	sampler->cb = cb;
+	sampler->arg = arg;
+	sampler->capacity = TCPSAMPLER_INIT_FDS;
+	sampler->samples = (struct TcpSample *)calloc(sampler->capacity, sizeof(struct TcpSample));
+	if (!sampler->samples)
+	{
+		free(sampler);
+		return NULL;
+	}
+
+	pthread_mutex_init(&sampler->lock, NULL);
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&sampler->cond, &attr);
+	pthread_condattr_destroy(&attr);
+
+	if (pthread_create(&sampler->tid, NULL, sampler_thread, sampler) != 0)
+	{
+		pthread_cond_destroy(&sampler->cond);
+		pthread_mutex_destroy(&sampler->lock);
+		free(sampler->samples);
+		free(sampler);
+		return NULL;
+	}
+	return sampler;
+}
+
+/*
+ * 停止采样线程并销毁采样器
+ */
+void TcpSamplerDestroy(TcpSampler *sampler)
+{
+	if (!sampler)
+		return;
+
+	pthread_mutex_lock(&sampler->lock);
+	sampler->stop = 1;
+	pthread_cond_signal(&sampler->cond);
+	pthread_mutex_unlock(&sampler->lock);
+	pthread_join(sampler->tid, NULL);
+
+	pthread_cond_destroy(&sampler->cond);
+	pthread_mutex_destroy(&sampler->lock);
+	free(sampler->samples);
+	free(sampler->scratch);
+	free(sampler);
+}
+
+/*
+ * 登记需要采样的TCP套接字
+ * return：0 on success，-1 on fail
+ */
+int TcpSamplerAdd(TcpSampler *sampler, int sockfd)
+{
+	struct TcpSample *s;
+	struct TcpInfo info;
+	int n;
+
+	if (!sampler || sockfd < 0)
+	{
+		errno = EINVAL;
+		return -1;
+	}
+
+	if (GetSocketTcpInfo(sockfd, &info) < 0)
+		return -1;
+
+	pthread_mutex_lock(&sampler->lock);
+	if (find_sample(sampler, sockfd))
+	{
+		pthread_mutex_unlock(&sampler->lock);
+		errno = EEXIST;
+		return -1;
+	}
+
+	if (sampler->nsamples == sampler->capacity)
+	{
+		n = sampler->capacity * 2;
+		s = (struct TcpSample *)realloc(sampler->samples, n * sizeof(*s));
+		if (!s)
+		{
+			pthread_mutex_unlock(&sampler->lock);
+			return -1;
+		}
+		sampler->samples = s;
+		sampler->capacity = n;
+	}
+
+	s = &sampler->samples[sampler->nsamples++];
+	memset(s, 0, sizeof(*s));
+	s->sockfd = sockfd;
+	s->timestamp = TimerNow();
+	s->info = info;
+	pthread_mutex_unlock(&sampler->lock);
+	return 0;
+}
+
+/*
+ * 注销描述符
+ * return：0 on success，-1 on fail
+ */
+int TcpSamplerRemove(TcpSampler *sampler, int sockfd)
+{
+	struct TcpSample *s;
+
+	if (!sampler)
+	{
+		errno = EINVAL;
+		return -1;
+	}
+
+	pthread_mutex_lock(&sampler->lock);
+	s = find_sample(sampler, sockfd);
+	if (!s)
+	{
+		pthread_mutex_unlock(&sampler->lock);
+		errno = ENOENT;
+		return -1;
+	}
+
+	*s = sampler->samples[--sampler->nsamples]; // 用最后一个填补空位
+	pthread_mutex_unlock(&sampler->lock);
+	return 0;
+}
+
+/*
+ * 获取描述符最近一次的采样结果
+ * return：0 on success，-1 on fail
+ */
+int TcpSamplerGet(TcpSampler *sampler, int sockfd, struct TcpSample *sample)
+{
+	struct TcpSample *s;
+
+	if (!sampler || !sample)
+	{
+		errno = EINVAL;
+		return -1;
+	}
+
+	pthread_mutex_lock(&sampler->lock);
+	s = find_sample(sampler, sockfd);
+	if (s)
+		*sample = *s;
+	pthread_mutex_unlock(&sampler->lock);
+
+	if (!s)
+	{
+		errno = ENOENT;
+		return -1;
+	}
+	return 0;
+}
@@ -0,0 +1,85 @@
+/*
+ * TCP连接状态采样: C接口方式
+ * Copyright FreeCode. All Rights Reserved.
+ * MIT License (https://opensource.org/licenses/MIT)
+ * 2024 by liuqingshuige
+ */
+#ifndef __FREE_EASY_TCPINFO_H__
+#define __FREE_EASY_TCPINFO_H__
+
+#include "easy_socket.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 采样周期内吞吐量的主要限制因素 */
+#define TCP_LIMIT_NONE     0  /* 空闲，没有数据要发送 */
+#define TCP_LIMIT_APP      1  /* 应用写入不足 */
+#define TCP_LIMIT_NETWORK  2  /* 受拥塞窗口限制，即网络 */
+#define TCP_LIMIT_RWND     3  /* 受对端接收窗口限制 */
+#define TCP_LIMIT_SNDBUF   4  /* 受本端发送缓存限制 */
+
+typedef struct TcpSampler TcpSampler;
+
+/*
+ * 一次采样结果，速率和百分比均按与上一次采样之间的差值计算，首次采样时为0
+ */
+struct TcpSample
+{
+	int sockfd;
+	long long timestamp;              /* 采样时刻，CLOCK_MONOTONIC，单位ms */
+	struct TcpInfo info;              /* TCP_INFO快照 */
+	unsigned long long send_rate;     /* 对端确认的速率，单位bytes/s */
+	unsigned long long recv_rate;     /* 接收速率，单位bytes/s */
+	unsigned int retrans;             /* 本周期内重传的段数 */
+	unsigned int busy_pct;            /* 有数据待发送的时间占采样周期的百分比 */
+	unsigned int rwnd_limited_pct;    /* 受接收窗口限制的时间占busy时间的百分比 */
+	unsigned int sndbuf_limited_pct;  /* 受发送缓存限制的时间占busy时间的百分比 */
+	int limit;                        /* TCP_LIMIT_XXX */
+};
+
+/*
+ * 采样回调，在采样线程中调用，可调用TcpSamplerAdd/TcpSamplerRemove，不能调用TcpSamplerDestroy
+ * sample：本次采样结果
+ * arg：用户参数
+ */
+typedef void (*TcpSampleCallback)(const struct TcpSample *sample, void *arg);
+
+/*
+ * 创建采样器并启动采样线程
+ * interval_ms：采样周期，单位ms
+ * cb：每个描述符每次采样后调用，可为NULL，此时只能通过TcpSamplerGet获取结果
+ * arg：回调的用户参数
+ * return：sampler on success，NULL on fail
+ */
+TcpSampler *TcpSamplerCreate(unsigned int interval_ms, TcpSampleCallback cb, void *arg);
+
+/*
+ * 停止采样线程并销毁采样器，不会关闭已登记的描述符
+ */
+void TcpSamplerDestroy(TcpSampler *sampler);
+
+/*
+ * 登记需要采样的TCP套接字，登记时立即采样一次作为基准
+ * return：0 on success，-1 on fail
+ */
+int TcpSamplerAdd(TcpSampler *sampler, int sockfd);
+
+/*
+ * 注销描述符，应在关闭描述符之前调用
+ * return：0 on success，-1 on fail
+ */
+int TcpSamplerRemove(TcpSampler *sampler, int sockfd);
+
+/*
+ * 获取描述符最近一次的采样结果
+ * return：0 on success，-1 on fail（未登记）
+ */
+int TcpSamplerGet(TcpSampler *sampler, int sockfd, struct TcpSample *sample);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
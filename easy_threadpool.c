@@ -0,0 +1,681 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+#include "easy_threadpool.h"
+#include "easy_buffer.h"
+
+#define DEQUE_SIZE 4096           /* 每个工作线程双端队列的容量，须为2的幂 */
+#define DEQUE_MASK (DEQUE_SIZE - 1)
+#define INJECT_BATCH 64           /* 每次从投递队列转入双端队列的最大任务数 */
+#define POOL_SPIN 64              /* 休眠前的窃取轮数 */
+#define POOL_SLEEP_MS 100         /* 休眠的最长时间，防止丢失唤醒 */
+#define POOL_MAX_NODES 64
+
+struct PoolTask
+{
+	struct PoolTask *next;  /* 投递队列链表 */
+	TaskFunc fn;
+	void *arg;
+	void *handler;          /* SocketHandler/DatagramHandler */
+	void *user;
+	int sockfd;
+	union
+	{
+		struct sockaddr_storage addr;
+		struct UdpMsg msg;
+	} u;
+};
+
+/* Chase-Lev双端队列：所有者在bottom端压入/弹出，其他线程从top端窃取 */
+struct Deque
+{
+	long top __attribute__((aligned(64)));
+	long bottom __attribute__((aligned(64)));
+	struct PoolTask *buf[DEQUE_SIZE];
+};
+
+/* 多生产者单消费者无锁投递队列，供其他线程向该工作线程提交任务 */
+struct Inject
+{
+	struct PoolTask *head __attribute__((aligned(64)));
+	struct PoolTask *tail __attribute__((aligned(64)));
+	struct PoolTask stub;
+};
+
+struct PoolWorker
+{
+	int idx;
+	int cpu;
+	int node;
+	pthread_t tid;
+	int started;
+	unsigned int seed;
+	struct Deque *deque;   /* 由工作线程在绑定CPU后分配，内存位于本地节点 */
+	struct Inject inject;
+	struct ThreadPool *pool;
+};
+
+struct ThreadPool
+{
+	int nworkers;
+	int flags;
+	int stop;
+	int idle;              /* 休眠中的工作线程数 */
+	int ready;
+	unsigned int next;     /* 轮流投递的计数 */
+	pthread_mutex_t lock;  /* 仅用于休眠/唤醒和启动同步 */
+	pthread_cond_t cond;
+	struct PoolWorker *workers;
+};
+
+static __thread struct PoolWorker *t_worker;
+
+static int deque_push(struct Deque *d, struct PoolTask *t)
+{
+	long b = __atomic_load_n(&d->bottom, __ATOMIC_RELAXED);
+	long top = __atomic_load_n(&d->top, __ATOMIC_ACQUIRE);
+
+	if (b - top >= DEQUE_SIZE)
+		return -1;
+
+	__atomic_store_n(&d->buf[b & DEQUE_MASK], t, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	__atomic_store_n(&d->bottom, b + 1, __ATOMIC_RELAXED);
+	return 0;
+}
+
+static struct PoolTask *deque_pop(struct Deque *d)
+{
+	long b = __atomic_load_n(&d->bottom, __ATOMIC_RELAXED) - 1;
+	long top;
+	struct PoolTask *t;
+
+	__atomic_store_n(&d->bottom, b, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	top = __atomic_load_n(&d->top, __ATOMIC_RELAXED);
+
+	if (top > b) // 队列为空
+	{
+		__atomic_store_n(&d->bottom, b + 1, __ATOMIC_RELAXED);
+		return NULL;
+	}
+
+	t = __atomic_load_n(&d->buf[b & DEQUE_MASK], __ATOMIC_RELAXED);
+	if (top == b) // 最后一个任务，与窃取者竞争
+	{
+		if (!__atomic_compare_exchange_n(&d->top, &top, top + 1, 0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+			t = NULL;
+		__atomic_store_n(&d->bottom, b + 1, __ATOMIC_RELAXED);
+	}
+	return t;
+}
+
+static struct PoolTask *deque_steal(struct Deque *d)
+{
+	long top = __atomic_load_n(&d->top, __ATOMIC_ACQUIRE);
+	long b;
+	struct PoolTask *t;
+
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	b = __atomic_load_n(&d->bottom, __ATOMIC_ACQUIRE);
+	if (top >= b)
+		return NULL;
+
+	t = __atomic_load_n(&d->buf[top & DEQUE_MASK], __ATOMIC_RELAXED);
+	if (!__atomic_compare_exchange_n(&d->top, &top, top + 1, 0, __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+		return NULL;
+	return t;
+}
+
+static void inject_init(struct Inject *q)
+{
+	q->stub.next = NULL;
+	q->head = q->tail = &q->stub;
+}
+
+static void inject_push(struct Inject *q, struct PoolTask *t)
+{
+	struct PoolTask *prev;
+
+	t->next = NULL;
+	prev = __atomic_exchange_n(&q->head, t, __ATOMIC_ACQ_REL);
+	__atomic_store_n(&prev->next, t, __ATOMIC_RELEASE);
+}
+
+static struct PoolTask *inject_pop(struct Inject *q)
+{
+	struct PoolTask *tail = q->tail;
+	struct PoolTask *next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+
+	if (tail == &q->stub)
+	{
+		if (!next)
+			return NULL;
+		q->tail = next;
+		tail = next;
+		next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+	}
+
+	if (next)
+	{
+		q->tail = next;
+		return tail;
+	}
+
+	/* tail是最后一个节点，或者生产者正在链接下一个节点 */
+	if (tail != __atomic_load_n(&q->head, __ATOMIC_ACQUIRE))
+		return NULL;
+
+	inject_push(q, &q->stub);
+	next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+	if (next)
+	{
+		q->tail = next;
+		return tail;
+	}
+	return NULL;
+}
+
+static int inject_empty(struct Inject *q)
+{
+	return q->tail == &q->stub && !__atomic_load_n(&q->stub.next, __ATOMIC_ACQUIRE)
+		&& __atomic_load_n(&q->head, __ATOMIC_ACQUIRE) == &q->stub;
+}
+
+/*
+ * 读取CPU所在的NUMA节点，/sys不可用时返回0
+ */
+static int cpu_to_node(int cpu)
+{
+	char path[128];
+	int node;
+
+	for (node=0; node<POOL_MAX_NODES; node++)
+	{
+		snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/node%d", cpu, node);
+		if (access(path, F_OK) == 0)
+			return node;
+	}
+	return 0;
+}
+
+/*
+ * 为工作线程分配CPU：POOL_NUMA时按节点排序，使相邻序号的工作线程位于同一节点
+ */
+static void assign_cpus(ThreadPool *pool)
+{
+	long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+	int *cpus, i, j, k, node;
+
+	if (ncpu <= 0)
+		ncpu = 1;
+
+	cpus = (int *)malloc(ncpu * sizeof(int));
+	if (!cpus)
+	{
+		for (i=0; i<pool->nworkers; i++)
+			pool->workers[i].cpu = i % ncpu;
+		return;
+	}
+
+	k = 0;
+	if (pool->flags & POOL_NUMA)
+	{
+		for (node=0; node<POOL_MAX_NODES && k<ncpu; node++)
+		{
+			for (j=0; j<ncpu; j++)
+			{
+				if (cpu_to_node(j) == node)
+					cpus[k++] = j;
+			}
+		}
+	}
+	for (j=0; k<ncpu; j++) // 未能识别节点的CPU按顺序补齐
+		cpus[k++] = j;
+
+	for (i=0; i<pool->nworkers; i++)
+	{
+		pool->workers[i].cpu = cpus[i % ncpu];
+		pool->workers[i].node = (pool->flags & POOL_NUMA) ? cpu_to_node(pool->workers[i].cpu) : 0;
+	}
+	free(cpus);
+}
+
+static void run_task(struct PoolTask *t)
+{
+	t->fn(t->arg);
+	BufferFree(t);
+}
+
+/*
+ * 从其他工作线程窃取任务，POOL_NUMA时先窃取同一节点的
+ */
+static struct PoolTask *steal_task(struct PoolWorker *w)
+{
+	ThreadPool *pool = w->pool;
+	struct PoolTask *t;
+	int pass, i, start, v;
+
+	start = rand_r(&w->seed) % pool->nworkers;
+	for (pass=0; pass<2; pass++)
+	{
+		for (i=0; i<pool->nworkers; i++)
+		{
+			struct PoolWorker *victim;
+
+			v = (start + i) % pool->nworkers;
+			victim = &pool->workers[v];
+			if (victim == w || !victim->deque)
+				continue;
+			if ((pool->flags & POOL_NUMA) && (pass == 0) != (victim->node == w->node))
+				continue;
+
+			t = deque_steal(victim->deque);
+			if (t)
+				return t;
+		}
+
+		if (!(pool->flags & POOL_NUMA))
+			break;
+	}
+	return NULL;
+}
+
+/*
+ * 获取下一个任务：本线程队列 -> 投递队列 -> 窃取
+ */
+static struct PoolTask *next_task(struct PoolWorker *w)
+{
+	struct PoolTask *t;
+	int i;
+
+	t = deque_pop(w->deque);
+	if (t)
+		return t;
+
+	/* 投递队列只能由本线程消费，转入双端队列后其他线程才能窃取 */
+	for (i=0; i<INJECT_BATCH; i++)
+	{
+		t = inject_pop(&w->inject);
+		if (!t)
+			break;
+		if (deque_push(w->deque, t) < 0)
+			return t;
+	}
+
+	t = deque_pop(w->deque);
+	if (t)
+		return t;
+
+	return steal_task(w);
+}
+
+static int has_work(ThreadPool *pool)
+{
+	int i;
+
+	for (i=0; i<pool->nworkers; i++)
+	{
+		struct PoolWorker *w = &pool->workers[i];
+		if (!inject_empty(&w->inject))
+			return 1;
+		if (w->deque && __atomic_load_n(&w->deque->bottom, __ATOMIC_SEQ_CST) > __atomic_load_n(&w->deque->top, __ATOMIC_SEQ_CST))
+			return 1;
+	}
+	return 0;
+}
+
+static void pool_sleep(struct PoolWorker *w)
+{
+	ThreadPool *pool = w->pool;
+	struct timespec ts;
+
+	pthread_mutex_lock(&pool->lock);
+	__atomic_fetch_add(&pool->idle, 1, __ATOMIC_SEQ_CST);
+	if (!has_work(pool) && !__atomic_load_n(&pool->stop, __ATOMIC_SEQ_CST))
+	{
+		clock_gettime(CLOCK_MONOTONIC, &ts);
+		ts.tv_nsec += POOL_SLEEP_MS * 1000000L;
+		if (ts.tv_nsec >= 1000000000L)
+		{
+			ts.tv_sec++;
+			ts.tv_nsec -= 1000000000L;
+		}
+		pthread_cond_timedwait(&pool->cond, &pool->lock, &ts);
+	}
+	__atomic_fetch_sub(&pool->idle, 1, __ATOMIC_SEQ_CST);
+	pthread_mutex_unlock(&pool->lock);
+}
+
+static void pool_wakeup(ThreadPool *pool)
+{
+	/* 与pool_sleep中的idle++/has_work构成先写后读，任务入队后看到idle为0则工作线程必能看到任务 */
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	if (__atomic_load_n(&pool->idle, __ATOMIC_SEQ_CST) == 0)
+		return;
+
+	pthread_mutex_lock(&pool->lock);
+	pthread_cond_signal(&pool->cond);
+	pthread_mutex_unlock(&pool->lock);
+}
+
+static void *pool_worker(void *param)
+{
+	struct PoolWorker *w = (struct PoolWorker *)param;
+	ThreadPool *pool = w->pool;
+	struct PoolTask *t;
+	struct Deque *d;
+	cpu_set_t set;
+	int spin = 0;
+
+	if (pool->flags & (POOL_PIN_CPU | POOL_NUMA))
+	{
+		CPU_ZERO(&set);
+		CPU_SET(w->cpu, &set);
+		pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+	}
+
+	/* 绑定CPU后再分配，按首次访问原则队列内存位于本地节点 */
+	d = (struct Deque *)aligned_alloc(64, sizeof(struct Deque));
+	if (d)
+		memset(d, 0, sizeof(*d));
+
+	pthread_mutex_lock(&pool->lock);
+	__atomic_store_n(&w->deque, d, __ATOMIC_RELEASE);
+	pool->ready++;
+	pthread_cond_broadcast(&pool->cond);
+	pthread_mutex_unlock(&pool->lock);
+
+	if (!d)
+		return NULL;
+
+	t_worker = w;
+	while (1)
+	{
+		t = next_task(w);
+		if (t)
+		{
+			run_task(t);
+			spin = 0;
+			continue;
+		}
+
+		if (__atomic_load_n(&pool->stop, __ATOMIC_SEQ_CST) && !has_work(pool))
+			break;
+
+		if (++spin < POOL_SPIN)
+		{
+			sched_yield();
+			continue;
+		}
+		pool_sleep(w);
+		spin = 0;
+	}
+	return NULL;
+}
+
+/*
+ * 创建线程池
+ * return：pool on success，NULL on fail
+ */
+ThreadPool *ThreadPoolCreate(int nworkers, int flags)
+{
+	ThreadPool *pool;
+	pthread_condattr_t attr;
+	int i;
+
+	if (nworkers <= 0)
+		nworkers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+	if (nworkers <= 0)
+		nworkers = 1;
+
+	pool = (ThreadPool *)calloc(1, sizeof(*pool));
+	if (!pool)
+		return NULL;
+
+	pool->nworkers = nworkers;
+	pool->flags = flags;
+	pool->workers = (struct PoolWorker *)calloc(nworkers, sizeof(struct PoolWorker));
+	if (!pool->workers)
+	{
+		free(pool);
+		return NULL;
+	}
+
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+	pthread_cond_init(&pool->cond, &attr);
+	pthread_condattr_destroy(&attr);
+
+	assign_cpus(pool);
+	for (i=0; i<nworkers; i++)
+	{
+		struct PoolWorker *w = &pool->workers[i];
+		w->idx = i;
+		w->seed = (unsigned int)i * 2654435761u + 1;
+		w->pool = pool;
+		inject_init(&w->inject);
+	}
+
+	for (i=0; i<nworkers; i++)
+	{
+		struct PoolWorker *w = &pool->workers[i];
+		if (pthread_create(&w->tid, NULL, pool_worker, w) != 0)
+		{
+			ThreadPoolDestroy(pool);
+			return NULL;
+		}
+		w->started = 1;
+	}
+
+	/* 等待所有工作线程分配好队列 */
+	pthread_mutex_lock(&pool->lock);
+	while (pool->ready < nworkers)
+		pthread_cond_wait(&pool->cond, &pool->lock);
+	pthread_mutex_unlock(&pool->lock);
+
+	for (i=0; i<nworkers; i++)
+	{
+		if (!pool->workers[i].deque)
+		{
+			ThreadPoolDestroy(pool);
+			errno = ENOMEM;
+			return NULL;
+		}
+	}
+	return pool;
+}
+
+/*
+ * 销毁线程池
+ */
+void ThreadPoolDestroy(ThreadPool *pool)
+{
+	int i;
+
+	if (!pool)
+		return;
+
+	__atomic_store_n(&pool->stop, 1, __ATOMIC_SEQ_CST);
+	pthread_mutex_lock(&pool->lock);
+	pthread_cond_broadcast(&pool->cond);
+	pthread_mutex_unlock(&pool->lock);
+
+	for (i=0; i<pool->nworkers; i++)
+	{
+		if (pool->workers[i].started)
+			pthread_join(pool->workers[i].tid, NULL);
+	}
+
+	for (i=0; i<pool->nworkers; i++)
+		free(pool->workers[i].deque);
+
+	pthread_cond_destroy(&pool->cond);
+	pthread_mutex_destroy(&pool->lock);
+	free(pool->workers);
+	free(pool);
+}
+
+/*
+ * 获取工作线程数
+ */
+int ThreadPoolSize(ThreadPool *pool)
+{
+	return pool ? pool->nworkers : 0;
+}
+
+/*
+ * 销毁过程中只接受工作线程内提交的任务，保证已提交任务派生的任务也能执行完
+ */
+static int pool_closed(ThreadPool *pool)
+{
+	return __atomic_load_n(&pool->stop, __ATOMIC_SEQ_CST) && !(t_worker && t_worker->pool == pool);
+}
+
+static struct PoolTask *task_alloc(TaskFunc fn, void *arg)
+{
+	struct PoolTask *t = (struct PoolTask *)BufferAlloc(sizeof(struct PoolTask));
+	if (!t)
+		return NULL;
+
+	t->fn = fn;
+	t->arg = arg;
+	return t;
+}
+
+/*
+ * 投递任务：hint<0且在本线程池的工作线程中时放入本线程队列
+ */
+static int submit_task(ThreadPool *pool, int hint, struct PoolTask *t)
+{
+	struct PoolWorker *w = t_worker;
+
+	if (w && w->pool == pool)
+	{
+		/* 销毁过程中其他工作线程可能已退出，只投递给本线程 */
+		int stopping = __atomic_load_n(&pool->stop, __ATOMIC_SEQ_CST);
+
+		if ((hint < 0 || stopping) && deque_push(w->deque, t) == 0)
+		{
+			pool_wakeup(pool);
+			return 0;
+		}
+		if (stopping)
+			hint = w->idx;
+	}
+
+	if (hint < 0)
+		hint = (int)(__atomic_fetch_add(&pool->next, 1, __ATOMIC_RELAXED) % pool->nworkers);
+
+	inject_push(&pool->workers[hint % pool->nworkers].inject, t);
+	pool_wakeup(pool);
+	return 0;
+}
+
+/*
+ * 提交任务
+ * return：0 on success，-1 on fail
+ */
+int ThreadPoolSubmit(ThreadPool *pool, TaskFunc fn, void *arg)
+{
+	return ThreadPoolSubmitTo(pool, -1, fn, arg);
+}
+
+/*
+ * 提交任务到指定的工作线程
+ * return：0 on success，-1 on fail
+ */
+int ThreadPoolSubmitTo(ThreadPool *pool, int hint, TaskFunc fn, void *arg)
+{
+	struct PoolTask *t;
+
+	if (!pool || !fn || pool_closed(pool))
+	{
+		errno = EINVAL;
+		return -1;
+	}
+
+	t = task_alloc(fn, arg);
+	if (!t)
+		return -1;
+	return submit_task(pool, hint, t);
+}
+
+static void socket_task(void *param)
+{
+	struct PoolTask *t = (struct PoolTask *)param;
+	((SocketHandler)t->handler)(t->sockfd, &t->u.addr, t->user);
+}
+
+/*
+ * 将已接受的连接交给线程池处理
+ * return：0 on success，-1 on fail
+ */
+int ThreadPoolSubmitSocket(ThreadPool *pool, int hint, int sockfd, const struct sockaddr_storage *addr, SocketHandler fn, void *arg)
+{
+	struct PoolTask *t;
+
+	if (!pool || !fn || pool_closed(pool))
+	{
+		errno = EINVAL;
+		return -1;
+	}
+
+	t = task_alloc(socket_task, NULL);
+	if (!t)
+		return -1;
+
+	t->arg = t;
+	t->handler = (void *)fn;
+	t->user = arg;
+	t->sockfd = sockfd;
+	if (addr)
+		memcpy(&t->u.addr, addr, sizeof(*addr));
+	else
+		memset(&t->u.addr, 0, sizeof(t->u.addr));
+	return submit_task(pool, hint, t);
+}
+
+static void datagram_task(void *param)
+{
+	struct PoolTask *t = (struct PoolTask *)param;
+	((DatagramHandler)t->handler)(t->sockfd, &t->u.msg, t->user);
+	BufferFree(t->u.msg.buf);
+}
+
+/*
+ * 将收到的数据报交给线程池处理
+ * return：0 on success，-1 on fail
+ */
+int ThreadPoolSubmitDatagram(ThreadPool *pool, int hint, int sockfd, const struct UdpMsg *msg, DatagramHandler fn, void *arg)
+{
+	struct PoolTask *t;
+
+	if (!pool || !fn || !msg || pool_closed(pool))
+	{
+		errno = EINVAL;
+		return -1;
+	}
+
+	t = task_alloc(datagram_task, NULL);
+	if (!t)
+		return -1;
+
+	t->arg = t;
+	t->handler = (void *)fn;
+	t->user = arg;
+	t->sockfd = sockfd;
+	memcpy(&t->u.msg, msg, sizeof(*msg));
+	BufferRef(t->u.msg.buf);
+	return submit_task(pool, hint, t);
+}
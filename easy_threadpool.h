@@ -0,0 +1,95 @@
+/*
+ * 工作窃取线程池: C接口方式
+ * Copyright FreeCode. All Rights Reserved.
+ * MIT License (https://opensource.org/licenses/MIT)
+ * 2024 by liuqingshuige
+ */
+#ifndef __FREE_EASY_THREADPOOL_H__
+#define __FREE_EASY_THREADPOOL_H__
+
+#include "easy_socket.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 线程池标志 */
+#define POOL_PIN_CPU  0x01 /* 工作线程绑定到CPU */
+#define POOL_NUMA     0x02 /* 按NUMA节点分配CPU，优先从同一节点的工作线程窃取任务 */
+
+typedef struct ThreadPool ThreadPool;
+
+/*
+ * 任务函数
+ */
+typedef void (*TaskFunc)(void *arg);
+
+/*
+ * 连接处理函数
+ * sockfd：已接受的连接，由处理函数负责关闭
+ * addr：客户端地址
+ * arg：用户参数
+ */
+typedef void (*SocketHandler)(int sockfd, const struct sockaddr_storage *addr, void *arg);
+
+/*
+ * 数据报处理函数
+ * sockfd：收到数据报的套接字，可用于回复
+ * msg：数据报，msg->buf在处理函数返回后被回收
+ * arg：用户参数
+ */
+typedef void (*DatagramHandler)(int sockfd, struct UdpMsg *msg, void *arg);
+
+/*
+ * 创建线程池，每个工作线程有自己的双端队列，空闲时从其他工作线程窃取任务，提交任务不经过全局锁
+ * nworkers：工作线程数，<=0则取CPU个数
+ * flags：POOL_PIN_CPU/POOL_NUMA组合
+ * return：pool on success，NULL on fail
+ */
+ThreadPool *ThreadPoolCreate(int nworkers, int flags);
+
+/*
+ * 销毁线程池，已提交的任务执行完后工作线程退出
+ */
+void ThreadPoolDestroy(ThreadPool *pool);
+
+/*
+ * 获取工作线程数
+ */
+int ThreadPoolSize(ThreadPool *pool);
+
+/*
+ * 提交任务，在工作线程中提交时放入本线程的队列，否则轮流放入各工作线程的队列
+ * fn：任务函数
+ * arg：用户参数
+ * return：0 on success，-1 on fail
+ */
+int ThreadPoolSubmit(ThreadPool *pool, TaskFunc fn, void *arg);
+
+/*
+ * 提交任务到指定的工作线程，如TcpAcceptor/UdpListenGroup的idx，使同一分片的任务在同一个CPU上执行
+ * hint：工作线程序号，对工作线程数取模
+ * return：0 on success，-1 on fail
+ */
+int ThreadPoolSubmitTo(ThreadPool *pool, int hint, TaskFunc fn, void *arg);
+
+/*
+ * 将已接受的连接交给线程池处理，可在TcpAcceptCallback中调用，需先从事件循环中注销该连接
+ * hint：工作线程序号，<0表示不指定
+ * return：0 on success，-1 on fail（连接未关闭）
+ */
+int ThreadPoolSubmitSocket(ThreadPool *pool, int hint, int sockfd, const struct sockaddr_storage *addr, SocketHandler fn, void *arg);
+
+/*
+ * 将收到的数据报交给线程池处理，可在UdpGroupCallback中调用
+ * msg->buf须来自缓存池(easy_buffer.h)，提交时增加其引用计数，处理完后释放，数据不拷贝
+ * hint：工作线程序号，<0表示不指定
+ * return：0 on success，-1 on fail
+ */
+int ThreadPoolSubmitDatagram(ThreadPool *pool, int hint, int sockfd, const struct UdpMsg *msg, DatagramHandler fn, void *arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
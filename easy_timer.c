@@ -0,0 +1,392 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+#include <sys/timerfd.h>
+
+#include "easy_timer.h"
+
+#define TVR_BITS 8
+#define TVN_BITS 6
+#define TVR_SIZE (1 << TVR_BITS)
+#define TVN_SIZE (1 << TVN_BITS)
+#define TVR_MASK (TVR_SIZE - 1)
+#define TVN_MASK (TVN_SIZE - 1)
+#define TVN_LEVELS 4
+#define MAX_TICKS ((1ULL << (TVR_BITS + TVN_LEVELS * TVN_BITS)) - 1)
+
+struct TimerWheel
+{
+	unsigned int tick_ms;
+	unsigned long long current;  /* 下一个待处理的tick */
+	int count;                   /* 已启动的定时器个数 */
+	Timer tv1[TVR_SIZE];         /* 各槽链表的哨兵 */
+	Timer tvn[TVN_LEVELS][TVN_SIZE];
+	int timerfd;
+	EventLoop *loop;
+	unsigned long long armed;    /* timerfd已设置的到期tick，0表示未设置 */
+};
+
+static void list_init(Timer *head)
+{
+	head->prev = head->next = head;
+}
+
+static void list_add_tail(Timer *head, Timer *t)
+{
+	t->prev = head->prev;
+	t->next = head;
+	head->prev->next = t;
+	head->prev = t;
+}
+
+static void list_del(Timer *t)
+{
+	t->prev->next = t->next;
+	t->next->prev = t->prev;
+	t->prev = t->next = NULL;
+}
+
+/* 将from链表整体移到to，from置空 */
+static void list_splice(Timer *from, Timer *to)
+{
+	list_init(to);
+	if (from->next == from)
+		return;
+
+	to->next = from->next;
+	to->prev = from->prev;
+	to->next->prev = to;
+	to->prev->next = to;
+	list_init(from);
+}
+
+/*
+ * 获取单调时钟当前时间(ms)
+ */
+long long TimerNow(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/*
+ * 按到期tick放入对应层的槽中
+ */
+static void internal_add(TimerWheel *wheel, Timer *t)
+{
+	unsigned long long expires = t->expires;
+	unsigned long long idx;
+	int level;
+
+	if (expires < wheel->current) // 已过期，放入当前槽
+		expires = wheel->current;
+	idx = expires - wheel->current;
+	if (idx > MAX_TICKS)
+	{
+		expires = wheel->current + MAX_TICKS;
+		idx = MAX_TICKS;
+	}
+
+	if (idx < TVR_SIZE)
+	{
+		list_add_tail(&wheel->tv1[expires & TVR_MASK], t);
+		return;
+	}
+
+	for (level=0; level<TVN_LEVELS-1; level++)
+	{
+		if (idx < (1ULL << (TVR_BITS + (level + 1) * TVN_BITS)))
+			break;
+	}
+	list_add_tail(&wheel->tvn[level][(expires >> (TVR_BITS + level * TVN_BITS)) & TVN_MASK], t);
+}
+
+/*
+ * 将上层槽中的定时器重新分配到下层
+ * return：该槽的序号，为0时需要继续处理更上一层
+ */
+static int cascade(TimerWheel *wheel, int level)
+{
+	int index = (wheel->current >> (TVR_BITS + level * TVN_BITS)) & TVN_MASK;
+	Timer head, *t;
+
+	list_splice(&wheel->tvn[level][index], &head);
+	while (head.next != &head)
+	{
+		t = head.next;
+		list_del(t);
+		internal_add(wheel, t);
+	}
+	return index;
+}
+
+static unsigned long long deadline_to_tick(TimerWheel *wheel, long long deadline)
+{
+	if (deadline <= 0)
+		return 0;
+	/* 向上取整，保证不早于到期时间触发 */
+	return ((unsigned long long)deadline + wheel->tick_ms - 1) / wheel->tick_ms;
+}
+
+/*
+ * 按下一个需要推进的时间设置timerfd
+ */
+static void rearm_timerfd(TimerWheel *wheel, long long now)
+{
+	struct itimerspec its;
+	int timeout;
+	long long at;
+
+	if (wheel->timerfd < 0)
+		return;
+
+	memset(&its, 0, sizeof(its));
+	timeout = TimerWheelTimeout(wheel, now);
+	if (timeout >= 0)
+	{
+		at = now + timeout;
+		if (at <= 0)
+			at = 1;
+		its.it_value.tv_sec = at / 1000;
+		its.it_value.tv_nsec = (at % 1000) * 1000000;
+		wheel->armed = deadline_to_tick(wheel, at);
+	}
+	else
+	{
+		wheel->armed = 0;
+	}
+	timerfd_settime(wheel->timerfd, TFD_TIMER_ABSTIME, &its, NULL);
+}
+
+/*
+ * 创建时间轮
+ * return：wheel on success，NULL on fail
+ */
+TimerWheel *TimerWheelCreate(unsigned int tick_ms)
+{
+	TimerWheel *wheel;
+	int i, j;
+
+	wheel = (TimerWheel *)calloc(1, sizeof(*wheel));
+	if (!wheel)
+		return NULL;
+
+	wheel->tick_ms = tick_ms ? tick_ms : 1;
+	wheel->current = TimerNow() / wheel->tick_ms;
+	wheel->timerfd = -1;
+
+	for (i=0; i<TVR_SIZE; i++)
+		list_init(&wheel->tv1[i]);
+	for (i=0; i<TVN_LEVELS; i++)
+	{
+		for (j=0; j<TVN_SIZE; j++)
+			list_init(&wheel->tvn[i][j]);
+	}
+	return wheel;
+}
+
+/*
+ * 销毁时间轮
+ */
+void TimerWheelDestroy(TimerWheel *wheel)
+{
+	if (!wheel)
+		return;
+
+	if (wheel->timerfd >= 0)
+	{
+		if (wheel->loop)
+			EventLoopDel(wheel->loop, wheel->timerfd);
+		close(wheel->timerfd);
+	}
+	free(wheel);
+}
+
+/*
+ * 初始化定时器
+ */
+void TimerInit(Timer *timer, TimerCallback cb, void *arg)
+{
+	timer->prev = timer->next = NULL;
+	timer->expires = 0;
+	timer->cb = cb;
+	timer->arg = arg;
+}
+
+/*
+ * 启动定时器
+ * return：0 on success，-1 on fail
+ */
+int TimerStart(TimerWheel *wheel, Timer *timer, long long deadline)
+{
+	unsigned long long expires;
+
+	if (!wheel || !timer)
+	{
+		errno = EINVAL;
+		return -1;
+	}
+
+	expires = deadline_to_tick(wheel, deadline);
+	if (timer->next)
+	{
+		if (timer->expires == expires)
+			return 0;
+		list_del(timer);
+		wheel->count--;
+	}
+
+	timer->expires = expires;
+	internal_add(wheel, timer);
+	wheel->count++;
+
+	if (wheel->timerfd >= 0 && (wheel->armed == 0 || expires < wheel->armed))
+		rearm_timerfd(wheel, TimerNow());
+	return 0;
+}
+
+/*
+ * 停止定时器
+ */
+void TimerStop(TimerWheel *wheel, Timer *timer)
+{
+	if (!timer || !timer->next)
+		return;
+
+	list_del(timer);
+	wheel->count--;
+}
+
+/*
+ * 判断定时器是否已启动且未到期
+ */
+int TimerPending(const Timer *timer)
+{
+	return timer->next != NULL;
+}
+
+/*
+ * 推进时间轮并执行所有到期的定时器回调
+ * return：触发的定时器个数
+ */
+int TimerWheelAdvance(TimerWheel *wheel, long long now)
+{
+	unsigned long long target;
+	Timer head, *t;
+	int index, level, fired = 0;
+
+	if (now < 0)
+		return 0;
+	target = (unsigned long long)now / wheel->tick_ms;
+
+	while (wheel->current <= target)
+	{
+		/* 没有定时器时直接跳到目标时间，避免长时间空闲后逐tick推进 */
+		if (wheel->count == 0)
+		{
+			wheel->current = target + 1;
+			break;
+		}
+
+		index = wheel->current & TVR_MASK;
+		for (level=0; index == 0 && level<TVN_LEVELS; level++)
+			index = cascade(wheel, level);
+		index = wheel->current & TVR_MASK;
+		wheel->current++;
+
+		/* 先摘到本地链表，回调中停止其他到期定时器也是安全的 */
+		list_splice(&wheel->tv1[index], &head);
+		while (head.next != &head)
+		{
+			t = head.next;
+			list_del(t);
+			wheel->count--;
+			fired++;
+			if (t->cb)
+				t->cb(wheel, t, t->arg);
+		}
+	}
+
+	if (wheel->timerfd >= 0)
+		rearm_timerfd(wheel, now);
+	return fired;
+}
+
+/*
+ * 获取距下一次需要推进时间轮的时间
+ * return：等待时间(ms)，-1 表示没有定时器
+ */
+int TimerWheelTimeout(TimerWheel *wheel, long long now)
+{
+	unsigned long long tick;
+	long long at;
+	int i, index;
+
+	if (wheel->count == 0)
+		return -1;
+
+	/* 在第一层找最近的非空槽，找不到则到下一次分层重分配时再检查；
+	 * 当前tick正好需要重分配时，上层的定时器还未落到第一层，须立即推进 */
+	index = wheel->current & TVR_MASK;
+	i = index;
+	if (index != 0)
+	{
+		for (; i<TVR_SIZE; i++)
+		{
+			if (wheel->tv1[i].next != &wheel->tv1[i])
+				break;
+		}
+	}
+	tick = wheel->current + (i - index);
+
+	at = (long long)(tick * wheel->tick_ms);
+	if (at <= now)
+		return 0;
+	return (at - now > 0x7fffffff) ? 0x7fffffff : (int)(at - now);
+}
+
+/*
+ * timerfd可读：推进时间轮
+ */
+static void on_timerfd(EventLoop *loop, int fd, int events, void *arg)
+{
+	TimerWheel *wheel = (TimerWheel *)arg;
+	unsigned long long expirations;
+
+	while (read(fd, &expirations, sizeof(expirations)) > 0)
+		;
+	TimerWheelAdvance(wheel, TimerNow());
+}
+
+/*
+ * 将时间轮挂到事件循环上
+ * return：0 on success，-1 on fail
+ */
+int TimerWheelAttach(TimerWheel *wheel, EventLoop *loop)
+{
+	if (!wheel || !loop || wheel->timerfd >= 0)
+	{
+		errno = EINVAL;
+		return -1;
+	}
+
+	wheel->timerfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	if (wheel->timerfd < 0)
+		return -1;
+
+	if (EventLoopAdd(loop, wheel->timerfd, EV_READ, on_timerfd, NULL, wheel) < 0)
+	{
+		close(wheel->timerfd);
+		wheel->timerfd = -1;
+		return -1;
+	}
+
+	wheel->loop = loop;
+	rearm_timerfd(wheel, TimerNow());
+	return 0;
+}
@@ -0,0 +1,107 @@
+/*
+ * 分层时间轮定时器: C接口方式
+ * Copyright FreeCode. All Rights Reserved.
+ * MIT License (https://opensource.org/licenses/MIT)
+ * 2024 by liuqingshuige
+ */
+#ifndef __FREE_EASY_TIMER_H__
+#define __FREE_EASY_TIMER_H__
+
+#include "easy_event.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct TimerWheel TimerWheel;
+typedef struct Timer Timer;
+
+/*
+ * 定时器到期回调，回调中可重新启动或停止任意定时器
+ * wheel：所属时间轮
+ * timer：到期的定时器，已处于停止状态
+ * arg：用户参数
+ */
+typedef void (*TimerCallback)(TimerWheel *wheel, Timer *timer, void *arg);
+
+/*
+ * 定时器，由使用者分配（通常嵌入连接结构体中），TimerInit后使用，成员不应直接修改
+ */
+struct Timer
+{
+	struct Timer *prev;
+	struct Timer *next;
+	unsigned long long expires; /* 到期tick */
+	TimerCallback cb;
+	void *arg;
+};
+
+/*
+ * 获取单调时钟当前时间(ms)，作为定时器绝对到期时间的基准
+ */
+long long TimerNow(void);
+
+/*
+ * 创建时间轮，5层（256+64*4槽），启动、停止均为O(1)，最长定时约50天*tick_ms
+ * 时间轮不加锁，只能在一个线程中使用
+ * tick_ms：精度(ms)，为0则取1ms；定时器不会早于到期时间触发，最多晚一个tick
+ * return：wheel on success，NULL on fail
+ */
+TimerWheel *TimerWheelCreate(unsigned int tick_ms);
+
+/*
+ * 销毁时间轮，未到期的定时器被丢弃，不触发回调
+ */
+void TimerWheelDestroy(TimerWheel *wheel);
+
+/*
+ * 初始化定时器
+ * cb：到期回调
+ * arg：用户参数
+ */
+void TimerInit(Timer *timer, TimerCallback cb, void *arg);
+
+/*
+ * 启动定时器，定时器已启动时改为新的到期时间（重新设置读写、空闲、连接超时）
+ * deadline：绝对到期时间(ms)，以TimerNow为基准，已过期的定时器在下一次推进时触发
+ * return：0 on success，-1 on fail
+ */
+int TimerStart(TimerWheel *wheel, Timer *timer, long long deadline);
+
+/*
+ * 停止定时器，未启动时无操作
+ */
+void TimerStop(TimerWheel *wheel, Timer *timer);
+
+/*
+ * 判断定时器是否已启动且未到期
+ * return：1 已启动，0 未启动
+ */
+int TimerPending(const Timer *timer);
+
+/*
+ * 推进时间轮并执行所有到期的定时器回调，不使用事件循环时在自己的循环中调用
+ * now：当前时间(ms)，通常为TimerNow()
+ * return：触发的定时器个数
+ */
+int TimerWheelAdvance(TimerWheel *wheel, long long now);
+
+/*
+ * 获取距下一次需要推进时间轮的时间，可作为poll/epoll_wait的超时参数
+ * now：当前时间(ms)
+ * return：等待时间(ms)，-1 表示没有定时器
+ */
+int TimerWheelTimeout(TimerWheel *wheel, long long now);
+
+/*
+ * 将时间轮挂到事件循环上，由timerfd驱动，到期时在事件循环线程中执行回调
+ * 挂载后只能在事件循环线程中启动、停止定时器
+ * return：0 on success，-1 on fail
+ */
+int TimerWheelAttach(TimerWheel *wheel, EventLoop *loop);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
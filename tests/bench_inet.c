@@ -0,0 +1,121 @@
+/*
+ * inet_ntop2/inet_pton2与glibc inet_ntop/inet_pton的性能对比，单位ns/次
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include "easy_socket.h"
+
+#define NADDRS 1024
+#define ROUNDS 2000
+
+static unsigned char g_addr4[NADDRS][4];
+static unsigned char g_addr6[NADDRS][16];
+static char g_str4[NADDRS][INET_ADDRSTRLEN];
+static char g_str6[NADDRS][INET6_ADDRSTRLEN];
+static volatile unsigned int g_sink; // 防止结果被优化掉
+
+static long long monotonic_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/*
+ * 生成接近真实流量的地址：IPv4随机，IPv6一半为带0段的全局地址，一部分为映射地址
+ */
+static void init_addrs(void)
+{
+	int i, k;
+
+	srand(1);
+	for (i=0; i<NADDRS; i++)
+	{
+		for (k=0; k<4; k++)
+			g_addr4[i][k] = (unsigned char)rand();
+		for (k=0; k<16; k++)
+			g_addr6[i][k] = (unsigned char)rand();
+
+		if (i % 4 == 1)
+			memset(g_addr6[i] + 4, 0, 8); // 2001:db8::x:y
+		else if (i % 4 == 2)
+		{
+			memset(g_addr6[i], 0, 10); // ::ffff:a.b.c.d
+			g_addr6[i][10] = g_addr6[i][11] = 0xff;
+		}
+
+		inet_ntop(AF_INET, g_addr4[i], g_str4[i], sizeof(g_str4[i]));
+		inet_ntop(AF_INET6, g_addr6[i], g_str6[i], sizeof(g_str6[i]));
+	}
+}
+
+typedef const char *(*NtopFunc)(int family, const void *src, char *dest, socklen_t size);
+typedef int (*PtonFunc)(int family, const char *src, void *dst);
+
+static const char *easy_ntop(int family, const void *src, char *dest, socklen_t size)
+{
+	return inet_ntop2(family, src, dest, size);
+}
+
+static double bench_ntop(NtopFunc fn, int family)
+{
+	char buf[INET6_ADDRSTRLEN];
+	long long start = monotonic_ns();
+	int r, i;
+
+	for (r=0; r<ROUNDS; r++)
+	{
+		for (i=0; i<NADDRS; i++)
+		{
+			fn(family, (family == AF_INET) ? (const void *)g_addr4[i] : (const void *)g_addr6[i], buf, sizeof(buf));
+			g_sink += (unsigned char)buf[1];
+		}
+	}
+	return (double)(monotonic_ns() - start) / ((double)ROUNDS * NADDRS);
+}
+
+static double bench_pton(PtonFunc fn, int family)
+{
+	unsigned char buf[16];
+	long long start = monotonic_ns();
+	int r, i;
+
+	for (r=0; r<ROUNDS; r++)
+	{
+		for (i=0; i<NADDRS; i++)
+		{
+			fn(family, (family == AF_INET) ? g_str4[i] : g_str6[i], buf);
+			g_sink += buf[3];
+		}
+	}
+	return (double)(monotonic_ns() - start) / ((double)ROUNDS * NADDRS);
+}
+
+int main(void)
+{
+	double a, b;
+
+	init_addrs();
+	printf("%-10s %10s %10s %8s\n", "", "glibc", "easy", "speedup");
+
+	a = bench_ntop(inet_ntop, AF_INET);
+	b = bench_ntop(easy_ntop, AF_INET);
+	printf("%-10s %8.1fns %8.1fns %7.1fx\n", "ntop4", a, b, a / b);
+
+	a = bench_ntop(inet_ntop, AF_INET6);
+	b = bench_ntop(easy_ntop, AF_INET6);
+	printf("%-10s %8.1fns %8.1fns %7.1fx\n", "ntop6", a, b, a / b);
+
+	a = bench_pton(inet_pton, AF_INET);
+	b = bench_pton(inet_pton2, AF_INET);
+	printf("%-10s %8.1fns %8.1fns %7.1fx\n", "pton4", a, b, a / b);
+
+	a = bench_pton(inet_pton, AF_INET6);
+	b = bench_pton(inet_pton2, AF_INET6);
+	printf("%-10s %8.1fns %8.1fns %7.1fx\n", "pton6", a, b, a / b);
+	return 0;
+}
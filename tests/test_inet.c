@@ -0,0 +1,305 @@
+/*
+ * inet_ntop2/inet_ntop3/inet_pton2与glibc inet_ntop/inet_pton的等价性测试
+ * 默认扫描2^24个IPv4地址，./tests/test_inet full扫描全部2^32个
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include "easy_socket.h"
+
+static int g_fails;
+
+#define FAIL(fmt, ...) do { if (g_fails++ < 20) printf("FAIL %s: " fmt "\n", __FUNCTION__, ##__VA_ARGS__); } while (0)
+
+/* 每段IPv6地址的取值，覆盖1~4个16进制位的边界 */
+static const unsigned int g_words[] = { 0x1, 0x9, 0xa, 0xf, 0x10, 0xff, 0x100, 0xabc, 0xfff, 0x1000, 0xffff };
+#define NWORDS (sizeof(g_words) / sizeof(g_words[0]))
+
+static unsigned int g_rand = 12345;
+
+static unsigned int next_rand(void)
+{
+	g_rand = g_rand * 1103515245 + 12345;
+	return g_rand >> 8;
+}
+
+static void check_ntop(int family, const void *src)
+{
+	char a[INET6_ADDRSTRLEN], b[INET6_ADDRSTRLEN];
+	const char *ra, *rb;
+	size_t len;
+
+	ra = inet_ntop(family, src, a, sizeof(a));
+	rb = inet_ntop2(family, src, b, sizeof(b));
+	if (!ra || !rb || strcmp(a, b))
+	{
+		FAIL("glibc \"%s\" easy \"%s\"", ra ? a : "(null)", rb ? b : "(null)");
+		return;
+	}
+
+	/* 缓冲区恰好够用时成功，少一个字节时失败 */
+	len = strlen(a);
+	if (!inet_ntop2(family, src, b, len + 1) || strcmp(a, b))
+		FAIL("\"%s\" size %zu", a, len + 1);
+	if (inet_ntop2(family, src, b, len))
+		FAIL("\"%s\" size %zu should fail", a, len);
+}
+
+static void check_pton(int family, const char *src)
+{
+	unsigned char a[16], b[16];
+	int ra, rb, n = (family == AF_INET) ? 4 : 16;
+
+	memset(a, 0xa5, sizeof(a));
+	memset(b, 0xa5, sizeof(b));
+	ra = inet_pton(family, src, a);
+	rb = inet_pton2(family, src, b);
+	if (ra != rb || (ra == 1 && memcmp(a, b, n)))
+		FAIL("\"%s\" glibc %d easy %d", src, ra, rb);
+}
+
+/*
+ * IPv4格式化：逐个比较，并验证解析结果能还原地址
+ */
+static void test_ntop4(int full)
+{
+	unsigned long long i, count = full ? (1ULL << 32) : (1ULL << 24);
+	unsigned int x, y;
+	char buf[INET_ADDRSTRLEN];
+
+	for (i=0; i<count; i++)
+	{
+		/* 非full时高8位随低24位变化，覆盖每段的全部256个值 */
+		x = full ? (unsigned int)i : (unsigned int)i | (((unsigned int)i * 167) & 0xff) << 24;
+		check_ntop(AF_INET, &x);
+
+		inet_ntop2(AF_INET, &x, buf, sizeof(buf));
+		if (inet_pton2(AF_INET, buf, &y) != 1 || x != y)
+			FAIL("round trip \"%s\"", buf);
+	}
+	printf("ntop4: %llu addresses\n", count);
+}
+
+/*
+ * IPv4解析：枚举由数字和.组成的所有短字符串，再加上随机的长字符串
+ */
+static void test_pton4(void)
+{
+	static const char alphabet[] = "0129.";
+	const int k = sizeof(alphabet) - 1;
+	char str[32];
+	int len, i, j, idx[16], total = 0;
+
+	for (len=0; len<=9; len++)
+	{
+		memset(idx, 0, sizeof(idx));
+		for (;;)
+		{
+			for (i=0; i<len; i++)
+				str[i] = alphabet[idx[i]];
+			str[len] = '\0';
+			check_pton(AF_INET, str);
+			total++;
+
+			for (i=0; i<len && ++idx[i] == k; i++)
+				idx[i] = 0;
+			if (i == len)
+				break;
+		}
+	}
+
+	/* 随机字符串，包含越界值、多余的段和非法字符 */
+	for (i=0; i<1000000; i++)
+	{
+		static const char chars[] = "0123456789...x -+:";
+		len = 1 + next_rand() % 18;
+		for (j=0; j<len; j++)
+			str[j] = chars[next_rand() % (sizeof(chars) - 1)];
+		str[len] = '\0';
+		check_pton(AF_INET, str);
+		total++;
+	}
+	printf("pton4: %d strings\n", total);
+}
+
+static void set_words(unsigned char *addr, const unsigned int *w)
+{
+	int i;
+
+	for (i=0; i<8; i++)
+	{
+		addr[2*i] = (unsigned char)(w[i] >> 8);
+		addr[2*i+1] = (unsigned char)w[i];
+	}
+}
+
+/*
+ * 按addr生成多种等价写法并解析
+ */
+static void check_pton6_forms(const unsigned char *addr)
+{
+	char str[128], *p;
+	unsigned int w;
+	int i;
+
+	inet_ntop(AF_INET6, addr, str, sizeof(str));
+	check_pton(AF_INET6, str);
+
+	/* 不压缩、前导0、大写 */
+	p = str;
+	for (i=0; i<8; i++)
+	{
+		w = (addr[2*i] << 8) | addr[2*i+1];
+		p += sprintf(p, (i & 1) ? "%04X%s" : "%x%s", w, (i < 7) ? ":" : "");
+	}
+	check_pton(AF_INET6, str);
+
+	/* 结尾为点分十进制 */
+	p = str;
+	for (i=0; i<6; i++)
+		p += sprintf(p, "%x:", (addr[2*i] << 8) | addr[2*i+1]);
+	sprintf(p, "%u.%u.%u.%u", addr[12], addr[13], addr[14], addr[15]);
+	check_pton(AF_INET6, str);
+}
+
+/*
+ * IPv6格式化：枚举全部256种0段分布，非0段依次取各边界值，并覆盖兼容/映射IPv4地址
+ */
+static void test_ntop6(void)
+{
+	unsigned char addr[16];
+	unsigned int w[8];
+	int mask, v, i, total = 0;
+
+	for (mask=0; mask<256; mask++)
+	{
+		for (v=0; v<(int)NWORDS * 4; v++)
+		{
+			for (i=0; i<8; i++)
+			{
+				if (mask & (1 << i))
+					w[i] = 0;
+				else if (v < (int)NWORDS)
+					w[i] = g_words[v];
+				else
+					w[i] = g_words[next_rand() % NWORDS];
+			}
+			set_words(addr, w);
+			check_ntop(AF_INET6, addr);
+			check_pton6_forms(addr);
+			total++;
+		}
+	}
+
+	/* ::a.b.c.d、::ffff:a.b.c.d及相邻的非IPv4格式 */
+	for (v=0; v<65536; v++)
+	{
+		memset(w, 0, sizeof(w));
+		w[4] = (v & 0x100) ? 1 : 0;
+		w[5] = (v & 0x200) ? 0xffff : ((v & 0x400) ? 0xfffe : 0);
+		w[6] = (v & 0x800) ? 0 : (v & 0xff) << 8;
+		w[7] = (v & 0x1000) ? 0 : (v & 0xff) | ((v >> 13) & 7);
+		set_words(addr, w);
+		check_ntop(AF_INET6, addr);
+		check_pton6_forms(addr);
+		total++;
+	}
+
+	for (v=0; v<1000000; v++)
+	{
+		for (i=0; i<16; i++)
+			addr[i] = (unsigned char)next_rand();
+		check_ntop(AF_INET6, addr);
+		total++;
+	}
+	printf("ntop6: %d addresses\n", total);
+}
+
+/*
+ * IPv6解析：枚举短字符串，再加上随机字符串
+ */
+static void test_pton6(void)
+{
+	static const char alphabet[] = "0f:.G";
+	const int k = sizeof(alphabet) - 1;
+	char str[64];
+	int len, i, j, idx[16], total = 0;
+
+	for (len=0; len<=9; len++)
+	{
+		memset(idx, 0, sizeof(idx));
+		for (;;)
+		{
+			for (i=0; i<len; i++)
+				str[i] = alphabet[idx[i]];
+			str[len] = '\0';
+			check_pton(AF_INET6, str);
+			total++;
+
+			for (i=0; i<len && ++idx[i] == k; i++)
+				idx[i] = 0;
+			if (i == len)
+				break;
+		}
+	}
+
+	for (i=0; i<1000000; i++)
+	{
+		static const char chars[] = "0123456789abcdefABCDEF::::...g";
+		len = 1 + next_rand() % 45;
+		for (j=0; j<len; j++)
+			str[j] = chars[next_rand() % (sizeof(chars) - 1)];
+		str[len] = '\0';
+		check_pton(AF_INET6, str);
+		total++;
+	}
+	printf("pton6: %d strings\n", total);
+}
+
+static void test_misc(void)
+{
+	struct sockaddr_in sin;
+	struct sockaddr_in6 sin6;
+	char buf[INET6_ADDRSTRLEN];
+	unsigned char addr[16];
+
+	memset(&sin, 0, sizeof(sin));
+	sin.sin_family = AF_INET;
+	sin.sin_addr.s_addr = htonl(0xc0a80101);
+	if (!inet_ntop3((struct sockaddr *)&sin, buf, sizeof(buf)) || strcmp(buf, "192.168.1.1"))
+		FAIL("inet_ntop3 AF_INET");
+
+	memset(&sin6, 0, sizeof(sin6));
+	sin6.sin6_family = AF_INET6;
+	sin6.sin6_addr.s6_addr[15] = 1;
+	if (!inet_ntop3((struct sockaddr *)&sin6, buf, sizeof(buf)) || strcmp(buf, "::1"))
+		FAIL("inet_ntop3 AF_INET6");
+
+	if (inet_ntop2(AF_UNIX, addr, buf, sizeof(buf)))
+		FAIL("inet_ntop2 AF_UNIX");
+	errno = 0;
+	if (inet_pton2(AF_UNIX, "1.2.3.4", addr) != -1 || errno != EAFNOSUPPORT)
+		FAIL("inet_pton2 AF_UNIX");
+}
+
+int main(int argc, char *argv[])
+{
+	int full = (argc > 1 && !strcmp(argv[1], "full"));
+
+	test_misc();
+	test_ntop4(full);
+	test_pton4();
+	test_ntop6();
+	test_pton6();
+
+	if (g_fails)
+	{
+		printf("test_inet: %d failures\n", g_fails);
+		return 1;
+	}
+	printf("test_inet: ok\n");
+	return 0;
+}
@@ -0,0 +1,326 @@
+/*
+ * 网卡缓存测试：在独立的网络命名空间中用veth网卡验证增量更新、变化通知、扩容和溢出后的全量同步
+ * 需要root权限(unshare)和ip命令，不满足时跳过
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <sched.h>
+#include <pthread.h>
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include "easy_netif.h"
+
+static int g_fails;
+
+#define FAIL(fmt, ...) do { g_fails++; printf("FAIL %s: " fmt "\n", __FUNCTION__, ##__VA_ARGS__); } while (0)
+
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static int g_events[5];          /* 以NETIF_XXX为下标的事件计数 */
+static int g_block_ms;           /* 回调中阻塞的时间，用于制造通知溢出 */
+static volatile int g_stop;
+static volatile int g_read_fails;
+static int g_self_id = -1;       /* 在回调中取消自身订阅的订阅号 */
+static volatile int g_self_entered;
+
+static void on_change(int event, const struct NetifInfo *info, const struct NetifAddr *addr, void *arg)
+{
+	if (g_block_ms)
+	{
+		usleep(g_block_ms * 1000);
+		g_block_ms = 0;
+	}
+
+	pthread_mutex_lock(&g_lock);
+	if (event > 0 && event < 5)
+		g_events[event]++;
+	pthread_mutex_unlock(&g_lock);
+}
+
+static int events(int event)
+{
+	int n;
+
+	pthread_mutex_lock(&g_lock);
+	n = g_events[event];
+	pthread_mutex_unlock(&g_lock);
+	return n;
+}
+
+static void reset_events(void)
+{
+	pthread_mutex_lock(&g_lock);
+	memset(g_events, 0, sizeof(g_events));
+	pthread_mutex_unlock(&g_lock);
+}
+
+/*
+ * 执行一组ip命令，每行一条
+ */
+static int ip_batch(const char *cmds)
+{
+	char path[] = "/tmp/test_netif_XXXXXX";
+	char cmd[64];
+	int fd, ret;
+
+	fd = mkstemp(path);
+	if (fd < 0)
+		return -1;
+	ret = (write(fd, cmds, strlen(cmds)) == (ssize_t)strlen(cmds)) ? 0 : -1;
+	close(fd);
+
+	snprintf(cmd, sizeof(cmd), "ip -batch %s", path);
+	if (ret == 0)
+		ret = system(cmd);
+	unlink(path);
+	return ret;
+}
+
+/*
+ * 缓存与内核的网卡列表（if_nameindex）一致
+ */
+static int cache_matches_kernel(void)
+{
+	static struct NetifInfo info[1024];
+	struct if_nameindex *ni = if_nameindex();
+	int i, k, n, kernel = 0, ok = 1;
+
+	if (!ni)
+		return 0;
+
+	n = NetifList(info, 1024);
+	for (k=0; ni[k].if_index; k++)
+	{
+		kernel++;
+		for (i=0; i<n && i<1024; i++)
+		{
+			if (info[i].index == (int)ni[k].if_index && !strcmp(info[i].name, ni[k].if_name))
+				break;
+		}
+		if (i == n || i == 1024)
+			ok = 0;
+	}
+	if_freenameindex(ni);
+	return ok && n == kernel;
+}
+
+/*
+ * 等待条件成立，最多timeout_ms
+ */
+#define WAIT_FOR(cond, timeout_ms) ({ \
+	int __ms = 0; \
+	while (!(cond) && __ms < (timeout_ms)) { usleep(10000); __ms += 10; } \
+	(cond); })
+
+static void *reader_thread(void *arg)
+{
+	while (!g_stop)
+	{
+		if (NetifNameToIndex("lo") == 0)
+			g_read_fails++;
+	}
+	return NULL;
+}
+
+/*
+ * 单个网卡：新增、地址、MAC、删除
+ */
+static void test_link(void)
+{
+	struct NetifInfo info;
+	struct ifreq ifr;
+	unsigned char addr[4], want[4];
+	int sockfd;
+
+	reset_events();
+	if (ip_batch("link add ta0 type veth peer name tb0\n"
+				 "addr add 10.1.2.3/24 dev ta0\n"
+				 "link set ta0 up\n") != 0)
+	{
+		FAIL("ip link add");
+		return;
+	}
+
+	inet_pton(AF_INET, "10.1.2.3", want);
+	if (!WAIT_FOR(NetifGetAddr("ta0", AF_INET, addr) == 0 && !memcmp(addr, want, 4), 2000))
+		FAIL("address of ta0 not cached");
+
+	if (NetifGetByName("ta0", &info) < 0)
+	{
+		FAIL("ta0 not cached");
+		return;
+	}
+	if (info.index != (int)if_nametoindex("ta0"))
+		FAIL("index %d, kernel %u", info.index, if_nametoindex("ta0"));
+	if (NetifNameToIndex("tb0") != if_nametoindex("tb0"))
+		FAIL("index of tb0");
+
+	sockfd = socket(AF_INET, SOCK_DGRAM, 0);
+	memset(&ifr, 0, sizeof(ifr));
+	strcpy(ifr.ifr_name, "ta0");
+	if (ioctl(sockfd, SIOCGIFHWADDR, &ifr) < 0 || memcmp(info.mac, ifr.ifr_hwaddr.sa_data, 6))
+		FAIL("mac of ta0");
+	close(sockfd);
+
+	if (events(NETIF_LINK_NEW) < 2 || events(NETIF_ADDR_NEW) < 1)
+		FAIL("events: link new %d, addr new %d", events(NETIF_LINK_NEW), events(NETIF_ADDR_NEW));
+
+	ip_batch("addr del 10.1.2.3/24 dev ta0\n");
+	if (!WAIT_FOR(NetifGetAddr("ta0", AF_INET, addr) < 0, 2000) || events(NETIF_ADDR_DEL) < 1)
+		FAIL("address of ta0 not removed");
+
+	/* 删除veth的一端时另一端也被删除 */
+	ip_batch("link del ta0\n");
+	if (!WAIT_FOR(NetifGetByName("ta0", NULL) < 0 && NetifGetByName("tb0", NULL) < 0, 2000))
+		FAIL("ta0/tb0 not removed");
+	if (!WAIT_FOR(events(NETIF_LINK_DEL) == 2, 2000))
+		FAIL("link del events %d", events(NETIF_LINK_DEL));
+}
+
+/*
+ * 网卡数超过初始容量NETIF_MAX时缓存扩容
+ */
+static void test_grow(void)
+{
+	char *cmds = (char *)malloc(128 * 64);
+	char *p = cmds;
+	int i, pairs = NETIF_MAX;
+
+	for (i=0; i<pairs; i++)
+		p += sprintf(p, "link add ga%d type veth peer name gb%d\n", i, i);
+	ip_batch(cmds);
+
+	if (!WAIT_FOR(cache_matches_kernel(), 5000))
+		FAIL("cache does not match kernel with %d links", NetifList(NULL, 0));
+	if (NetifList(NULL, 0) < 2 * pairs)
+		FAIL("only %d links cached", NetifList(NULL, 0));
+
+	p = cmds;
+	for (i=0; i<pairs; i++)
+		p += sprintf(p, "link del ga%d\n", i);
+	ip_batch(cmds);
+
+	if (!WAIT_FOR(cache_matches_kernel(), 5000))
+		FAIL("cache does not match kernel after delete");
+	free(cmds);
+}
+
+/*
+ * 回调阻塞导致通知溢出(ENOBUFS)后，全量同步与内核一致，且删除的网卡都有LINK_DEL通知
+ */
+static void test_overflow(void)
+{
+	char *cmds = (char *)malloc(20 * 16 * 96);
+	char *p = cmds;
+	int i, c, pairs = 16;
+
+	for (c=0; c<20; c++)
+	{
+		for (i=0; i<pairs; i++)
+			p += sprintf(p, "link add oa%d type veth peer name ob%d\nlink del oa%d\n", i, i, i);
+	}
+	for (i=0; i<pairs; i++)
+		p += sprintf(p, "link add oa%d type veth peer name ob%d\n", i, i);
+
+	g_block_ms = 2000;
+	ip_batch(cmds);
+
+	if (!WAIT_FOR(cache_matches_kernel(), 10000))
+		FAIL("cache does not match kernel after churn");
+
+	reset_events();
+	p = cmds;
+	for (i=0; i<pairs; i++)
+		p += sprintf(p, "link del oa%d\n", i);
+	ip_batch(cmds);
+
+	if (!WAIT_FOR(cache_matches_kernel() && events(NETIF_LINK_DEL) == 2 * pairs, 5000))
+		FAIL("link del events %d, want %d", events(NETIF_LINK_DEL), 2 * pairs);
+	free(cmds);
+}
+
+/*
+ * 回调执行期间停止缓存，回调中取消自身订阅
+ */
+static void on_change_unsubscribe(int event, const struct NetifInfo *info, const struct NetifAddr *addr, void *arg)
+{
+	if (g_self_id < 0)
+		return;
+
+	g_self_entered = 1;
+	usleep(300 * 1000); // 等待NetifCacheStop开始
+	NetifUnsubscribe(g_self_id);
+	g_self_id = -1;
+}
+
+static void test_unsubscribe_during_stop(void)
+{
+	g_self_id = NetifSubscribe(on_change_unsubscribe, NULL);
+	ip_batch("link add ua0 type veth peer name ub0\n");
+	if (!WAIT_FOR(g_self_entered, 2000))
+	{
+		FAIL("callback not called");
+		return;
+	}
+
+	/* 死锁时由SIGALRM结束进程 */
+	alarm(10);
+	NetifCacheStop();
+	alarm(0);
+	if (g_self_id >= 0)
+		FAIL("callback did not unsubscribe");
+}
+
+int main(void)
+{
+	pthread_t tid;
+	int id;
+
+	if (unshare(CLONE_NEWNET) < 0)
+	{
+		printf("test_netif: skipped, unshare: %s\n", strerror(errno));
+		return 0;
+	}
+	if (system("ip link set lo up") != 0)
+	{
+		printf("test_netif: skipped, ip command not available\n");
+		return 0;
+	}
+
+	if (NetifCacheStart() < 0)
+	{
+		printf("FAIL NetifCacheStart: %s\n", strerror(errno));
+		return 1;
+	}
+	id = NetifSubscribe(on_change, NULL);
+	pthread_create(&tid, NULL, reader_thread, NULL);
+
+	if (!cache_matches_kernel())
+		FAIL("initial dump");
+	test_link();
+	test_grow();
+	test_overflow();
+
+	g_stop = 1;
+	pthread_join(tid, NULL);
+	if (g_read_fails)
+		FAIL("lock-free reader missed lo %d times", g_read_fails);
+
+	NetifUnsubscribe(id);
+	test_unsubscribe_during_stop();
+	if (NetifCacheRunning() || NetifGetByName("lo", NULL) == 0)
+		FAIL("cache still running after stop");
+
+	if (g_fails)
+	{
+		printf("test_netif: %d failures\n", g_fails);
+		return 1;
+	}
+	printf("test_netif: ok\n");
+	return 0;
+}
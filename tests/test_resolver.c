@@ -0,0 +1,352 @@
+/*
+ * 解析缓存测试：使用/etc/hosts中的localhost，不依赖外部DNS
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <pthread.h>
+#include <netdb.h>
+#include <arpa/inet.h>
+#include <dlfcn.h>
+#include <sys/eventfd.h>
+#include "easy_socket.h"
+#include "easy_resolver.h"
+#include "easy_timer.h"
+
+static int g_fails;
+
+#define FAIL(fmt, ...) do { g_fails++; printf("FAIL %s: " fmt "\n", __FUNCTION__, ##__VA_ARGS__); } while (0)
+
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_cond = PTHREAD_COND_INITIALIZER;
+static int g_done;
+static int g_count;
+static int g_gai_calls;          /* getaddrinfo调用次数 */
+static int g_gai_delay_ms;       /* getaddrinfo额外耗时，模拟慢速DNS */
+
+/*
+ * 替换libc的getaddrinfo，统计调用次数
+ */
+int getaddrinfo(const char *node, const char *service, const struct addrinfo *hints, struct addrinfo **res)
+{
+	static int (*real)(const char *, const char *, const struct addrinfo *, struct addrinfo **);
+
+	if (!real)
+		real = (int (*)(const char *, const char *, const struct addrinfo *, struct addrinfo **))dlsym(RTLD_NEXT, "getaddrinfo");
+
+	__atomic_add_fetch(&g_gai_calls, 1, __ATOMIC_RELAXED);
+	if (g_gai_delay_ms)
+		usleep(g_gai_delay_ms * 1000);
+	return real(node, service, hints, res);
+}
+
+/*
+ * 结果中包含127.0.0.1:port
+ */
+static int has_loopback(const struct sockaddr_storage *addr, int count, int port)
+{
+	const struct sockaddr_in *sin;
+	int i;
+
+	for (i=0; i<count; i++)
+	{
+		sin = (const struct sockaddr_in *)&addr[i];
+		if (sin->sin_family == AF_INET && sin->sin_addr.s_addr == htonl(INADDR_LOOPBACK) && ntohs(sin->sin_port) == port)
+			return 1;
+	}
+	return 0;
+}
+
+static void on_resolved(const char *host, const char *service, const struct sockaddr_storage *addr, int count, void *arg)
+{
+	if (count > 0 && !has_loopback(addr, count, atoi(service)))
+		count = -2;
+
+	pthread_mutex_lock(&g_lock);
+	g_count = count;
+	g_done = 1;
+	pthread_cond_signal(&g_cond);
+	pthread_mutex_unlock(&g_lock);
+}
+
+/*
+ * 等待异步回调
+ * return：回调返回的地址个数，超时返回-3
+ */
+static int wait_callback(int timeout_ms)
+{
+	struct timespec ts;
+	int ret = 0;
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	ts.tv_sec += timeout_ms / 1000;
+	ts.tv_nsec += (timeout_ms % 1000) * 1000000;
+	if (ts.tv_nsec >= 1000000000)
+	{
+		ts.tv_sec++;
+		ts.tv_nsec -= 1000000000;
+	}
+
+	pthread_mutex_lock(&g_lock);
+	while (!g_done && ret == 0)
+		ret = pthread_cond_timedwait(&g_cond, &g_lock, &ts);
+	ret = g_done ? g_count : -3;
+	g_done = 0;
+	pthread_mutex_unlock(&g_lock);
+	return ret;
+}
+
+/*
+ * 同步解析、缓存命中、DomainName2Addr走缓存
+ */
+static void test_lookup(void)
+{
+	struct sockaddr_storage addr[RESOLVER_MAX_ADDR];
+	int n;
+
+	ResolverFlush();
+	errno = 0;
+	if (ResolverLookupCached("localhost", "80", addr, RESOLVER_MAX_ADDR) != -1 || errno != EAGAIN)
+		FAIL("empty cache should miss with EAGAIN");
+
+	n = ResolverLookup("localhost", "80", addr, RESOLVER_MAX_ADDR);
+	if (n <= 0 || !has_loopback(addr, n, 80))
+		FAIL("lookup localhost: %d", n);
+
+	memset(addr, 0, sizeof(addr));
+	if (ResolverLookupCached("localhost", "80", addr, RESOLVER_MAX_ADDR) != n || !has_loopback(addr, n, 80))
+		FAIL("cached lookup");
+
+	memset(addr, 0, sizeof(addr));
+	if (DomainName2Addr("localhost", "80", addr, RESOLVER_MAX_ADDR) != n || !has_loopback(addr, n, 80))
+		FAIL("DomainName2Addr");
+
+	/* 不同的服务是不同的缓存项 */
+	errno = 0;
+	if (ResolverLookupCached("localhost", "81", addr, RESOLVER_MAX_ADDR) != -1 || errno != EAGAIN)
+		FAIL("service is part of the key");
+}
+
+/*
+ * 失败结果缓存(negative caching)和有效期
+ */
+static void test_ttl(void)
+{
+	struct sockaddr_storage addr[RESOLVER_MAX_ADDR];
+
+	ResolverFlush();
+	ResolverSetTTL(300, 300);
+
+	/* 未知的服务名在本地即失败，不访问DNS */
+	if (ResolverLookup("localhost", "no-such-service-name", addr, RESOLVER_MAX_ADDR) != -1)
+		FAIL("unknown service should fail");
+	errno = 0;
+	if (ResolverLookupCached("localhost", "no-such-service-name", addr, RESOLVER_MAX_ADDR) != -1 || errno == EAGAIN)
+		FAIL("failure not cached");
+
+	if (ResolverLookup("localhost", "80", addr, RESOLVER_MAX_ADDR) <= 0)
+		FAIL("lookup localhost");
+
+	usleep(400 * 1000);
+	errno = 0;
+	if (ResolverLookupCached("localhost", "80", addr, RESOLVER_MAX_ADDR) != -1 || errno != EAGAIN)
+		FAIL("entry not expired");
+	errno = 0;
+	if (ResolverLookupCached("localhost", "no-such-service-name", addr, RESOLVER_MAX_ADDR) != -1 || errno != EAGAIN)
+		FAIL("negative entry not expired");
+
+	ResolverSetTTL(30000, 5000);
+}
+
+/*
+ * NULL主机（通配/回环地址）与""（解析失败）是不同的缓存项，与调用顺序无关
+ */
+static void test_null_host(void)
+{
+	struct sockaddr_storage addr[RESOLVER_MAX_ADDR];
+	int round;
+
+	for (round=0; round<2; round++)
+	{
+		ResolverFlush();
+		if (round == 1 && ResolverLookup("", "80", addr, RESOLVER_MAX_ADDR) != -1)
+			FAIL("\"\" should fail");
+		if (ResolverLookup(NULL, "80", addr, RESOLVER_MAX_ADDR) <= 0)
+			FAIL("NULL host failed (round %d)", round);
+		if (ResolverLookup("", "80", addr, RESOLVER_MAX_ADDR) != -1)
+			FAIL("\"\" answered from the NULL entry (round %d)", round);
+		if (ResolverLookupCached(NULL, "80", addr, RESOLVER_MAX_ADDR) <= 0)
+			FAIL("NULL host entry lost (round %d)", round);
+	}
+}
+
+static void *lookup_thread(void *arg)
+{
+	struct sockaddr_storage addr[RESOLVER_MAX_ADDR];
+	int n = ResolverLookup("localhost", "8081", addr, RESOLVER_MAX_ADDR);
+
+	return (void *)(long)((n > 0 && has_loopback(addr, n, 8081)) ? 1 : 0);
+}
+
+/*
+ * 并发未命中同一主机/服务时只调用一次getaddrinfo，所有线程都得到结果
+ */
+static void test_coalesce(void)
+{
+	pthread_t tid[8];
+	void *ok;
+	int i, good = 0;
+
+	ResolverFlush();
+	g_gai_calls = 0;
+	g_gai_delay_ms = 200;
+	for (i=0; i<8; i++)
+		pthread_create(&tid[i], NULL, lookup_thread, NULL);
+	for (i=0; i<8; i++)
+	{
+		pthread_join(tid[i], &ok);
+		good += (ok != NULL);
+	}
+	g_gai_delay_ms = 0;
+
+	if (good != 8)
+		FAIL("%d of 8 lookups succeeded", good);
+	if (g_gai_calls != 1)
+		FAIL("getaddrinfo called %d times for 8 concurrent lookups", g_gai_calls);
+
+	/* 缓存有效期为0时同样合并，等待者从解析结果而不是缓存取地址 */
+	ResolverFlush();
+	ResolverSetTTL(0, 0);
+	g_gai_calls = 0;
+	g_gai_delay_ms = 200;
+	good = 0;
+	for (i=0; i<8; i++)
+		pthread_create(&tid[i], NULL, lookup_thread, NULL);
+	for (i=0; i<8; i++)
+	{
+		pthread_join(tid[i], &ok);
+		good += (ok != NULL);
+	}
+	g_gai_delay_ms = 0;
+	ResolverSetTTL(30000, 5000);
+
+	if (good != 8)
+		FAIL("ttl 0: %d of 8 lookups succeeded", good);
+	if (g_gai_calls > 2)
+		FAIL("ttl 0: getaddrinfo called %d times", g_gai_calls);
+}
+
+/*
+ * 异步解析：未命中时在解析线程中回调，命中时在调用线程中立即回调
+ */
+static void test_async(void)
+{
+	int ret;
+
+	ResolverFlush();
+	ret = ResolverLookupAsync("localhost", "443", on_resolved, NULL);
+	if (ret != 0)
+		FAIL("first async lookup returned %d, want 0", ret);
+	ret = wait_callback(5000);
+	if (ret <= 0)
+		FAIL("callback count %d", ret);
+
+	ret = ResolverLookupAsync("localhost", "443", on_resolved, NULL);
+	if (ret != 1)
+		FAIL("cached async lookup returned %d, want 1", ret);
+	if (wait_callback(0) <= 0)
+		FAIL("cached callback not run in the caller");
+
+	ret = ResolverLookupAsync("localhost", "no-such-service-name", on_resolved, NULL);
+	if (ret < 0 || wait_callback(5000) != -1)
+		FAIL("failed lookup should report -1");
+}
+
+/*
+ * eventfd通知
+ */
+static void test_notify(void)
+{
+	struct sockaddr_storage addr[RESOLVER_MAX_ADDR];
+	struct pollfd pfd;
+	int efd, ret;
+
+	ResolverFlush();
+	efd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (efd < 0)
+	{
+		FAIL("eventfd");
+		return;
+	}
+
+	ret = ResolverLookupNotify("localhost", "8080", efd);
+	if (ret != 0)
+		FAIL("notify returned %d, want 0", ret);
+
+	pfd.fd = efd;
+	pfd.events = POLLIN;
+	if (poll(&pfd, 1, 5000) != 1)
+		FAIL("eventfd not signalled");
+
+	ret = ResolverLookupCached("localhost", "8080", addr, RESOLVER_MAX_ADDR);
+	if (ret <= 0 || !has_loopback(addr, ret, 8080))
+		FAIL("result not cached after notify: %d", ret);
+
+	if (ResolverLookupNotify("localhost", "8080", efd) != 1)
+		FAIL("cached notify should return 1");
+	close(efd);
+}
+
+/*
+ * 命中缓存与getaddrinfo的耗时对比，只输出不判断
+ */
+static void bench_cached(void)
+{
+	struct sockaddr_storage addr[RESOLVER_MAX_ADDR];
+	struct addrinfo hints, *res;
+	long long start, t1, t2;
+	int i, rounds = 2000;
+
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+
+	start = TimerNow();
+	for (i=0; i<rounds; i++)
+	{
+		if (getaddrinfo("localhost", "80", &hints, &res) == 0)
+			freeaddrinfo(res);
+	}
+	t1 = TimerNow() - start;
+
+	ResolverLookup("localhost", "80", addr, RESOLVER_MAX_ADDR);
+	start = TimerNow();
+	for (i=0; i<rounds * 100; i++)
+		ResolverLookup("localhost", "80", addr, RESOLVER_MAX_ADDR);
+	t2 = TimerNow() - start;
+
+	printf("getaddrinfo %.2fus, cached lookup %.3fus\n", t1 * 1000.0 / rounds, t2 * 1000.0 / (rounds * 100));
+}
+
+int main(void)
+{
+	test_lookup();
+	test_ttl();
+	test_null_host();
+	test_coalesce();
+	test_async();
+	test_notify();
+	bench_cached();
+
+	if (g_fails)
+	{
+		printf("test_resolver: %d failures\n", g_fails);
+		return 1;
+	}
+	printf("test_resolver: ok\n");
+	return 0;
+}
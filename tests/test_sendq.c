@@ -0,0 +1,249 @@
+/*
+ * 发送队列测试：多个生产者线程经由socketpair发送，校验每条消息完整且同一生产者的消息保持顺序
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include "easy_event.h"
+#include "easy_sendq.h"
+#include "easy_buffer.h"
+
+static int g_fails;
+
+#define FAIL(fmt, ...) do { g_fails++; printf("FAIL %s: " fmt "\n", __FUNCTION__, ##__VA_ARGS__); } while (0)
+
+#define PRODUCERS  4
+#define MESSAGES   20000
+#define MAX_BODY   3000
+
+/* 消息格式：4字节总长度，2字节生产者编号，4字节序号，之后为按序号生成的数据 */
+#define HDR_LEN    10
+
+static EventLoop *g_loop;
+static SendQueue *g_queue;
+static volatile int g_push_fails;
+
+static size_t body_len(int producer, uint32_t seq)
+{
+	return (seq * 7919 + producer * 131) % MAX_BODY;
+}
+
+static size_t build_msg(unsigned char *buf, int producer, uint32_t seq)
+{
+	size_t len = HDR_LEN + body_len(producer, seq);
+	size_t i;
+
+	memcpy(buf, &(uint32_t){ (uint32_t)len }, 4);
+	memcpy(buf + 4, &(uint16_t){ (uint16_t)producer }, 2);
+	memcpy(buf + 6, &seq, 4);
+	for (i=HDR_LEN; i<len; i++)
+		buf[i] = (unsigned char)(seq + producer + i);
+	return len;
+}
+
+static void on_write(EventLoop *loop, int fd, int events, void *arg)
+{
+	if (SendQueueFlush((SendQueue *)arg) < 0)
+		FAIL("SendQueueFlush: %s", strerror(errno));
+}
+
+static void *loop_thread(void *arg)
+{
+	EventLoopRun(g_loop);
+	return NULL;
+}
+
+/*
+ * 生产者：交替使用拷贝入队和缓存池入队，队列满(EAGAIN)时重试
+ */
+static void *producer_thread(void *arg)
+{
+	int producer = (int)(long)arg;
+	unsigned char msg[HDR_LEN + MAX_BODY];
+	uint32_t seq;
+	size_t len;
+	void *buf;
+	int ret;
+
+	for (seq=0; seq<MESSAGES; seq++)
+	{
+		len = build_msg(msg, producer, seq);
+		do
+		{
+			if (seq & 1)
+			{
+				buf = BufferAlloc(len);
+				if (!buf)
+					break;
+				memcpy(buf, msg, len);
+				ret = SendQueuePushBuffer(g_queue, buf, len);
+			}
+			else
+			{
+				ret = SendQueuePush(g_queue, msg, len);
+			}
+			if (ret < 0 && errno == EAGAIN)
+				usleep(100);
+		} while (ret < 0 && errno == EAGAIN);
+
+		if (ret < 0)
+			g_push_fails++;
+	}
+	return NULL;
+}
+
+static int read_full(int fd, unsigned char *buf, size_t len)
+{
+	size_t got = 0;
+	ssize_t n;
+
+	while (got < len)
+	{
+		n = read(fd, buf + got, len - got);
+		if (n <= 0)
+			return -1;
+		got += n;
+	}
+	return 0;
+}
+
+/*
+ * 接收端：逐条解析并校验内容和顺序
+ */
+static void test_mpsc(void)
+{
+	pthread_t loop_tid, tid[PRODUCERS];
+	unsigned char msg[HDR_LEN + MAX_BODY], want[HDR_LEN + MAX_BODY];
+	uint32_t next[PRODUCERS] = {0};
+	uint32_t len, seq;
+	uint16_t producer;
+	int sv[2], sndbuf = 4096, i, total = 0;
+
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0)
+	{
+		FAIL("socketpair");
+		return;
+	}
+	/* 小发送缓存，使发送频繁遇到EAGAIN和部分发送 */
+	setsockopt(sv[0], SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+
+	g_loop = EventLoopCreate(0);
+	g_queue = SendQueueCreate(g_loop, sv[0], 256 * 1024);
+	if (!g_loop || !g_queue || EventLoopAdd(g_loop, sv[0], EV_READ, NULL, on_write, g_queue) < 0)
+	{
+		FAIL("setup");
+		return;
+	}
+
+	pthread_create(&loop_tid, NULL, loop_thread, NULL);
+	for (i=0; i<PRODUCERS; i++)
+		pthread_create(&tid[i], NULL, producer_thread, (void *)(long)i);
+
+	while (total < PRODUCERS * MESSAGES)
+	{
+		if (read_full(sv[1], msg, HDR_LEN) < 0)
+		{
+			FAIL("connection closed after %d messages", total);
+			break;
+		}
+		memcpy(&len, msg, 4);
+		memcpy(&producer, msg + 4, 2);
+		memcpy(&seq, msg + 6, 4);
+		if (producer >= PRODUCERS || len < HDR_LEN || len > sizeof(msg) || read_full(sv[1], msg + HDR_LEN, len - HDR_LEN) < 0)
+		{
+			FAIL("bad header after %d messages: len %u producer %u", total, len, producer);
+			break;
+		}
+
+		if (seq != next[producer])
+		{
+			FAIL("producer %u: got seq %u, want %u", producer, seq, next[producer]);
+			break;
+		}
+		build_msg(want, producer, seq);
+		if (len != HDR_LEN + body_len(producer, seq) || memcmp(msg, want, len))
+		{
+			FAIL("producer %u seq %u corrupted", producer, seq);
+			break;
+		}
+		next[producer]++;
+		total++;
+	}
+
+	for (i=0; i<PRODUCERS; i++)
+		pthread_join(tid[i], NULL);
+	if (g_push_fails)
+		FAIL("%d pushes failed", g_push_fails);
+	if (SendQueuePending(g_queue) != 0)
+		FAIL("%zu bytes still pending", SendQueuePending(g_queue));
+	printf("mpsc: %d messages from %d producers\n", total, PRODUCERS);
+
+	EventLoopStop(g_loop);
+	pthread_join(loop_tid, NULL);
+	SendQueueDestroy(g_queue);
+	EventLoopDestroy(g_loop);
+	close(sv[0]);
+	close(sv[1]);
+}
+
+static void count_task(EventLoop *loop, void *arg)
+{
+	(*(int *)arg)++;
+}
+
+/*
+ * 事件循环销毁时未执行的投递任务被执行，发送队列的引用和消息都被释放
+ */
+static void test_destroy_pending(void)
+{
+	struct BufferStats before, after;
+	EventLoop *loop;
+	SendQueue *q;
+	int sv[2], ran = 0, i;
+
+	if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0)
+	{
+		FAIL("socketpair");
+		return;
+	}
+
+	BufferPoolStats(&before);
+	loop = EventLoopCreate(0);
+	q = SendQueueCreate(loop, sv[0], 0);
+	EventLoopAdd(loop, sv[0], EV_READ, NULL, NULL, NULL);
+	for (i=0; i<10; i++)
+		SendQueuePush(q, "hello", 5);
+	EventLoopPost(loop, count_task, &ran);
+	EventLoopPost(loop, count_task, &ran);
+
+	/* 事件循环从未运行，发送任务仍在投递栈中 */
+	SendQueueDestroy(q);
+	EventLoopDestroy(loop);
+	BufferPoolStats(&after);
+
+	if (ran != 2)
+		FAIL("%d of 2 pending posts ran", ran);
+	if (after.allocs - after.frees != before.allocs - before.frees)
+		FAIL("%lld buffers leaked", (long long)((after.allocs - after.frees) - (before.allocs - before.frees)));
+	close(sv[0]);
+	close(sv[1]);
+}
+
+int main(void)
+{
+	test_mpsc();
+	test_destroy_pending();
+
+	if (g_fails)
+	{
+		printf("test_sendq: %d failures\n", g_fails);
+		return 1;
+	}
+	printf("test_sendq: ok\n");
+	return 0;
+}
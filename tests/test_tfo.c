@@ -0,0 +1,166 @@
+/*
+ * TCP Fast Open测试，经由回环网卡
+ * 有root权限时在独立的网络命名空间中开启net.ipv4.tcp_fastopen=3，验证第二次连接在SYN中携带数据；
+ * 否则只验证数据能正确送达（内核未开启TFO时退化为普通连接）
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <poll.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include "easy_socket.h"
+
+#ifndef TCPI_OPT_SYN_DATA
+#define TCPI_OPT_SYN_DATA 32
+#endif
+
+static int g_fails;
+
+#define FAIL(fmt, ...) do { g_fails++; printf("FAIL %s: " fmt "\n", __FUNCTION__, ##__VA_ARGS__); } while (0)
+
+/*
+ * 开启客户端和服务端TFO，需要独立的网络命名空间
+ * return：1 已开启，0 未开启
+ */
+static int enable_tfo(void)
+{
+	int fd, ok;
+
+	if (unshare(CLONE_NEWNET) < 0)
+		return 0;
+
+	/* 新命名空间中的lo默认是关闭的 */
+	if (system("ip link set lo up") != 0)
+		return 0;
+
+	fd = open("/proc/sys/net/ipv4/tcp_fastopen", O_WRONLY);
+	if (fd < 0)
+		return 0;
+	ok = (write(fd, "3", 1) == 1);
+	close(fd);
+	return ok;
+}
+
+static int listen_loopback(int tfo_qlen, char *port, size_t size)
+{
+	struct sockaddr_in addr;
+	socklen_t len = sizeof(addr);
+	int sockfd = TcpListenSocket2("127.0.0.1", "0", 16, tfo_qlen);
+
+	if (sockfd < 0 || getsockname(sockfd, (struct sockaddr *)&addr, &len) < 0)
+		return -1;
+	snprintf(port, size, "%d", ntohs(addr.sin_port));
+	return sockfd;
+}
+
+/*
+ * 建立一次连接，请求数据随连接发送，校验服务端收到的请求和客户端收到的应答
+ * return：1 请求在SYN中发送，0 普通连接，-1 出错
+ */
+static int exchange(int listenfd, const char *port)
+{
+	const char req[] = "GET / HTTP/1.0\r\n\r\n";
+	const char resp[] = "HTTP/1.0 200 OK\r\n\r\n";
+	char buf[64];
+	struct pollfd pfd;
+	struct tcp_info ti;
+	socklen_t len = sizeof(ti);
+	int fd, conn = -1, n, ret = -1;
+
+	fd = TcpConnectSocket2("127.0.0.1", port, 1000, req, sizeof(req) - 1);
+	if (fd < 0)
+	{
+		FAIL("TcpConnectSocket2: %s", strerror(errno));
+		return -1;
+	}
+
+	pfd.fd = listenfd;
+	pfd.events = POLLIN;
+	if (poll(&pfd, 1, 1000) != 1 || (conn = accept(listenfd, NULL, NULL)) < 0)
+	{
+		FAIL("accept");
+		goto out_;
+	}
+
+	n = TcpRecvSocket(conn, buf, sizeof(req) - 1, 1000);
+	if (n != (int)sizeof(req) - 1 || memcmp(buf, req, n))
+	{
+		FAIL("server received %d bytes", n);
+		goto out_;
+	}
+
+	if (TcpSendSocket(conn, resp, sizeof(resp) - 1, 1000) != (int)sizeof(resp) - 1)
+	{
+		FAIL("server send");
+		goto out_;
+	}
+	n = TcpRecvSocket(fd, buf, sizeof(resp) - 1, 1000);
+	if (n != (int)sizeof(resp) - 1 || memcmp(buf, resp, n))
+	{
+		FAIL("client received %d bytes", n);
+		goto out_;
+	}
+
+	if (getsockopt(fd, IPPROTO_TCP, TCP_INFO, &ti, &len) < 0)
+	{
+		FAIL("TCP_INFO");
+		goto out_;
+	}
+	ret = (ti.tcpi_options & TCPI_OPT_SYN_DATA) ? 1 : 0;
+
+out_:
+	if (conn >= 0)
+		close(conn);
+	close(fd);
+	return ret;
+}
+
+int main(void)
+{
+	int tfo = enable_tfo();
+	int listenfd, first, second, plain;
+	char port[16];
+
+	listenfd = listen_loopback(16, port, sizeof(port));
+	if (listenfd < 0)
+	{
+		printf("FAIL listen: %s\n", strerror(errno));
+		return 1;
+	}
+
+	/* 第一次连接获取cookie，第二次在SYN中携带数据 */
+	first = exchange(listenfd, port);
+	second = exchange(listenfd, port);
+	close(listenfd);
+
+	/* 服务端未开启TFO时，客户端携带的cookie被忽略，数据在握手后重发 */
+	listenfd = listen_loopback(0, port, sizeof(port));
+	plain = exchange(listenfd, port);
+	close(listenfd);
+
+	printf("tfo %s: first %d, second %d, server without tfo %d (1 = data in SYN)\n",
+		tfo ? "enabled" : "not enabled, fallback only", first, second, plain);
+
+	if (first == 1)
+		FAIL("first connection has no cookie but sent data in SYN");
+	if (tfo && second != 1)
+		FAIL("second connection did not use the cookie");
+	if (plain == 1)
+		FAIL("server without TFO accepted data in SYN");
+
+	if (g_fails)
+	{
+		printf("test_tfo: %d failures\n", g_fails);
+		return 1;
+	}
+	printf("test_tfo: ok\n");
+	return 0;
+}